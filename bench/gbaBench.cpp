@@ -0,0 +1,430 @@
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/arm7tdmi/ARM7TDMI.h"
+#include "../src/memory/Bus.h"
+#include "../src/GameBoyAdvanceImpl.h"
+#include "../src/Scheduler.h"
+#include "../src/PPU.h"
+#include "../src/RamSearch.h"
+
+/*
+    Microbenchmarks for the emulator's hot paths.
+
+    usage: gba_bench [--filter <substring>] [--out <results.csv>] [--baseline <baseline.csv>] [--threshold <percent>]
+
+    Results are printed as csv (name,iterations,ns_per_op). With --baseline, every benchmark is compared
+    against the stored result of the same name and the program exits with 1 if any of them regressed
+    by more than --threshold percent (default 10).
+*/
+
+struct Benchmark {
+    std::string name;
+    uint64_t iterations;
+    // runs the benchmark body `iterations` times
+    std::function<void(uint64_t)> body;
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+};
+
+// keeps the compiler from optimizing away benchmark results
+static volatile uint32_t sink = 0;
+
+static const uint32_t RUNS = 5;
+
+Result runBenchmark(const Benchmark& benchmark) {
+    // warm up caches and branch predictors
+    benchmark.body(benchmark.iterations / 10 + 1);
+
+    // take the fastest run, it is the least disturbed by the rest of the system
+    double best = 0.0;
+    for(uint32_t run = 0; run < RUNS; run++) {
+        auto start = std::chrono::steady_clock::now();
+        benchmark.body(benchmark.iterations);
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / benchmark.iterations;
+        if(run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return {benchmark.name, benchmark.iterations, best};
+}
+
+std::map<std::string, double> readResults(std::string path) {
+    std::map<std::string, double> results;
+    std::ifstream file(path);
+    std::string line;
+    while(std::getline(file, line)) {
+        std::stringstream stream(line);
+        std::string name, iterations, nsPerOp;
+        if(std::getline(stream, name, ',') && std::getline(stream, iterations, ',') && std::getline(stream, nsPerOp, ',')) {
+            if(name == "name") {
+                // header
+                continue;
+            }
+            results[name] = std::stod(nsPerOp);
+        }
+    }
+    return results;
+}
+
+void writeResults(std::ostream& out, const std::vector<Result>& results) {
+    out << "name,iterations,ns_per_op\n";
+    for(const Result& result : results) {
+        out << result.name << "," << result.iterations << "," << result.nsPerOp << "\n";
+    }
+}
+
+/* Bus */
+
+void addBusBenchmarks(std::vector<Benchmark>& benchmarks, Bus* bus) {
+    struct Region {
+        std::string name;
+        uint32_t address;
+    };
+    // 1KB stride inside each region so reads aren't all served from the same cache line
+    std::vector<Region> readRegions = {
+        {"bios", 0x00000000},
+        {"ewram", 0x02000000},
+        {"iwram", 0x03000000},
+        {"io", 0x04000000},
+        {"palette", 0x05000000},
+        {"vram", 0x06000000},
+        {"oam", 0x07000000},
+        {"rom", 0x08000000},
+    };
+
+    for(const Region& region : readRegions) {
+        uint32_t base = region.address;
+        uint32_t span = (region.name == "io" || region.name == "oam" || region.name == "palette") ? 0x200 : 0x4000;
+        benchmarks.push_back({"bus.read32." + region.name, 1000000, [bus, base, span](uint64_t n) {
+            uint32_t acc = 0;
+            for(uint64_t i = 0; i < n; i++) {
+                acc += bus->read32(base + ((i * 4) & (span - 1)), Bus::CycleType::SEQUENTIAL);
+            }
+            sink = acc;
+        }});
+        benchmarks.push_back({"bus.read16." + region.name, 1000000, [bus, base, span](uint64_t n) {
+            uint32_t acc = 0;
+            for(uint64_t i = 0; i < n; i++) {
+                acc += bus->read16(base + ((i * 2) & (span - 1)), Bus::CycleType::SEQUENTIAL);
+            }
+            sink = acc;
+        }});
+        benchmarks.push_back({"bus.read8." + region.name, 1000000, [bus, base, span](uint64_t n) {
+            uint32_t acc = 0;
+            for(uint64_t i = 0; i < n; i++) {
+                acc += bus->read8(base + (i & (span - 1)), Bus::CycleType::SEQUENTIAL);
+            }
+            sink = acc;
+        }});
+    }
+
+    // write to registers without side effects (BG scroll registers), and to VRAM
+    benchmarks.push_back({"bus.write32.io", 1000000, [bus](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            bus->write32(0x04000010 + ((i * 4) & 0xF), i, Bus::CycleType::SEQUENTIAL);
+        }
+    }});
+    benchmarks.push_back({"bus.write16.io", 1000000, [bus](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            bus->write16(0x04000010 + ((i * 2) & 0xF), i, Bus::CycleType::SEQUENTIAL);
+        }
+    }});
+    benchmarks.push_back({"bus.write8.io", 1000000, [bus](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            bus->write8(0x04000010 + (i & 0xF), i, Bus::CycleType::SEQUENTIAL);
+        }
+    }});
+    benchmarks.push_back({"bus.write32.vram", 1000000, [bus](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            bus->write32(0x06000000 + ((i * 4) & 0xFFFF), i, Bus::CycleType::SEQUENTIAL);
+        }
+    }});
+    benchmarks.push_back({"bus.write16.vram", 1000000, [bus](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            bus->write16(0x06000000 + ((i * 2) & 0xFFFF), i, Bus::CycleType::SEQUENTIAL);
+        }
+    }});
+    benchmarks.push_back({"bus.write8.vram", 1000000, [bus](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            // 8 bit vram writes are duplicated to the halfword, still worth measuring
+            bus->write8(0x06000000 + (i & 0xFFFF), i, Bus::CycleType::SEQUENTIAL);
+        }
+    }});
+}
+
+/* CPU instruction dispatch */
+
+void addCpuBenchmarks(std::vector<Benchmark>& benchmarks, ARM7TDMI* cpu) {
+    struct Opcode {
+        std::string name;
+        uint32_t instruction;
+    };
+
+    // every opcode executes at the start of IWRAM, r1 points to IWRAM so loads and stores stay in fast memory
+    std::vector<Opcode> armOpcodes = {
+        {"add", 0xE0800001},        // add r0, r0, r1
+        {"movs_lsl", 0xE1B02103},   // movs r2, r3, lsl #2
+        {"cmp_imm", 0xE3500010},    // cmp r0, #16
+        {"mul", 0xE0000192},        // mul r0, r2, r1
+        {"ldr", 0xE5912004},        // ldr r2, [r1, #4]
+        {"str", 0xE5812008},        // str r2, [r1, #8]
+        {"ldmia", 0xE891000C},      // ldmia r1, {r2, r3}
+        {"b", 0xEAFFFFFE},          // b #0 (branch to self)
+        {"cond_fail", 0x00800001},  // addeq r0, r0, r1 with Z clear
+    };
+
+    std::vector<Opcode> thumbOpcodes = {
+        {"add_reg", 0x1888},        // adds r0, r1, r2
+        {"lsl_imm", 0x0088},        // lsls r0, r1, #2
+        {"mov_imm", 0x2010},        // movs r0, #16
+        {"alu_and", 0x4008},        // ands r0, r1
+        {"ldr_imm", 0x684A},        // ldr r2, [r1, #4]
+        {"str_imm", 0x608A},        // str r2, [r1, #8]
+        {"push", 0xB40C},           // push {r2, r3}
+        {"b", 0xE7FE},              // b #0 (branch to self)
+    };
+
+    for(const Opcode& opcode : armOpcodes) {
+        uint32_t instruction = opcode.instruction;
+        benchmarks.push_back({"cpu.arm." + opcode.name, 1000000, [cpu, instruction](uint64_t n) {
+            cpu->cpsr.T = 0;
+            cpu->cpsr.Z = 0;
+            for(uint64_t i = 0; i < n; i++) {
+                cpu->setRegister(1, 0x03000100);
+                cpu->setRegister(13, 0x03007F00);
+                cpu->setRegister(15, 0x03000000);
+                cpu->setCurrInstruction(instruction);
+                cpu->step();
+            }
+        }});
+    }
+
+    for(const Opcode& opcode : thumbOpcodes) {
+        uint32_t instruction = opcode.instruction;
+        benchmarks.push_back({"cpu.thumb." + opcode.name, 1000000, [cpu, instruction](uint64_t n) {
+            cpu->cpsr.T = 1;
+            for(uint64_t i = 0; i < n; i++) {
+                cpu->setRegister(1, 0x03000100);
+                cpu->setRegister(13, 0x03007F00);
+                cpu->setRegister(15, 0x03000000);
+                cpu->setCurrInstruction(instruction);
+                cpu->step();
+            }
+            cpu->cpsr.T = 0;
+        }});
+    }
+}
+
+/* Scheduler */
+
+void addSchedulerBenchmarks(std::vector<Benchmark>& benchmarks) {
+    benchmarks.push_back({"scheduler.add_remove", 1000000, [](uint64_t n) {
+        Scheduler scheduler;
+        GameBoyAdvanceImpl::cyclesSinceStart = 0;
+        // typical population: the pending video transition, two running timers and the keypad sample event
+        scheduler.addEvent(Scheduler::EventType::HBLANK, PPU::H_VISIBLE_CYCLES, Scheduler::EventCondition::NULL_CONDITION, false);
+        scheduler.addEvent(Scheduler::EventType::KEYPAD, PPU::V_VISIBLE_CYCLES, Scheduler::EventCondition::NULL_CONDITION, false);
+        for(uint64_t i = 0; i < n; i++) {
+            Scheduler::EventType type = (i & 1) ? Scheduler::EventType::TIMER0 : Scheduler::EventType::TIMER1;
+            scheduler.addEvent(type, (i * 37) % PPU::V_TOTAL, Scheduler::EventCondition::NULL_CONDITION, false);
+            scheduler.removeEvent(type);
+        }
+    }});
+
+    benchmarks.push_back({"scheduler.steady_state", 1000000, [](uint64_t n) {
+        Scheduler scheduler;
+        GameBoyAdvanceImpl::cyclesSinceStart = 0;
+        // every event reschedules itself with its period, like the main loop does
+        std::map<Scheduler::EventType, uint64_t> periods = {
+            {Scheduler::EventType::HBLANK, PPU::H_TOTAL},
+            {Scheduler::EventType::TIMER0, 1024},
+            {Scheduler::EventType::TIMER1, 16384},
+            {Scheduler::EventType::KEYPAD, PPU::V_TOTAL},
+        };
+        for(auto& period : periods) {
+            scheduler.addEvent(period.first, period.second, Scheduler::EventCondition::NULL_CONDITION, false);
+        }
+        uint64_t handled = 0;
+        while(handled < n) {
+            GameBoyAdvanceImpl::cyclesSinceStart = scheduler.peekNextEvent()->startCycle;
+            Scheduler::Event* event = scheduler.getNextEvent(GameBoyAdvanceImpl::cyclesSinceStart);
+            while(event != nullptr) {
+                scheduler.addEvent(event->eventType, periods[event->eventType], Scheduler::EventCondition::NULL_CONDITION, false);
+                handled++;
+                event = scheduler.getNextEvent(GameBoyAdvanceImpl::cyclesSinceStart);
+            }
+        }
+        GameBoyAdvanceImpl::cyclesSinceStart = 0;
+    }});
+}
+
+/* PPU */
+
+void fillVideoMemory(Bus* bus) {
+    // deterministic non trivial pattern so every pixel path gets exercised
+    uint32_t state = 0x12345678;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+    for(uint32_t i = 0; i < 0x400; i += 2) {
+        bus->write16(0x05000000 + i, next() & 0x7FFF, Bus::CycleType::SEQUENTIAL);
+    }
+    for(uint32_t i = 0; i < 0x18000; i += 2) {
+        bus->write16(0x06000000 + i, next(), Bus::CycleType::SEQUENTIAL);
+    }
+    // 32 sprites spread over the screen, 16x16 4bpp, priority 0-3
+    for(uint32_t i = 0; i < 128; i++) {
+        uint16_t attr0 = (i < 32) ? ((i * 5) % 160) : 0x0200; // hide all but the first 32
+        uint16_t attr1 = ((i * 7) % 240) | 0x4000;
+        uint16_t attr2 = (i * 4) | ((i & 3) << 10);
+        bus->write16(0x07000000 + i * 8, attr0, Bus::CycleType::SEQUENTIAL);
+        bus->write16(0x07000000 + i * 8 + 2, attr1, Bus::CycleType::SEQUENTIAL);
+        bus->write16(0x07000000 + i * 8 + 4, attr2, Bus::CycleType::SEQUENTIAL);
+    }
+    // text backgrounds 0-3, different char/screen base blocks and priorities
+    for(uint32_t i = 0; i < 4; i++) {
+        // priority 3-i, char base block i, screen base block 28+i
+        bus->write16(0x04000008 + i * 2, ((3 - i) & 0x3) | (i << 2) | ((28 + i) << 8), Bus::CycleType::SEQUENTIAL);
+    }
+}
+
+void addPpuBenchmarks(std::vector<Benchmark>& benchmarks, Bus* bus, PPU* ppu) {
+    struct Mode {
+        std::string name;
+        uint16_t dispcnt;
+    };
+    std::vector<Mode> modes = {
+        {"mode0", 0x1F40}, // BG0-3, OBJ, 1D obj mapping
+        {"mode3", 0x0403}, // BG2 bitmap
+        {"mode4", 0x1404}, // BG2 paletted bitmap, OBJ
+    };
+
+    fillVideoMemory(bus);
+
+    for(const Mode& mode : modes) {
+        uint16_t dispcnt = mode.dispcnt;
+        // one op = one full frame of scanlines
+        benchmarks.push_back({"ppu.render_scanline." + mode.name, 200, [bus, ppu, dispcnt](uint64_t n) {
+            bus->write16(0x04000000, dispcnt, Bus::CycleType::SEQUENTIAL);
+            for(uint64_t i = 0; i < n; i++) {
+                for(uint16_t scanline = 0; scanline < 228; scanline++) {
+                    ppu->renderScanline(scanline);
+                }
+            }
+        }});
+    }
+
+    benchmarks.push_back({"ppu.render_current_screen", 500, [bus, ppu](uint64_t n) {
+        bus->write16(0x04000000, 0x1F40, Bus::CycleType::SEQUENTIAL);
+        for(uint64_t i = 0; i < n; i++) {
+            sink = ppu->renderCurrentScreen()[i % (PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT)];
+        }
+    }});
+}
+
+void addRamSearchBenchmarks(std::vector<Benchmark>& benchmarks, Bus* bus) {
+    for(uint32_t width : {1, 2, 4}) {
+        // one op = one filter pass over all of the work ram with every address still a candidate
+        benchmarks.push_back({"ram_search.filter_previous.width" + std::to_string(width), 200, [bus, width](uint64_t n) {
+            RamSearch search(bus);
+            for(uint64_t i = 0; i < n; i++) {
+                search.reset(width, false);
+                bus->wRamBoard[i % RamSearch::EWRAM_SIZE]++;
+                sink = search.filterPrevious(RamSearch::NOT_EQUAL);
+            }
+        }});
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string filter = "";
+    std::string outPath = "";
+    std::string baselinePath = "";
+    double threshold = 10.0;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(i + 1 < argc && arg == "--filter") {
+            filter = argv[++i];
+        } else if(i + 1 < argc && arg == "--out") {
+            outPath = argv[++i];
+        } else if(i + 1 < argc && arg == "--baseline") {
+            baselinePath = argv[++i];
+        } else if(i + 1 < argc && arg == "--threshold") {
+            threshold = std::stod(argv[++i]);
+        } else {
+            std::cerr << "usage: gba_bench [--filter <substring>] [--out <results.csv>] "
+                      << "[--baseline <baseline.csv>] [--threshold <percent>]\n";
+            return 2;
+        }
+    }
+
+    GameBoyAdvanceImpl gba;
+    // 1MB of rom filled with a repeating pattern
+    std::vector<uint8_t> rom(0x100000);
+    for(uint32_t i = 0; i < rom.size(); i++) {
+        rom[i] = i * 31;
+    }
+    gba.loadRom(rom);
+
+    std::vector<Benchmark> benchmarks;
+    addBusBenchmarks(benchmarks, gba.getBus());
+    addCpuBenchmarks(benchmarks, gba.getCpu());
+    addSchedulerBenchmarks(benchmarks);
+    addPpuBenchmarks(benchmarks, gba.getBus(), gba.getPpu());
+    addRamSearchBenchmarks(benchmarks, gba.getBus());
+
+    std::vector<Result> results;
+    for(const Benchmark& benchmark : benchmarks) {
+        if(benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        results.push_back(runBenchmark(benchmark));
+        std::cerr << results.back().name << ": " << results.back().nsPerOp << " ns/op\n";
+    }
+
+    writeResults(std::cout, results);
+    if(outPath != "") {
+        std::ofstream out(outPath);
+        writeResults(out, results);
+    }
+
+    if(baselinePath != "") {
+        std::map<std::string, double> baseline = readResults(baselinePath);
+        if(baseline.empty()) {
+            std::cerr << "could not read baseline " << baselinePath << "\n";
+            return 2;
+        }
+        bool regressed = false;
+        for(const Result& result : results) {
+            if(baseline.find(result.name) == baseline.end()) {
+                std::cerr << "NEW       " << result.name << "\n";
+                continue;
+            }
+            double before = baseline[result.name];
+            double change = (result.nsPerOp - before) / before * 100.0;
+            bool isRegression = change > threshold;
+            regressed |= isRegression;
+            std::cerr << (isRegression ? "REGRESSED " : "ok        ") << result.name << ": "
+                      << before << " -> " << result.nsPerOp << " ns/op (" << (change >= 0 ? "+" : "") << change << "%)\n";
+        }
+        return regressed ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/memory/Bus.h"
+#include "../src/arm7tdmi/ARM7TDMI.h"
+#include "../src/GameBoyAdvanceImpl.h"
+#include "workloads.h"
+
+/*
+    Whole system headless throughput benchmark.
+
+    usage: gba_throughput [--frames <n>] [--out <results.csv>] [workload ...]
+
+    A workload is either the name of a generated homebrew workload (mode0, bitmap, sprites, idle, sound, see
+    workloads.h) or a path to a rom. With no workloads given, the bundled cpu test roms and all generated workloads
+    are run.
+    Every workload runs headless for the same number of frames (default 600). Results are printed as csv:
+    emulated frames per second, guest instructions per second and host time spent per subsystem.
+*/
+
+struct Result {
+    std::string workload;
+    uint64_t frames;
+    double seconds;
+    uint64_t instructions;
+    GameBoyAdvanceImpl::Profile profile;
+};
+
+bool loadWorkload(GameBoyAdvanceImpl& gba, std::string workload) {
+    std::vector<uint8_t> rom = workloads::build(workload);
+    if(!rom.empty()) {
+        gba.loadRom(rom);
+        return true;
+    }
+    return gba.loadRom(workload);
+}
+
+void writeResults(std::ostream& out, const std::vector<Result>& results) {
+    out << "workload,frames,seconds,fps,instructions_per_second,cpu_ms,video_ms,timers_ms,dma_ms,other_ms\n";
+    for(const Result& result : results) {
+        out << result.workload << ","
+            << result.frames << ","
+            << result.seconds << ","
+            << result.frames / result.seconds << ","
+            << result.instructions / result.seconds << ","
+            << result.profile.cpu / 1000000.0 << ","
+            << result.profile.video / 1000000.0 << ","
+            << result.profile.timers / 1000000.0 << ","
+            << result.profile.dma / 1000000.0 << ","
+            << result.profile.other / 1000000.0 << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t frames = 600;
+    std::string outPath = "";
+    std::vector<std::string> workloadNames;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(i + 1 < argc && arg == "--frames") {
+            frames = std::stoull(argv[++i]);
+        } else if(i + 1 < argc && arg == "--out") {
+            outPath = argv[++i];
+        } else if(arg.rfind("--", 0) == 0) {
+            std::cerr << "usage: gba_throughput [--frames <n>] [--out <results.csv>] [workload ...]\n";
+            return 2;
+        } else {
+            workloadNames.push_back(arg);
+        }
+    }
+    if(workloadNames.empty()) {
+        workloadNames = {"arm.gba", "thumb.gba"};
+        for(std::string name : workloads::names()) {
+            workloadNames.push_back(name);
+        }
+    }
+
+    std::vector<Result> results;
+    for(std::string workload : workloadNames) {
+        // every run gets a fresh machine
+        GameBoyAdvanceImpl gba;
+        GameBoyAdvanceImpl::cyclesSinceStart = 0;
+        if(!loadWorkload(gba, workload)) {
+            std::cerr << "could not load workload " << workload << "\n";
+            return 2;
+        }
+        gba.setHeadless(true);
+        gba.setProfiling(true);
+
+        auto start = std::chrono::steady_clock::now();
+        for(uint64_t frame = 0; frame < frames; frame++) {
+            gba.runFrame();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        results.push_back({workload,
+                           frames,
+                           std::chrono::duration<double>(end - start).count(),
+                           gba.getInstructionsExecuted(),
+                           gba.getProfile()});
+        std::cerr << workload << ": " << frames / results.back().seconds << " fps\n";
+    }
+
+    writeResults(std::cout, results);
+    if(outPath != "") {
+        std::ofstream out(outPath);
+        writeResults(out, results);
+    }
+    return 0;
+}
@@ -0,0 +1,479 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    Small homebrew workloads, generated as ARM machine code so they don't have to be shipped as binaries.
+    Every workload boots straight from 0x08000000 (the emulator skips the BIOS), does its setup once and
+    then loops forever, doing one unit of work per frame:
+
+    mode0:   4 scrolling text backgrounds, scroll registers updated every frame
+    bitmap:  mode 3, the whole screen is redrawn by the CPU every frame
+    sprites: 128 16x16 sprites over a text background, every OAM entry is moved every frame
+    idle:    mode 3, halts until vblank (IE/IF, IME off so no bios irq handler is needed) and then redraws
+             a few lines, most of the time is spent halted like in most games
+    sound:   idle with direct sound on top, timer 0 clocks fifo A at 16kHz and DMA1 refills it from a buffer
+             in work ram. Every vblank the DMA is restarted and the next buffer is mixed, like most games do
+    raster:  2 text backgrounds scrolled differently on every line: BG0 by the CPU, which halts until every
+             hblank (IE/IF, IME off) and then writes BG0HOFS, BG1 by an HBlank DMA from a table of offsets.
+             Nothing reads the display registers while the frame is drawn
+*/
+
+namespace workloads {
+
+// minimal ARM assembler, just the instructions the workloads need
+class RomBuilder {
+    public:
+        enum Condition : uint32_t {
+            EQ = 0x0,
+            NE = 0x1,
+            AL = 0xE
+        };
+
+        // current address
+        uint32_t here() {
+            return BASE + (uint32_t)code.size() * 4;
+        }
+
+        // mov rd, #value, for any 32 bit value (one instruction per non zero byte)
+        void loadImmediate(uint8_t rd, uint32_t value) {
+            emit(0xE3A00000 | rd << 12 | rotatedByte(value, 0));
+            for(uint32_t byte = 1; byte < 4; byte++) {
+                if((value >> (byte * 8)) & 0xFF) {
+                    // orr rd, rd, #byte
+                    emit(0xE3800000 | rd << 16 | rd << 12 | rotatedByte(value, byte));
+                }
+            }
+        }
+
+        void addImmediate(uint8_t rd, uint8_t rn, uint8_t value) {
+            emit(0xE2800000 | rn << 16 | rd << 12 | value);
+        }
+
+        void subsImmediate(uint8_t rd, uint8_t rn, uint8_t value) {
+            emit(0xE2500000 | rn << 16 | rd << 12 | value);
+        }
+
+        void add(uint8_t rd, uint8_t rn, uint8_t rm) {
+            emit(0xE0800000 | rn << 16 | rd << 12 | rm);
+        }
+
+        // and rd, rn, #value
+        void andImmediate(uint8_t rd, uint8_t rn, uint8_t value) {
+            emit(0xE2000000 | rn << 16 | rd << 12 | value);
+        }
+
+        // orr rd, rn, rm, lsl #shift
+        void orrShifted(uint8_t rd, uint8_t rn, uint8_t rm, uint8_t shift) {
+            emit(0xE1800000 | rn << 16 | rd << 12 | (shift & 0x1F) << 7 | rm);
+        }
+
+        void cmpImmediate(uint8_t rn, uint8_t value) {
+            emit(0xE3500000 | rn << 16 | value);
+        }
+
+        // str rd, [rn], #4
+        void storeWordPostIncrement(uint8_t rd, uint8_t rn) {
+            emit(0xE4800004 | rn << 16 | rd << 12);
+        }
+
+        // strh rd, [rn], #2
+        void storeHalfPostIncrement(uint8_t rd, uint8_t rn) {
+            emit(0xE0C000B2 | rn << 16 | rd << 12);
+        }
+
+        // strh rd, [rn, #offset]
+        void storeHalf(uint8_t rd, uint8_t rn, uint8_t offset) {
+            emit(0xE1C000B0 | rn << 16 | rd << 12 | (offset & 0xF0) << 4 | (offset & 0xF));
+        }
+
+        // strb rd, [rn, #offset]
+        void storeByte(uint8_t rd, uint8_t rn, uint16_t offset) {
+            emit(0xE5C00000 | rn << 16 | rd << 12 | (offset & 0xFFF));
+        }
+
+        // ldr rd, [rn, #offset]
+        void loadWord(uint8_t rd, uint8_t rn, uint16_t offset) {
+            emit(0xE5900000 | rn << 16 | rd << 12 | (offset & 0xFFF));
+        }
+
+        // ldrb rd, [rn, #offset]
+        void loadByte(uint8_t rd, uint8_t rn, uint16_t offset) {
+            emit(0xE5D00000 | rn << 16 | rd << 12 | (offset & 0xFFF));
+        }
+
+        // ldrh rd, [rn, #offset]
+        void loadHalf(uint8_t rd, uint8_t rn, uint8_t offset) {
+            emit(0xE1D000B0 | rn << 16 | rd << 12 | (offset & 0xF0) << 4 | (offset & 0xF));
+        }
+
+        void branch(Condition condition, uint32_t target) {
+            emit(condition << 28 | 0x0A000000 | (((target - (here() + 8)) >> 2) & 0xFFFFFF));
+        }
+
+        // r12 = io base, spins until VCOUNT == 160 and then until it isn't anymore, uses r11
+        void waitForVBlank() {
+            uint32_t waitStart = here();
+            loadHalf(11, 12, 0x06);
+            cmpImmediate(11, 160);
+            branch(NE, waitStart);
+            uint32_t waitEnd = here();
+            loadHalf(11, 12, 0x06);
+            cmpImmediate(11, 160);
+            branch(EQ, waitEnd);
+        }
+
+        // fills [address, address + bytes) with the word in r2, uses r0 and r1
+        void fillWords(uint32_t address, uint32_t bytes) {
+            loadImmediate(0, address);
+            loadImmediate(1, bytes / 4);
+            uint32_t loop = here();
+            storeWordPostIncrement(2, 0);
+            subsImmediate(1, 1, 1);
+            branch(NE, loop);
+        }
+
+        std::vector<uint8_t> build() {
+            std::vector<uint8_t> rom;
+            for(uint32_t word : code) {
+                rom.push_back(word & 0xFF);
+                rom.push_back((word >> 8) & 0xFF);
+                rom.push_back((word >> 16) & 0xFF);
+                rom.push_back((word >> 24) & 0xFF);
+            }
+            // pad to a power of 2 so rom mirroring behaves like a real cart
+            size_t size = 0x400;
+            while(size < rom.size()) {
+                size <<= 1;
+            }
+            rom.resize(size, 0);
+            return rom;
+        }
+
+    private:
+        static constexpr uint32_t BASE = 0x08000000;
+        std::vector<uint32_t> code;
+
+        void emit(uint32_t instruction) {
+            code.push_back(instruction);
+        }
+
+        // immediate operand for byte #byte of value (imm8 rotated right by an even amount)
+        static uint32_t rotatedByte(uint32_t value, uint32_t byte) {
+            uint32_t imm8 = (value >> (byte * 8)) & 0xFF;
+            uint32_t rotate = (byte == 0) ? 0 : (16 - byte * 4);
+            return rotate << 8 | imm8;
+        }
+};
+
+inline
+std::vector<uint8_t> buildMode0() {
+    RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+
+    // palette: 256 colours
+    rom.loadImmediate(2, 0x7C1F03E0);
+    rom.fillWords(0x05000000, 0x200);
+    // tiles: pattern over char base blocks 0 and 1
+    rom.loadImmediate(2, 0x04030201);
+    rom.fillWords(0x06000000, 0x8000);
+    // 4 screen blocks (28-31), every map entry points to a different tile
+    rom.loadImmediate(0, 0x0600E000);
+    rom.loadImmediate(1, 0x1000);
+    rom.loadImmediate(2, 0);
+    uint32_t mapLoop = rom.here();
+    rom.storeHalfPostIncrement(2, 0);
+    rom.addImmediate(2, 2, 1);
+    rom.subsImmediate(1, 1, 1);
+    rom.branch(RomBuilder::NE, mapLoop);
+
+    // BG0-3: 4bpp, char base 0, screen base 28-31, priority 3-0
+    for(uint32_t i = 0; i < 4; i++) {
+        rom.loadImmediate(0, (3 - i) | (28 + i) << 8);
+        rom.storeHalf(0, 12, 0x08 + i * 2);
+    }
+    // DISPCNT: mode 0, BG0-3
+    rom.loadImmediate(0, 0x0F00);
+    rom.storeHalf(0, 12, 0x00);
+
+    // r3 = frame counter
+    rom.loadImmediate(3, 0);
+    uint32_t frameLoop = rom.here();
+    rom.waitForVBlank();
+    rom.addImmediate(3, 3, 1);
+    // BGxHOFS = frame for every layer
+    for(uint32_t i = 0; i < 4; i++) {
+        rom.storeHalf(3, 12, 0x10 + i * 4);
+    }
+    rom.branch(RomBuilder::AL, frameLoop);
+    return rom.build();
+}
+
+inline
+std::vector<uint8_t> buildBitmap() {
+    RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+    // DISPCNT: mode 3, BG2
+    rom.loadImmediate(0, 0x0403);
+    rom.storeHalf(0, 12, 0x00);
+
+    // r2 = two pixels of colour, changed every frame
+    rom.loadImmediate(2, 0);
+    uint32_t frameLoop = rom.here();
+    rom.waitForVBlank();
+    rom.addImmediate(2, 2, 1);
+    rom.orrShifted(2, 2, 2, 16);
+    rom.fillWords(0x06000000, 240 * 160 * 2);
+    rom.andImmediate(2, 2, 0xFF);
+    rom.branch(RomBuilder::AL, frameLoop);
+    return rom.build();
+}
+
+inline
+std::vector<uint8_t> buildSprites() {
+    RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+
+    // bg and obj palettes
+    rom.loadImmediate(2, 0x001F7FE0);
+    rom.fillWords(0x05000000, 0x400);
+    // obj tiles
+    rom.loadImmediate(2, 0x12345678);
+    rom.fillWords(0x06010000, 0x8000);
+    // bg tiles and map so there is something behind the sprites
+    rom.loadImmediate(2, 0x11111111);
+    rom.fillWords(0x06000000, 0x20);
+    // BG0: priority 3, screen base 31
+    rom.loadImmediate(0, 0x1F03);
+    rom.storeHalf(0, 12, 0x08);
+    // DISPCNT: mode 0, BG0, OBJ, 1D obj mapping
+    rom.loadImmediate(0, 0x1140);
+    rom.storeHalf(0, 12, 0x00);
+
+    // r3 = frame counter
+    rom.loadImmediate(3, 0);
+    uint32_t frameLoop = rom.here();
+    rom.waitForVBlank();
+    rom.addImmediate(3, 3, 1);
+
+    // move all 128 sprites: attr0 = y (frame + 3 * i), attr1 = x (frame + 5 * i) | 16x16, attr2 = tile 4 * i, priority i & 3
+    rom.loadImmediate(0, 0x07000000);
+    rom.loadImmediate(1, 128);
+    rom.loadImmediate(4, 0);  // r4 = 3 * i
+    rom.loadImmediate(5, 0);  // r5 = 5 * i
+    rom.loadImmediate(6, 0);  // r6 = attr2
+    rom.loadImmediate(8, 0x4000);  // r8 = 16x16 size bits
+    uint32_t spriteLoop = rom.here();
+    rom.add(7, 3, 4);
+    rom.andImmediate(7, 7, 0x7F);
+    rom.storeHalf(7, 0, 0);
+    rom.add(7, 3, 5);
+    rom.andImmediate(7, 7, 0xFF);
+    rom.orrShifted(7, 7, 8, 0);
+    rom.storeHalf(7, 0, 2);
+    rom.storeHalf(6, 0, 4);
+    rom.addImmediate(4, 4, 3);
+    rom.addImmediate(5, 5, 5);
+    rom.addImmediate(6, 6, 4);
+    rom.addImmediate(0, 0, 8);
+    rom.subsImmediate(1, 1, 1);
+    rom.branch(RomBuilder::NE, spriteLoop);
+
+    rom.branch(RomBuilder::AL, frameLoop);
+    return rom.build();
+}
+
+inline
+std::vector<uint8_t> buildIdle() {
+    RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+    rom.loadImmediate(10, 0x04000200);
+    // DISPCNT: mode 3, BG2
+    rom.loadImmediate(0, 0x0403);
+    rom.storeHalf(0, 12, 0x00);
+    // DISPSTAT: vblank irq, IE: vblank
+    rom.loadImmediate(0, 0x0008);
+    rom.storeHalf(0, 12, 0x04);
+    rom.loadImmediate(0, 0x0001);
+    rom.storeHalf(0, 10, 0x00);
+
+    // r2 = two pixels of colour, changed every frame
+    rom.loadImmediate(2, 0);
+    uint32_t frameLoop = rom.here();
+    // acknowledge vblank in IF and halt until the next one
+    rom.loadImmediate(0, 0x0001);
+    rom.storeHalf(0, 10, 0x02);
+    rom.storeByte(0, 12, 0x301);
+    rom.addImmediate(2, 2, 1);
+    rom.orrShifted(2, 2, 2, 16);
+    rom.fillWords(0x06000000, 240 * 16 * 2);
+    rom.andImmediate(2, 2, 0xFF);
+    rom.branch(RomBuilder::AL, frameLoop);
+    return rom.build();
+}
+
+inline
+std::vector<uint8_t> buildSound() {
+    RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+    rom.loadImmediate(10, 0x04000200);
+    rom.loadImmediate(9, 0x04000100);
+    // DISPCNT: mode 3, BG2
+    rom.loadImmediate(0, 0x0403);
+    rom.storeHalf(0, 12, 0x00);
+    // DISPSTAT: vblank irq, IE: vblank
+    rom.loadImmediate(0, 0x0008);
+    rom.storeHalf(0, 12, 0x04);
+    rom.loadImmediate(0, 0x0001);
+    rom.storeHalf(0, 10, 0x00);
+
+    // SOUNDCNT_X: master enable, SOUNDCNT_H: fifo A at full volume on both speakers, timer 0, reset fifo A
+    rom.loadImmediate(0, 0x0080);
+    rom.storeHalf(0, 12, 0x84);
+    rom.loadImmediate(0, 0x0B04);
+    rom.storeHalf(0, 12, 0x82);
+    // DMA1DAD: FIFO_A
+    rom.loadImmediate(0, 0x00A0);
+    rom.storeHalf(0, 12, 0xC0);
+    rom.loadImmediate(0, 0x0400);
+    rom.storeHalf(0, 12, 0xC2);
+    // TM0: 1024 cycles per sample, started
+    rom.loadImmediate(0, 0xFC00);
+    rom.storeHalf(0, 9, 0x00);
+    rom.loadImmediate(0, 0x0080);
+    rom.storeHalf(0, 9, 0x02);
+
+    // r2 = four samples, changed every frame
+    rom.loadImmediate(2, 0);
+    uint32_t frameLoop = rom.here();
+    // acknowledge vblank in IF and halt until the next one
+    rom.loadImmediate(0, 0x0001);
+    rom.storeHalf(0, 10, 0x02);
+    rom.storeByte(0, 12, 0x301);
+    // restart DMA1 from the start of the buffer: SAD = 0x02000000, then enabled, special timing, 32 bit, repeat
+    rom.loadImmediate(0, 0);
+    rom.storeHalf(0, 12, 0xC6);
+    rom.storeHalf(0, 12, 0xBC);
+    rom.loadImmediate(0, 0x0200);
+    rom.storeHalf(0, 12, 0xBE);
+    rom.loadImmediate(0, 0xB600);
+    rom.storeHalf(0, 12, 0xC6);
+    // mix the next frame's samples
+    rom.addImmediate(2, 2, 1);
+    rom.orrShifted(2, 2, 2, 8);
+    rom.orrShifted(2, 2, 2, 16);
+    rom.fillWords(0x02000000, 304);
+    rom.andImmediate(2, 2, 0xFF);
+    rom.branch(RomBuilder::AL, frameLoop);
+    return rom.build();
+}
+
+inline
+std::vector<uint8_t> buildRaster() {
+    RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+
+    // palette: 256 colours
+    rom.loadImmediate(2, 0x7C1F03E0);
+    rom.fillWords(0x05000000, 0x200);
+    // tiles: pattern over char base block 0
+    rom.loadImmediate(2, 0x04030201);
+    rom.fillWords(0x06000000, 0x4000);
+    // screen blocks 30 and 31, every map entry points to a different tile
+    rom.loadImmediate(0, 0x0600F000);
+    rom.loadImmediate(1, 0x800);
+    rom.loadImmediate(2, 0);
+    uint32_t mapLoop = rom.here();
+    rom.storeHalfPostIncrement(2, 0);
+    rom.addImmediate(2, 2, 1);
+    rom.subsImmediate(1, 1, 1);
+    rom.branch(RomBuilder::NE, mapLoop);
+    // table of BG1HOFS values in work ram, one per hblank
+    rom.loadImmediate(0, 0x02000000);
+    rom.loadImmediate(1, 228);
+    rom.loadImmediate(2, 0);
+    uint32_t tableLoop = rom.here();
+    rom.storeHalfPostIncrement(2, 0);
+    rom.addImmediate(2, 2, 3);
+    rom.subsImmediate(1, 1, 1);
+    rom.branch(RomBuilder::NE, tableLoop);
+
+    // BG0: priority 0, screen base 30, BG1: priority 1, screen base 31
+    rom.loadImmediate(0, 0x1E00);
+    rom.storeHalf(0, 12, 0x08);
+    rom.loadImmediate(0, 0x1F01);
+    rom.storeHalf(0, 12, 0x0A);
+    // DISPCNT: mode 0, BG0-1
+    rom.loadImmediate(0, 0x0300);
+    rom.storeHalf(0, 12, 0x00);
+    // DMA0DAD: BG1HOFS, DMA0CNT_L: 1 halfword per hblank
+    rom.loadImmediate(0, 0x0014);
+    rom.storeHalf(0, 12, 0xB4);
+    rom.loadImmediate(0, 0x0400);
+    rom.storeHalf(0, 12, 0xB6);
+    rom.loadImmediate(0, 1);
+    rom.storeHalf(0, 12, 0xB8);
+    // DISPSTAT: hblank irq, IE: hblank
+    rom.loadImmediate(10, 0x04000200);
+    rom.loadImmediate(0, 0x0010);
+    rom.storeHalf(0, 12, 0x04);
+    rom.loadImmediate(0, 0x0002);
+    rom.storeHalf(0, 10, 0x00);
+
+    // r3 = frame counter, r4 = BG0HOFS
+    rom.loadImmediate(3, 0);
+    rom.loadImmediate(4, 0);
+    rom.waitForVBlank();
+    uint32_t frameLoop = rom.here();
+    rom.addImmediate(3, 3, 1);
+    // restart DMA0 from the table: SAD = 0x02000000 + frame & 0x3E, then enabled, hblank, repeat, 16 bit,
+    // fixed destination
+    rom.loadImmediate(0, 0);
+    rom.storeHalf(0, 12, 0xBA);
+    rom.andImmediate(0, 3, 0x3E);
+    rom.storeHalf(0, 12, 0xB0);
+    rom.loadImmediate(0, 0x0200);
+    rom.storeHalf(0, 12, 0xB2);
+    rom.loadImmediate(0, 0xA240);
+    rom.storeHalf(0, 12, 0xBA);
+    // 228 lines: acknowledge hblank in IF, halt until the next one and scroll BG0 by another pixel
+    rom.loadImmediate(1, 228);
+    uint32_t lineLoop = rom.here();
+    rom.loadImmediate(0, 0x0002);
+    rom.storeHalf(0, 10, 0x02);
+    rom.storeByte(0, 12, 0x301);
+    rom.addImmediate(4, 4, 1);
+    rom.storeHalf(4, 12, 0x10);
+    rom.subsImmediate(1, 1, 1);
+    rom.branch(RomBuilder::NE, lineLoop);
+    rom.branch(RomBuilder::AL, frameLoop);
+    return rom.build();
+}
+
+// returns an empty vector if there is no workload with that name
+inline
+std::vector<uint8_t> build(std::string name) {
+    if(name == "mode0") {
+        return buildMode0();
+    } else if(name == "bitmap") {
+        return buildBitmap();
+    } else if(name == "sprites") {
+        return buildSprites();
+    } else if(name == "idle") {
+        return buildIdle();
+    } else if(name == "sound") {
+        return buildSound();
+    } else if(name == "raster") {
+        return buildRaster();
+    }
+    return {};
+}
+
+inline
+std::vector<std::string> names() {
+    return {"mode0", "bitmap", "sprites", "idle", "sound", "raster"};
+}
+
+}
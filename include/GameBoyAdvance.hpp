@@ -1,5 +1,7 @@
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 
 class GameBoyAdvanceImpl;
 
@@ -7,10 +9,84 @@ class GameBoyAdvance {
     public: 
         GameBoyAdvance();
         bool loadRom(std::string path);
+        // opt in, before loadRom: the first run of a rom caches a save state in directory when the rom first reads
+        // the keypad (frame 0) or at the given frame, later runs of the same rom start from it
+        void setWarmStart(std::string directory, uint32_t frame = 0);
         void setBreakpoint(uint32_t address);
         void enableDebugger();
         void runRom(); 
         void printCpuState();
+        // bits 0-9: A, B, Select, Start, Right, Left, Up, Down, R, L (0=Pressed, 1=Released)
+        // safe to call from any thread, replaces keyboard input
+        void setKeyState(uint16_t keys);
+        // how often input is sampled into KEYINPUT, in scanlines (1 - 228). Keyboard input is read at every sample
+        void setInputSampleInterval(uint32_t scanlines);
+        // connect to another instance with an in-process link cable (up to 4 instances),
+        // must be called before either instance starts running. Returns false if the cable is full
+        bool linkWith(GameBoyAdvance& other);
+        // byte order in memory, BGRA8888 is XRGB8888 read as a little endian word
+        enum class PixelFormat {
+            RGBA8888,
+            BGRA8888,
+            RGB565
+        };
+        // imitate the colours of the GBA LCD in the window and getFrame
+        void setColourCorrection(bool enabled);
+        // format of getFrame, RGBA8888 by default
+        void setPixelFormat(PixelFormat format);
+        enum class UpscaleFilter {
+            NONE,
+            NEAREST,
+            SCALE2X,
+            SCALE3X,
+            XBR2X
+        };
+        // filter the window output on the cpu (on a pool of worker threads), scale is only used by NEAREST (1 - 8)
+        void setUpscaleFilter(UpscaleFilter filter, uint32_t scale = 2);
+        // number of threads rendering each frame (0 = one per core, 1 = serially, the default), same pixels either way
+        void setRenderThreads(uint32_t threads);
+        // copies the last completed frame into buffer, 240x160 pixels of 4 bytes (2 for RGB565).
+        // Not synchronized with runRom, call it from the thread running the emulation
+        void getFrame(void* buffer);
+        // record the session on a background thread: every frame to videoPath (.y4m for Y4M, anything else raw
+        // rgb24 240x160) and audio to audioPath (16 bit stereo WAV), either path may be empty. If the writer falls
+        // behind frames are dropped, or emulation waits for it if blockWhenFull is set. Returns false if a file
+        // could not be opened
+        bool startCapture(std::string videoPath, std::string audioPath = "", bool blockWhenFull = false);
+        // flushes and closes the capture files, also done on destruction
+        void stopCapture();
+        // publish every completed frame to the POSIX shared memory object name, a ring of slots frames in the given
+        // format that other processes can map and read without copies (protocol in src/FrameExport.h).
+        // Slow readers never block the emulator, they miss frames. Returns false if it can't be created
+        bool startFrameExport(std::string name, uint32_t slots = 4, PixelFormat format = PixelFormat::RGBA8888);
+        void stopFrameExport();
+        // GameShark / Action Replay v1-v2 (encrypted or not) or CodeBreaker codes separated by '+' or whitespace,
+        // one cheat per index. Call after loadRom, which clears them. Returns false if a code isn't supported
+        bool setCheat(uint32_t index, bool enabled, std::string codes);
+        void clearCheats();
+        // ram search for the addresses of game variables in work ram (EWRAM and IWRAM). startRamSearch makes every
+        // aligned value of width bytes (1, 2 or 4) a candidate, each filter keeps the candidates whose value now
+        // compares to their value at the last filter (LESS: decreased, ...) or to a constant. Call between frames
+        enum class SearchComparison {
+            EQUAL,
+            NOT_EQUAL,
+            LESS,
+            LESS_OR_EQUAL,
+            GREATER,
+            GREATER_OR_EQUAL
+        };
+        struct SearchCandidate {
+            uint32_t address;
+            // sign extended for signed searches
+            uint32_t value;
+            uint32_t previous;
+        };
+        void startRamSearch(uint32_t width, bool isSigned = false);
+        // return the number of candidates left
+        size_t filterRamSearch(SearchComparison comparison);
+        size_t filterRamSearchValue(SearchComparison comparison, uint32_t value);
+        // the first max candidates in address order
+        std::vector<SearchCandidate> getRamSearchCandidates(size_t max);
         // TODO: more public methods   
     
     private: 
@@ -0,0 +1,300 @@
+#include "Capture.h"
+#include "util/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+Capture::~Capture() {
+    stop();
+}
+
+bool Capture::start(const Options& options) {
+    stop();
+    this->options = options;
+
+    if(options.videoPath != "") {
+        videoFile = fopen(options.videoPath.c_str(), "wb");
+        if(videoFile == nullptr) {
+            std::cerr << "could not open " << options.videoPath << " for capture\n";
+            return false;
+        }
+    }
+    if(options.audioPath != "") {
+        audioFile = fopen(options.audioPath.c_str(), "wb");
+        if(audioFile == nullptr) {
+            std::cerr << "could not open " << options.audioPath << " for capture\n";
+            if(videoFile != nullptr) {
+                fclose(videoFile);
+                videoFile = nullptr;
+            }
+            return false;
+        }
+    }
+
+    // large buffers so every frame turns into few big sequential writes
+    if(videoFile != nullptr) {
+        setvbuf(videoFile, nullptr, _IOFBF, 1 << 20);
+    }
+    if(audioFile != nullptr) {
+        setvbuf(audioFile, nullptr, _IOFBF, 1 << 16);
+        // sizes are filled in by stop()
+        writeWavHeader(0);
+    }
+
+    std::string extension = ".y4m";
+    y4m = options.videoPath.size() >= extension.size() &&
+          options.videoPath.compare(options.videoPath.size() - extension.size(), extension.size(), extension) == 0;
+    if(y4m) {
+        fprintf(videoFile, "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 C444\n",
+                FRAME_WIDTH, FRAME_HEIGHT, FRAME_RATE_NUMERATOR, FRAME_RATE_DENOMINATOR);
+        for(uint32_t colour = 0; colour < yuvTable.size(); colour++) {
+            int32_t r = ((colour & 0x1F) << 3) | ((colour & 0x1F) >> 2);
+            int32_t g = (((colour >> 5) & 0x1F) << 3) | (((colour >> 5) & 0x1F) >> 2);
+            int32_t b = (((colour >> 10) & 0x1F) << 3) | (((colour >> 10) & 0x1F) >> 2);
+            // BT.601 limited range
+            uint32_t y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+            uint32_t cb = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            uint32_t cr = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+            yuvTable[colour] = y | (cb << 8) | (cr << 16);
+        }
+    }
+
+    frames.resize(FRAME_BUFFERS);
+    audioBlocks.resize(AUDIO_BUFFERS);
+    uint8_t index;
+    while(freeFrames.pop(index)) {}
+    while(freeAudioBlocks.pop(index)) {}
+    for(uint8_t i = 0; i < FRAME_BUFFERS; i++) {
+        freeFrames.push(i);
+    }
+    for(uint8_t i = 0; i < AUDIO_BUFFERS; i++) {
+        freeAudioBlocks.push(i);
+    }
+    hasLastFrame = false;
+    spareFrame = -1;
+
+    framesWritten = 0;
+    repeatedFrames = 0;
+    droppedFrames = 0;
+    audioSamples = 0;
+    droppedAudioBlocks = 0;
+
+    stopping = false;
+    writer = std::thread(&Capture::writerLoop, this);
+    active = true;
+    return true;
+}
+
+void Capture::stop() {
+    if(!active) {
+        return;
+    }
+    active = false;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+
+    if(videoFile != nullptr) {
+        fclose(videoFile);
+        videoFile = nullptr;
+    }
+    if(audioFile != nullptr) {
+        writeWavHeader((uint32_t)std::min<uint64_t>(audioSamples * 4, UINT32_MAX - 36));
+        fclose(audioFile);
+        audioFile = nullptr;
+    }
+
+    LOG_INFO(GENERAL, "capture: " << framesWritten << " frames (" << repeatedFrames << " repeated, "
+                      << droppedFrames << " dropped), " << audioSamples << " audio samples ("
+                      << droppedAudioBlocks << " blocks dropped)\n");
+}
+
+bool Capture::isActive() {
+    return active;
+}
+
+bool Capture::acquireBuffer(SpscQueue<uint8_t, 32>& freeBuffers, uint8_t& index) {
+    while(!freeBuffers.pop(index)) {
+        if(!options.blockWhenFull) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+bool Capture::pushPacket(Packet packet) {
+    while(!packets.push(packet)) {
+        if(!options.blockWhenFull) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+void Capture::pushFrame(const Frame& frame, bool changed) {
+    if(!active || videoFile == nullptr) {
+        return;
+    }
+
+    if(hasLastFrame && !changed) {
+        if(!pushPacket({REPEAT_FRAME, 0})) {
+            droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    uint8_t index;
+    if(spareFrame >= 0) {
+        index = (uint8_t)spareFrame;
+        spareFrame = -1;
+    } else if(!acquireBuffer(freeFrames, index)) {
+        droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        // the next frame must not be sent as a repeat of one that was never written
+        hasLastFrame = false;
+        return;
+    }
+    frames[index] = frame;
+    if(!pushPacket({FRAME, index})) {
+        // the queue is full of repeats and audio blocks. Only the writer may push to freeFrames, keep the buffer
+        droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        spareFrame = index;
+        hasLastFrame = false;
+        return;
+    }
+    hasLastFrame = true;
+}
+
+void Capture::pushAudio(const int16_t* samples, size_t sampleFrames) {
+    if(!active || audioFile == nullptr) {
+        return;
+    }
+
+    while(sampleFrames > 0) {
+        uint32_t blockFrames = (uint32_t)std::min<size_t>(sampleFrames, AUDIO_BLOCK_SAMPLES);
+        uint8_t index;
+        if(!acquireBuffer(freeAudioBlocks, index)) {
+            droppedAudioBlocks.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            memcpy(audioBlocks[index].samples.data(), samples, blockFrames * 2 * sizeof(int16_t));
+            audioBlocks[index].sampleFrames = blockFrames;
+            pushPacket({AUDIO, index});
+        }
+        samples += blockFrames * 2;
+        sampleFrames -= blockFrames;
+    }
+}
+
+Capture::Stats Capture::getStats() {
+    Stats stats;
+    stats.frames = framesWritten.load(std::memory_order_relaxed);
+    stats.repeatedFrames = repeatedFrames.load(std::memory_order_relaxed);
+    stats.droppedFrames = droppedFrames.load(std::memory_order_relaxed);
+    stats.audioSamples = audioSamples.load(std::memory_order_relaxed);
+    stats.droppedAudioBlocks = droppedAudioBlocks.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Capture::writerLoop() {
+    Packet packet;
+    while(true) {
+        if(packets.pop(packet)) {
+            writePacket(packet);
+        } else if(stopping.load(std::memory_order_acquire)) {
+            // the producer has stopped pushing, one more pass drains whatever was queued before
+            while(packets.pop(packet)) {
+                writePacket(packet);
+            }
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void Capture::writePacket(const Packet& packet) {
+    switch(packet.type) {
+        case FRAME: {
+            convertFrame(frames[packet.buffer]);
+            freeFrames.push(packet.buffer);
+            fwrite(frameBytes.data(), 1, frameBytes.size(), videoFile);
+            framesWritten.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        case REPEAT_FRAME: {
+            // frameBytes still holds the previous frame
+            fwrite(frameBytes.data(), 1, frameBytes.size(), videoFile);
+            framesWritten.fetch_add(1, std::memory_order_relaxed);
+            repeatedFrames.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        case AUDIO: {
+            AudioBlock& block = audioBlocks[packet.buffer];
+            // WAV is little endian like every host this builds for
+            fwrite(block.samples.data(), sizeof(int16_t) * 2, block.sampleFrames, audioFile);
+            audioSamples.fetch_add(block.sampleFrames, std::memory_order_relaxed);
+            freeAudioBlocks.push(packet.buffer);
+            break;
+        }
+    }
+}
+
+void Capture::convertFrame(const Frame& frame) {
+    const size_t pixels = FRAME_WIDTH * FRAME_HEIGHT;
+    if(y4m) {
+        std::string frameHeader = "FRAME\n";
+        frameBytes.resize(frameHeader.size() + pixels * 3);
+        memcpy(frameBytes.data(), frameHeader.data(), frameHeader.size());
+        // planar Y, Cb, Cr
+        uint8_t* y = frameBytes.data() + frameHeader.size();
+        uint8_t* cb = y + pixels;
+        uint8_t* cr = cb + pixels;
+        for(size_t i = 0; i < pixels; i++) {
+            uint32_t yuv = yuvTable[frame[i] & 0x7FFF];
+            y[i] = yuv;
+            cb[i] = yuv >> 8;
+            cr[i] = yuv >> 16;
+        }
+    } else {
+        frameBytes.resize(pixels * 3);
+        uint8_t* rgb = frameBytes.data();
+        for(size_t i = 0; i < pixels; i++) {
+            uint16_t colour = frame[i];
+            uint8_t r = colour & 0x1F;
+            uint8_t g = (colour >> 5) & 0x1F;
+            uint8_t b = (colour >> 10) & 0x1F;
+            rgb[i * 3] = (r << 3) | (r >> 2);
+            rgb[i * 3 + 1] = (g << 3) | (g >> 2);
+            rgb[i * 3 + 2] = (b << 3) | (b >> 2);
+        }
+    }
+}
+
+void Capture::writeWavHeader(uint32_t dataBytes) {
+    auto write32 = [&](uint32_t value) {
+        uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+        fwrite(bytes, 1, 4, audioFile);
+    };
+    auto write16 = [&](uint16_t value) {
+        uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+        fwrite(bytes, 1, 2, audioFile);
+    };
+
+    const uint16_t channels = 2;
+    const uint16_t bitsPerSample = 16;
+    fseek(audioFile, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, audioFile);
+    write32(36 + dataBytes);
+    fwrite("WAVEfmt ", 1, 8, audioFile);
+    write32(16);
+    write16(1); // PCM
+    write16(channels);
+    write32(AUDIO_SAMPLE_RATE);
+    write32(AUDIO_SAMPLE_RATE * channels * bitsPerSample / 8);
+    write16(channels * bitsPerSample / 8);
+    write16(bitsPerSample);
+    fwrite("data", 1, 4, audioFile);
+    write32(dataBytes);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "util/SpscQueue.h"
+
+/*
+    Audio/video capture. The emulation thread hands every completed frame (and audio block) to a bounded queue,
+    a writer thread converts them and writes Y4M (4:4:4, BT.601) or raw rgb24 video and 16 bit stereo WAV audio.
+    Frames without changed lines (PPU::getChangedLines) are passed on as a repeat marker without copying the
+    framebuffer.
+    If the writer falls behind new data is dropped, or with blockWhenFull the emulation waits for a free buffer.
+*/
+class Capture {
+
+    public:
+        struct Options {
+            // .y4m is written as Y4M, anything else as raw rgb24 240x160 frames. Empty for no video
+            std::string videoPath;
+            // WAV, empty for no audio
+            std::string audioPath;
+            bool blockWhenFull = false;
+        };
+
+        struct Stats {
+            uint64_t frames = 0;
+            // frames identical to the previous one
+            uint64_t repeatedFrames = 0;
+            uint64_t droppedFrames = 0;
+            uint64_t audioSamples = 0;
+            uint64_t droppedAudioBlocks = 0;
+        };
+
+        static constexpr uint32_t FRAME_WIDTH = 240;
+        static constexpr uint32_t FRAME_HEIGHT = 160;
+        // 16777216 cycles per second / 280896 cycles per frame
+        static constexpr uint32_t FRAME_RATE_NUMERATOR = 16777216;
+        static constexpr uint32_t FRAME_RATE_DENOMINATOR = 280896;
+        static constexpr uint32_t AUDIO_SAMPLE_RATE = 32768;
+        // stereo sample frames per audio block, longer pushes are split
+        static constexpr uint32_t AUDIO_BLOCK_SAMPLES = 2048;
+
+        using Frame = std::array<uint16_t, FRAME_WIDTH * FRAME_HEIGHT>;
+
+        ~Capture();
+
+        // returns false if a file could not be opened, stops any capture in progress first
+        bool start(const Options& options);
+        // writes everything still queued and closes the files
+        void stop();
+        bool isActive();
+
+        // emulation thread only, changed is false if no line differs from the frame pushed before
+        void pushFrame(const Frame& frame, bool changed);
+        // interleaved left/right samples
+        void pushAudio(const int16_t* samples, size_t sampleFrames);
+
+        // counters of the current (or last) capture, updated by the writer
+        Stats getStats();
+
+    private:
+        static constexpr size_t FRAME_BUFFERS = 8;
+        static constexpr size_t AUDIO_BUFFERS = 16;
+
+        enum PacketType : uint8_t {
+            FRAME,
+            REPEAT_FRAME,
+            AUDIO
+        };
+
+        struct Packet {
+            PacketType type;
+            uint8_t buffer;
+        };
+
+        struct AudioBlock {
+            std::array<int16_t, AUDIO_BLOCK_SAMPLES * 2> samples;
+            uint32_t sampleFrames;
+        };
+
+        Options options;
+        bool active = false;
+        bool y4m = false;
+        FILE* videoFile = nullptr;
+        FILE* audioFile = nullptr;
+
+        // buffers are owned by whoever holds their index, free ones are passed back by the writer
+        std::vector<Frame> frames;
+        std::vector<AudioBlock> audioBlocks;
+        SpscQueue<Packet, 32> packets;
+        SpscQueue<uint8_t, 32> freeFrames;
+        SpscQueue<uint8_t, 32> freeAudioBlocks;
+
+        // the frame before was queued, so an unchanged frame can be sent as a repeat of it
+        bool hasLastFrame = false;
+        // a frame buffer the producer took but couldn't queue, used before taking another free one
+        int16_t spareFrame = -1;
+
+        std::thread writer;
+        std::atomic<bool> stopping = {false};
+
+        std::atomic<uint64_t> framesWritten = {0};
+        std::atomic<uint64_t> repeatedFrames = {0};
+        std::atomic<uint64_t> droppedFrames = {0};
+        std::atomic<uint64_t> audioSamples = {0};
+        std::atomic<uint64_t> droppedAudioBlocks = {0};
+
+        // BGR555 to packed Y, Cb, Cr for Y4M
+        std::array<uint32_t, 0x8000> yuvTable;
+        // one converted frame, rewritten as is for repeats
+        std::vector<uint8_t> frameBytes;
+
+        bool acquireBuffer(SpscQueue<uint8_t, 32>& freeBuffers, uint8_t& index);
+        bool pushPacket(Packet packet);
+
+        void writerLoop();
+        void writePacket(const Packet& packet);
+        void convertFrame(const Frame& frame);
+        void writeWavHeader(uint32_t dataBytes);
+};
@@ -0,0 +1,432 @@
+#include "Cheats.h"
+
+#include <cctype>
+#include <map>
+
+#include "memory/Bus.h"
+
+namespace {
+
+// GameShark / Action Replay v1-v2 TEA seeds
+constexpr uint32_t GAMESHARK_SEEDS[4] = {0x09F4FBBD, 0x9681884A, 0x352027E9, 0xF3DEE5A7};
+
+uint32_t getRegion(uint32_t address) {
+    return address >> 24;
+}
+
+bool isWritable(uint32_t address) {
+    return getRegion(address) >= 0x02 && getRegion(address) <= 0x07;
+}
+
+bool isReadable(uint32_t address) {
+    return isWritable(address) || (getRegion(address) >= 0x08 && getRegion(address) <= 0x0D);
+}
+
+// the work ram address without mirrors, 0 outside work ram
+uint32_t getWorkRamAddress(uint32_t address) {
+    switch(getRegion(address)) {
+        case 0x02: {
+            return address & 0x0203FFFF;
+        }
+        case 0x03: {
+            return address & 0x03007FFF;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+bool parseHex(const std::string& token, uint32_t& value) {
+    if(token.empty() || token.size() > 8) {
+        return false;
+    }
+    value = 0;
+    for(char c : token) {
+        if(!isxdigit((unsigned char)c)) {
+            return false;
+        }
+        value = (value << 4) | (isdigit((unsigned char)c) ? c - '0' : (tolower((unsigned char)c) - 'a' + 10));
+    }
+    return true;
+}
+
+}
+
+bool Cheats::Code::isCondition() const {
+    return type >= IF_EQUAL;
+}
+
+void Cheats::connectBus(std::shared_ptr<Bus> bus) {
+    this->bus = bus;
+}
+
+bool Cheats::set(uint32_t index, bool enabled, const std::string& codes) {
+    std::vector<Code> parsed;
+    if(!parse(codes, parsed)) {
+        return false;
+    }
+    cheats[index] = Cheat{enabled, std::move(parsed)};
+    rebuild();
+    return true;
+}
+
+void Cheats::clear() {
+    cheats.clear();
+    rebuild();
+}
+
+bool Cheats::hasFrameCodes() {
+    return !frameCodes.empty();
+}
+
+void Cheats::runFrame() {
+    for(size_t i = 0; i < frameCodes.size(); i++) {
+        const Code& code = frameCodes[i];
+        bool passed = true;
+        switch(code.type) {
+            case Code::WRITE: {
+                write(code.address, code.width, code.value);
+                break;
+            }
+            case Code::OR: {
+                write(code.address, code.width, read(code.address, code.width) | code.value);
+                break;
+            }
+            case Code::AND: {
+                write(code.address, code.width, read(code.address, code.width) & code.value);
+                break;
+            }
+            case Code::ADD: {
+                write(code.address, code.width, read(code.address, code.width) + code.value);
+                break;
+            }
+            case Code::IF_EQUAL: {
+                passed = read(code.address, code.width) == code.value;
+                break;
+            }
+            case Code::IF_NOT_EQUAL: {
+                passed = read(code.address, code.width) != code.value;
+                break;
+            }
+            case Code::IF_GREATER: {
+                passed = read(code.address, code.width) > code.value;
+                break;
+            }
+            case Code::IF_LESS: {
+                passed = read(code.address, code.width) < code.value;
+                break;
+            }
+            case Code::IF_AND: {
+                passed = (read(code.address, code.width) & code.value) != 0;
+                break;
+            }
+            case Code::IF_KEYS: {
+                // KEYINPUT: 0=Pressed, 1=Released
+                passed = (~read(0x04000130, 2) & code.value) == code.value;
+                break;
+            }
+            default: {
+                // rom patches are applied by rebuild
+                break;
+            }
+        }
+        if(!passed) {
+            // skip the guarded code, and the conditions chained in front of it
+            while(i + 1 < frameCodes.size() && frameCodes[i + 1].isCondition()) {
+                i++;
+            }
+            i++;
+        }
+    }
+}
+
+void Cheats::rebuild() {
+    // undo the rom patches newest first, so an address patched twice gets its original value back
+    for(auto original = romOriginals.rbegin(); original != romOriginals.rend(); original++) {
+        bus->gamePakRom[original->first] = original->second & 0xFF;
+        bus->gamePakRom[original->first + 1] = original->second >> 8;
+    }
+    romOriginals.clear();
+    frameCodes.clear();
+
+    // later cheats override the bytes of earlier ones
+    std::map<uint32_t, uint8_t> ramBytes;
+    for(auto& [index, cheat] : cheats) {
+        if(!cheat.enabled) {
+            continue;
+        }
+        bool guarded = false;
+        for(const Code& code : cheat.codes) {
+            if(code.isCondition() || guarded) {
+                frameCodes.push_back(code);
+                guarded = code.isCondition();
+                continue;
+            }
+            if(code.type == Code::ROM_PATCH) {
+                uint32_t offset = code.address & 0x01FFFFFE;
+                if(offset + 1 < bus->gamePakRom.size()) {
+                    romOriginals.emplace_back(offset, bus->gamePakRom[offset] | (bus->gamePakRom[offset + 1] << 8));
+                    bus->gamePakRom[offset] = code.value & 0xFF;
+                    bus->gamePakRom[offset + 1] = code.value >> 8;
+                }
+                continue;
+            }
+            bool inWorkRam = code.type == Code::WRITE;
+            for(uint32_t i = 0; inWorkRam && i < code.width; i++) {
+                inWorkRam = getWorkRamAddress(code.address + i) != 0;
+            }
+            if(!inWorkRam) {
+                frameCodes.push_back(code);
+                continue;
+            }
+            for(uint32_t i = 0; i < code.width; i++) {
+                ramBytes[getWorkRamAddress(code.address + i)] = (code.value >> (i * 8)) & 0xFF;
+            }
+        }
+    }
+
+    std::vector<Bus::RamPatch> patches;
+    patches.reserve(ramBytes.size());
+    for(auto& [address, value] : ramBytes) {
+        patches.push_back({address, value});
+    }
+    bus->setRamPatches(std::move(patches));
+}
+
+bool Cheats::parse(const std::string& text, std::vector<Code>& codes) {
+    // hex tokens, either split by the usual separators or written together ("82001234 0063" or "820012340063")
+    std::vector<std::string> tokens;
+    std::string token;
+    for(size_t i = 0; i <= text.size(); i++) {
+        if(i < text.size() && isxdigit((unsigned char)text[i])) {
+            token += text[i];
+            continue;
+        }
+        if(i < text.size() && !isspace((unsigned char)text[i]) && text[i] != '+' && text[i] != ':' &&
+           text[i] != ',' && text[i] != ';') {
+            return false;
+        }
+        if(token.size() == 12 || token.size() == 16) {
+            tokens.push_back(token.substr(0, 8));
+            tokens.push_back(token.substr(8));
+        } else if(!token.empty()) {
+            tokens.push_back(token);
+        }
+        token.clear();
+    }
+    if(tokens.empty()) {
+        return false;
+    }
+
+    // the pairs are kept so that an encrypted GameShark cheat can be parsed again once decrypted, the whole cheat
+    // is either encrypted or not, which makes mistaking one for the other much less likely than code by code
+    struct Pair {
+        uint32_t op1;
+        uint32_t op2;
+        bool gameShark;
+    };
+    std::vector<Pair> pairs;
+    for(size_t i = 0; i < tokens.size(); i += 2) {
+        Pair pair;
+        if(i + 1 >= tokens.size() || tokens[i].size() != 8 || (tokens[i + 1].size() != 8 && tokens[i + 1].size() != 4) ||
+           !parseHex(tokens[i], pair.op1) || !parseHex(tokens[i + 1], pair.op2)) {
+            return false;
+        }
+        pair.gameShark = tokens[i + 1].size() == 8;
+        pairs.push_back(pair);
+    }
+
+    for(bool decrypt : {false, true}) {
+        codes.clear();
+        bool valid = true;
+        for(Pair pair : pairs) {
+            if(pair.gameShark && decrypt) {
+                decryptGameShark(pair.op1, pair.op2);
+            }
+            valid = pair.gameShark ? parseGameShark(pair.op1, pair.op2, codes) : parseCodeBreaker(pair.op1, pair.op2, codes);
+            if(!valid) {
+                break;
+            }
+        }
+        // a condition needs a code to guard, and rom patches can't be conditional
+        for(size_t i = 0; valid && i < codes.size(); i++) {
+            if(codes[i].isCondition()) {
+                valid = i + 1 < codes.size() && codes[i + 1].type != Code::ROM_PATCH;
+            }
+        }
+        if(valid) {
+            return true;
+        }
+    }
+    codes.clear();
+    return false;
+}
+
+bool Cheats::parseGameShark(uint32_t op1, uint32_t op2, std::vector<Code>& codes) {
+    uint32_t address = op1 & 0x0FFFFFFF;
+    switch(op1 >> 28) {
+        case 0x0: {
+            // 001DC0DE xxxxxxxx identifies the game
+            if(op1 == 0x001DC0DE) {
+                return true;
+            }
+            if(!isWritable(address) || op2 > 0xFF) {
+                return false;
+            }
+            codes.push_back({Code::WRITE, 1, address, op2});
+            return true;
+        }
+        case 0x1: {
+            if(!isWritable(address) || op2 > 0xFFFF) {
+                return false;
+            }
+            codes.push_back({Code::WRITE, 2, address, op2});
+            return true;
+        }
+        case 0x2: {
+            if(!isWritable(address)) {
+                return false;
+            }
+            codes.push_back({Code::WRITE, 4, address, op2});
+            return true;
+        }
+        case 0x6: {
+            if(op2 > 0xFFFF || (op1 & 0x0F000000) != 0) {
+                return false;
+            }
+            codes.push_back({Code::ROM_PATCH, 2, 0x08000000 + ((op1 & 0xFFFFFF) << 1), op2});
+            return true;
+        }
+        case 0xD: {
+            if(!isReadable(address) || op2 > 0xFFFF) {
+                return false;
+            }
+            codes.push_back({Code::IF_EQUAL, 2, address, op2});
+            return true;
+        }
+        case 0xF: {
+            // hook routine for the device, not needed here
+            return isReadable(address);
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+bool Cheats::parseCodeBreaker(uint32_t op1, uint32_t op2, std::vector<Code>& codes) {
+    uint32_t address = op1 & 0x0FFFFFFF;
+    Code::Type type;
+    uint8_t width = 2;
+    switch(op1 >> 28) {
+        case 0x0:
+        case 0x1: {
+            // master code and hook
+            return true;
+        }
+        case 0x2: {
+            type = Code::OR;
+            break;
+        }
+        case 0x3: {
+            type = Code::WRITE;
+            width = 1;
+            break;
+        }
+        case 0x6: {
+            type = Code::AND;
+            break;
+        }
+        case 0x7: {
+            type = Code::IF_EQUAL;
+            break;
+        }
+        case 0x8: {
+            type = Code::WRITE;
+            break;
+        }
+        case 0xA: {
+            type = Code::IF_NOT_EQUAL;
+            break;
+        }
+        case 0xB: {
+            type = Code::IF_GREATER;
+            break;
+        }
+        case 0xC: {
+            type = Code::IF_LESS;
+            break;
+        }
+        case 0xD: {
+            if(op1 != 0xD0000020 || op2 > 0x3FF) {
+                return false;
+            }
+            codes.push_back({Code::IF_KEYS, 2, 0x04000130, op2});
+            return true;
+        }
+        case 0xE: {
+            type = Code::ADD;
+            break;
+        }
+        case 0xF: {
+            type = Code::IF_AND;
+            break;
+        }
+        default: {
+            // encryption (9), slides (4) and super codes (5)
+            return false;
+        }
+    }
+    Code code{type, width, address, op2};
+    if(width == 1 && op2 > 0xFF) {
+        return false;
+    }
+    if(code.isCondition() ? !isReadable(address) : !isWritable(address)) {
+        return false;
+    }
+    codes.push_back(code);
+    return true;
+}
+
+void Cheats::decryptGameShark(uint32_t& op1, uint32_t& op2) {
+    uint32_t sum = 0xC6EF3720;
+    for(uint32_t i = 0; i < 32; i++) {
+        op2 -= ((op1 << 4) + GAMESHARK_SEEDS[2]) ^ (op1 + sum) ^ ((op1 >> 5) + GAMESHARK_SEEDS[3]);
+        op1 -= ((op2 << 4) + GAMESHARK_SEEDS[0]) ^ (op2 + sum) ^ ((op2 >> 5) + GAMESHARK_SEEDS[1]);
+        sum -= 0x9E3779B9;
+    }
+}
+
+uint32_t Cheats::read(uint32_t address, uint8_t width) {
+    // view has no side effects and takes no cycles
+    uint32_t word = bus->view32(address & 0xFFFFFFFC) >> ((address & 3) * 8);
+    switch(width) {
+        case 1: {
+            return word & 0xFF;
+        }
+        case 2: {
+            return word & 0xFFFF;
+        }
+        default: {
+            return word;
+        }
+    }
+}
+
+void Cheats::write(uint32_t address, uint8_t width, uint32_t value) {
+    switch(width) {
+        case 1: {
+            bus->write8(address, value, Bus::SEQUENTIAL);
+            break;
+        }
+        case 2: {
+            bus->write16(address, value, Bus::SEQUENTIAL);
+            break;
+        }
+        default: {
+            bus->write32(address, value, Bus::SEQUENTIAL);
+            break;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Bus;
+
+/*
+    GameShark / Action Replay v1-v2 (encrypted or decrypted) and CodeBreaker codes, applied where they cost nothing
+    while the game runs:
+    - unconditional writes to work ram are held by the bus (Bus::setRamPatches), which rewrites them after the
+      writes that touch them, reads are unchanged
+    - rom patches are written into the rom itself, the originals are restored when the cheat is removed
+    - everything else (conditional codes and the writes they guard, or/and/add, writes to io, vram, ...) is
+      evaluated once per frame at vblank, like the real devices do
+
+    Supported code types:
+    GameShark   0aaaaaaa 000000xx / 1aaaaaaa 0000xxxx / 2aaaaaaa xxxxxxxx   8/16/32 bit write
+                6aaaaaaa 0000xxxx                                          16 bit rom patch at 8000000h + a * 2
+                Daaaaaaa 0000xxxx                                          if 16 bit [a] == x, run the next code
+                Faaaaaaa xxxxxxxx, 001DC0DE ...                            master/hook codes, ignored
+    CodeBreaker 3aaaaaaa 00xx / 8aaaaaaa xxxx                              8/16 bit write
+                2aaaaaaa xxxx / 6aaaaaaa xxxx / Eaaaaaaa xxxx              16 bit or / and / add
+                7 / A / B / C / Faaaaaaa xxxx                              if 16 bit [a] ==, !=, >, <, & x (unsigned)
+                D0000020 xxxx                                              if the keys x are pressed
+                0aaaaaaa xxxx / 1aaaaaaa xxxx                              master/hook codes, ignored
+    Action Replay v3 codes, encryption seed changes (DEADFACE / CodeBreaker 9) and slides are rejected.
+*/
+class Cheats {
+
+    public:
+        void connectBus(std::shared_ptr<Bus> bus);
+
+        // sets the cheat at index to the codes, separated by '+', newlines or spaces (libretro joins lines with
+        // '+'). Returns false and leaves the cheat unchanged if any code can't be parsed or isn't supported.
+        // Call it from the thread running the emulation
+        bool set(uint32_t index, bool enabled, const std::string& codes);
+        void clear();
+
+        // enabled codes that are evaluated every frame
+        bool hasFrameCodes();
+        void runFrame();
+
+    private:
+        struct Code {
+            enum Type : uint8_t {
+                WRITE,
+                OR,
+                AND,
+                ADD,
+                ROM_PATCH,
+                // conditions guard the next code
+                IF_EQUAL,
+                IF_NOT_EQUAL,
+                IF_GREATER,
+                IF_LESS,
+                IF_AND,
+                IF_KEYS
+            };
+            Type type;
+            // bytes
+            uint8_t width;
+            uint32_t address;
+            uint32_t value;
+
+            bool isCondition() const;
+        };
+
+        struct Cheat {
+            bool enabled;
+            std::vector<Code> codes;
+        };
+
+        std::shared_ptr<Bus> bus;
+        std::map<uint32_t, Cheat> cheats;
+
+        std::vector<Code> frameCodes;
+        // rom offset and the halfword the patch replaced, in the order they were applied
+        std::vector<std::pair<uint32_t, uint16_t>> romOriginals;
+
+        // collects the ram patches, rom patches and frame codes of the enabled cheats
+        void rebuild();
+
+        static bool parse(const std::string& text, std::vector<Code>& codes);
+        static bool parseGameShark(uint32_t op1, uint32_t op2, std::vector<Code>& codes);
+        static bool parseCodeBreaker(uint32_t op1, uint32_t op2, std::vector<Code>& codes);
+        static void decryptGameShark(uint32_t& op1, uint32_t& op2);
+
+        uint32_t read(uint32_t address, uint8_t width);
+        void write(uint32_t address, uint8_t width, uint32_t value);
+};
@@ -0,0 +1,121 @@
+#include "ColourLut.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLOUR_LUT_AVX2 1
+#endif
+
+ColourLut::ColourLut() {
+    configure(RGBA8888, false);
+}
+
+void ColourLut::configure(Format format, bool lcdCorrection) {
+    this->format = format;
+    this->lcdCorrection = lcdCorrection;
+
+    for(uint32_t colour = 0; colour < table.size(); colour++) {
+        uint32_t r5 = colour & 0x1F;
+        uint32_t g5 = (colour >> 5) & 0x1F;
+        uint32_t b5 = (colour >> 10) & 0x1F;
+        uint32_t r;
+        uint32_t g;
+        uint32_t b;
+        if(lcdCorrection) {
+            // the LCD's response is roughly gamma 4 and its colours bleed into each other,
+            // mix in linear light and encode for a gamma 2.2 display
+            const double lcdGamma = 4.0;
+            const double outputGamma = 2.2;
+            double lr = std::pow(r5 / 31.0, lcdGamma);
+            double lg = std::pow(g5 / 31.0, lcdGamma);
+            double lb = std::pow(b5 / 31.0, lcdGamma);
+            auto encode = [&](double linear) {
+                double value = std::pow(linear / 255.0, 1.0 / outputGamma) * 255.0 * 255.0 / 280.0;
+                return (uint32_t)std::min(255.0, std::round(value));
+            };
+            r = encode(  0 * lb +  50 * lg + 255 * lr);
+            g = encode( 30 * lb + 230 * lg +  10 * lr);
+            b = encode(220 * lb +  10 * lg +  50 * lr);
+        } else {
+            r = (r5 << 3) | (r5 >> 2);
+            g = (g5 << 3) | (g5 >> 2);
+            b = (b5 << 3) | (b5 >> 2);
+        }
+
+        switch(format) {
+            case RGBA8888: {
+                table[colour] = r | (g << 8) | (b << 16) | (0xFFu << 24);
+                break;
+            }
+            case BGRA8888: {
+                table[colour] = b | (g << 8) | (r << 16) | (0xFFu << 24);
+                break;
+            }
+            case RGB565: {
+                table[colour] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                break;
+            }
+        }
+    }
+}
+
+ColourLut::Format ColourLut::getFormat() {
+    return format;
+}
+
+bool ColourLut::getLcdCorrection() {
+    return lcdCorrection;
+}
+
+uint32_t ColourLut::bytesPerPixel(Format format) {
+    return format == RGB565 ? 2 : 4;
+}
+
+#ifdef COLOUR_LUT_AVX2
+// 16 pixels per iteration, returns the number of pixels converted
+__attribute__((target("avx2")))
+static size_t convertAvx2(const uint32_t* table, const uint16_t* source, void* destination, size_t count, bool rgb565) {
+    const __m256i indexMask = _mm256_set1_epi32(0x7FFF);
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(source + i));
+        __m256i low = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(pixels)), indexMask);
+        __m256i high = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(pixels, 1)), indexMask);
+        __m256i lowColours = _mm256_i32gather_epi32((const int*)table, low, 4);
+        __m256i highColours = _mm256_i32gather_epi32((const int*)table, high, 4);
+        if(rgb565) {
+            // entries are at most 0xFFFF so the saturating pack is exact, it interleaves 128 bit lanes though
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lowColours, highColours), 0xD8);
+            _mm256_storeu_si256((__m256i*)((uint16_t*)destination + i), packed);
+        } else {
+            _mm256_storeu_si256((__m256i*)((uint32_t*)destination + i), lowColours);
+            _mm256_storeu_si256((__m256i*)((uint32_t*)destination + i + 8), highColours);
+        }
+    }
+    return i;
+}
+#endif
+
+void ColourLut::convert(const uint16_t* source, void* destination, size_t count) {
+    size_t i = 0;
+#ifdef COLOUR_LUT_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if(avx2) {
+        i = convertAvx2(table.data(), source, destination, count, format == RGB565);
+    }
+#endif
+    if(format == RGB565) {
+        uint16_t* output = (uint16_t*)destination;
+        for(; i < count; i++) {
+            output[i] = (uint16_t)table[source[i] & 0x7FFF];
+        }
+    } else {
+        uint32_t* output = (uint32_t*)destination;
+        for(; i < count; i++) {
+            output[i] = table[source[i] & 0x7FFF];
+        }
+    }
+}
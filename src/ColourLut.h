@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*
+    Output stage for frames: maps every BGR555 colour through a precomputed 32768 entry table to a host pixel format,
+    optionally with colour correction imitating the GBA LCD (darker, less saturated, with its gamma). Every format and
+    profile costs a single lookup per pixel, done with AVX2 gathers when the host supports them.
+*/
+class ColourLut {
+
+    public:
+        // in memory byte order, ie. RGBA8888 is r, g, b, a. BGRA8888 is XRGB8888 when read as a little endian word
+        enum Format {
+            RGBA8888,
+            BGRA8888,
+            RGB565
+        };
+
+        ColourLut();
+
+        // rebuilds the table
+        void configure(Format format, bool lcdCorrection);
+        Format getFormat();
+        bool getLcdCorrection();
+
+        static uint32_t bytesPerPixel(Format format);
+
+        // converted pixel in the low bytes
+        inline uint32_t lookup(uint16_t colour) {
+            return table[colour & 0x7FFF];
+        }
+
+        // converts count pixels into destination, which must hold count * bytesPerPixel(getFormat()) bytes
+        void convert(const uint16_t* source, void* destination, size_t count);
+
+    private:
+        alignas(64) std::array<uint32_t, 0x8000> table;
+        Format format = RGBA8888;
+        bool lcdCorrection = false;
+};
@@ -4,8 +4,13 @@
 #include "GameBoyAdvanceImpl.h"
 #include "PPU.h"
 #include "Scheduler.h"
+#include "Timer.h"
 #include "assert.h"
 #include "memory/EEPROM.h"
+#include "util/Log.h"
+#include "util/Serializer.h"
+
+#include <algorithm>
 
 
 // TODO: DMA specs not fully implemented yet
@@ -22,15 +27,12 @@ uint32_t DMA::dmaX(uint8_t x, bool vBlank, bool hBlank, uint16_t scanline) {
     uint8_t startTiming = (control & 0x3000) >> 12;
     if(startTiming == 3) {
         if(x == 1 || x == 2) {
-            // sound FIFO mode
-            if(false /*TODO: if soundControllerRequest*/) {
-            } else {
-                return 0;
-            }
+            // sound FIFO mode, never scheduled, the timers refill the fifos (see refillSoundFifo)
+            return 0;
         } else if(x == 3) {
             // video capture mode
             if(!hBlank) {
-                DEBUGWARN("error! videoMode dma outside of hblank, this shouldn't be happening\n");
+                LOG_WARN(DMA, "error! videoMode dma outside of hblank, this shouldn't be happening\n");
                 return 0;
             }
             if((scanline != 2)) {
@@ -46,13 +48,13 @@ uint32_t DMA::dmaX(uint8_t x, bool vBlank, bool hBlank, uint16_t scanline) {
 
     if(startTiming == 1) {
         if(!vBlank) {
-            DEBUGWARN("error! vblank dma outside of vblank, this shouldn't be happening\n");
+            LOG_WARN(DMA, "error! vblank dma outside of vblank, this shouldn't be happening\n");
             return 0;
         }
     }
     if(startTiming == 2) {
         if(!hBlank) {
-            DEBUGWARN("error! hblank dma outside of hblank, this shouldn't be happening\n");
+            LOG_WARN(DMA, "error! hblank dma outside of hblank, this shouldn't be happening\n");
         }
         if(scanline > PPU::SCREEN_HEIGHT - 1) {
             scheduleDmaX(x, (control >> 8), false);
@@ -392,6 +394,13 @@ void DMA::scheduleDmaX(uint32_t x, uint8_t upperControlByte, bool immediately) {
     // remove old event
     scheduler->removeEvent(eventType);
 
+    if((x == 1 || x == 2) && !immediately) {
+        setSoundFifoDma(x, upperControlByte);
+        if(soundFifoDma[x]) {
+            return;
+        }
+    }
+
     if((upperControlByte & 0x80) || immediately) {
         // enabling dma
         uint32_t ioRegOffset =  0xC * x;
@@ -439,4 +448,192 @@ void DMA::scheduleDmaX(uint32_t x, uint8_t upperControlByte, bool immediately) {
 
 void DMA::connectScheduler(std::shared_ptr<Scheduler> scheduler) {
     this->scheduler = scheduler;
-}
\ No newline at end of file
+}
+
+void DMA::connectTimer(std::shared_ptr<Timer> timer) {
+    this->timer = timer;
+}
+
+void DMA::updateSoundControlUponWrite(uint32_t address, uint32_t value, uint8_t width) {
+    while(width != 0) {
+        if(address == 0x4000083) {
+            uint8_t byte = value & 0xFF;
+            // the overflows so far played from the fifos with the old settings
+            timer->advanceTimers(GameBoyAdvanceImpl::cyclesSinceStart);
+
+            // Bit 10: DMA Sound A Timer Select (0=Timer 0, 1=Timer 1), Bit 11: DMA Sound A Reset FIFO (1=Reset)
+            // Bit 14: DMA Sound B Timer Select, Bit 15: DMA Sound B Reset FIFO
+            soundFifoTimer[0] = (byte >> 2) & 0x1;
+            soundFifoTimer[1] = (byte >> 6) & 0x1;
+            if(byte & 0x08) {
+                soundFifoLevel[0] = 0;
+            }
+            if(byte & 0x80) {
+                soundFifoLevel[1] = 0;
+            }
+
+            timer->scheduleTimerEvents();
+        } else if(address == 0x4000084) {
+            // SOUNDCNT_X Bit 7: PSG/FIFO Master Enable (0=Disable, 1=Enable)
+            bool enable = value & 0x80;
+            if(enable != soundMasterEnable) {
+                timer->advanceTimers(GameBoyAdvanceImpl::cyclesSinceStart);
+                soundMasterEnable = enable;
+                if(!enable) {
+                    soundFifoLevel[0] = 0;
+                    soundFifoLevel[1] = 0;
+                }
+                timer->scheduleTimerEvents();
+            }
+        }
+        width -= 8;
+        address += 1;
+        value = value >> 8;
+    }
+}
+
+void DMA::setSoundFifoDma(uint8_t x, uint8_t upperControlByte) {
+    bool enable = (upperControlByte & 0x80) && ((upperControlByte & 0x30) >> 4) == 3;
+    if(enable == soundFifoDma[x]) {
+        // rewriting the control register of an enabled channel doesn't restart it
+        return;
+    }
+
+    timer->advanceTimers(GameBoyAdvanceImpl::cyclesSinceStart);
+    if(enable) {
+        uint32_t ioRegOffset =  0xC * x;
+        uint32_t dest = (uint32_t)(bus->iORegisters[Bus::IORegister::DMA0DAD + ioRegOffset]) |
+                        ((uint32_t)(bus->iORegisters[Bus::IORegister::DMA0DAD + 1 + ioRegOffset]) << 8) |
+                        ((uint32_t)(bus->iORegisters[Bus::IORegister::DMA0DAD + 2 + ioRegOffset]) << 16) |
+                        ((uint32_t)(bus->iORegisters[Bus::IORegister::DMA0DAD + 3 + ioRegOffset]) << 24);
+        soundFifoDmaFifo[x] = ((dest & internalMemMask) == 0x4000000 + Bus::IORegister::FIFO_B) ? 1 : 0;
+    }
+    // the rest is latched on the first refill, or by dmaX if the channel leaves the sound fifo mode
+    dmaXEnabled[x] = false;
+    soundFifoDma[x] = enable;
+    timer->scheduleTimerEvents();
+}
+
+uint8_t DMA::getSoundFifoDma(uint8_t fifo) {
+    for(uint8_t x = 1; x <= 2; x++) {
+        if(soundFifoDma[x] && soundFifoDmaFifo[x] == fifo) {
+            return x;
+        }
+    }
+    return 0;
+}
+
+void DMA::soundTimerOverflow(uint8_t x, uint64_t overflows) {
+    if(!soundMasterEnable) {
+        // nothing plays, the fifos stay empty and don't request data
+        return;
+    }
+    for(uint8_t fifo = 0; fifo < 2; fifo++) {
+        if(soundFifoTimer[fifo] != x) {
+            continue;
+        }
+        uint32_t& level = soundFifoLevel[fifo];
+        while(overflows != 0) {
+            uint8_t channel = getSoundFifoDma(fifo);
+            if(channel == 0) {
+                // nothing refills it, it just runs dry
+                level = overflows >= level ? 0 : level - overflows;
+                break;
+            }
+            // an empty fifo still requests a refill on every overflow
+            uint64_t overflowsUntilRefill = level > SOUND_FIFO_REFILL_LEVEL ? level - SOUND_FIFO_REFILL_LEVEL : 1;
+            if(overflows < overflowsUntilRefill) {
+                level -= overflows;
+                break;
+            }
+            overflows -= overflowsUntilRefill;
+            level = level > overflowsUntilRefill ? level - overflowsUntilRefill : 0;
+            refillSoundFifo(channel);
+            level = std::min(level + SOUND_FIFO_REFILL_WORDS * 4, SOUND_FIFO_SIZE);
+        }
+    }
+}
+
+uint64_t DMA::getSoundFifoOverflowsUntilRefill(uint8_t x) {
+    uint64_t overflows = 0;
+    if(!soundMasterEnable) {
+        return overflows;
+    }
+    for(uint8_t fifo = 0; fifo < 2; fifo++) {
+        if(soundFifoTimer[fifo] != x || getSoundFifoDma(fifo) == 0) {
+            continue;
+        }
+        uint32_t level = soundFifoLevel[fifo];
+        uint64_t overflowsUntilRefill = level > SOUND_FIFO_REFILL_LEVEL ? level - SOUND_FIFO_REFILL_LEVEL : 1;
+        overflows = overflows == 0 ? overflowsUntilRefill : std::min(overflows, overflowsUntilRefill);
+    }
+    return overflows;
+}
+
+void DMA::refillSoundFifo(uint8_t x) {
+    uint32_t ioRegOffset =  0xC * x;
+    if(!dmaXEnabled[x]) {
+        dmaXEnabled[x] = true;
+        dmaXSourceAddr[x] = ((uint32_t)(bus->iORegisters[Bus::IORegister::DMA0SAD + ioRegOffset]) |
+                            ((uint32_t)(bus->iORegisters[Bus::IORegister::DMA0SAD + 1 + ioRegOffset]) << 8) |
+                            ((uint32_t)(bus->iORegisters[Bus::IORegister::DMA0SAD + 2 + ioRegOffset]) << 16) |
+                            ((uint32_t)(bus->iORegisters[Bus::IORegister::DMA0SAD + 3 + ioRegOffset]) << 24)) &
+                            anyMemMask;
+        soundFifoDmaControl[x] = (uint16_t)(bus->iORegisters[Bus::IORegister::DMA0CNT_H + ioRegOffset]) |
+                                 (uint16_t)(bus->iORegisters[Bus::IORegister::DMA0CNT_H + 1 + ioRegOffset] << 8);
+        // the word count and destination adjustment are ignored, 4 words always go to the fifo register.
+        // (0=Increment,1=Decrement,2=Fixed,3=prohibited)
+        switch((soundFifoDmaControl[x] & 0x0180) >> 7) {
+            case 1: {
+                soundFifoDmaSourceStep[x] = -4;
+                break;
+            }
+            case 2: {
+                soundFifoDmaSourceStep[x] = 0;
+                break;
+            }
+            default: {
+                soundFifoDmaSourceStep[x] = 4;
+                break;
+            }
+        }
+    }
+
+    // there is no sound controller to take the samples, the fifo register just holds the last word
+    uint32_t fifoRegister = soundFifoDmaFifo[x] ? Bus::IORegister::FIFO_B : Bus::IORegister::FIFO_A;
+    for(uint32_t i = 0; i < SOUND_FIFO_REFILL_WORDS; i++) {
+        uint32_t value = bus->view32(dmaXSourceAddr[x] & 0xFFFFFFFC);
+        bus->iORegisters[fifoRegister] = value;
+        bus->iORegisters[fifoRegister + 1] = value >> 8;
+        bus->iORegisters[fifoRegister + 2] = value >> 16;
+        bus->iORegisters[fifoRegister + 3] = value >> 24;
+        dmaXSourceAddr[x] += soundFifoDmaSourceStep[x];
+    }
+    GameBoyAdvanceImpl::cyclesSinceStart += SOUND_FIFO_REFILL_CYCLES;
+
+    if(soundFifoDmaControl[x] & 0x4000) {
+        cpu->queueInterrupt(x == 1 ? ARM7TDMI::Interrupt::DMA1 : ARM7TDMI::Interrupt::DMA2);
+    }
+    if(!(soundFifoDmaControl[x] & 0x0200)) {
+        // DMA Repeat off, done after one refill
+        bus->iORegisters[Bus::IORegister::DMA0CNT_H + 1 + ioRegOffset] &= 0x7F;
+        dmaXEnabled[x] = false;
+        soundFifoDma[x] = false;
+    }
+}
+
+void DMA::serialize(Serializer& serializer) {
+    serializer.array(dmaXEnabled);
+    serializer.array(dmaXSourceAddr);
+    serializer.array(dmaXDestAddr);
+    serializer.array(dmaXWordCount);
+    serializer.value(inVideoCaptureMode);
+    serializer.value(eepromBusWidthDetected);
+    serializer.array(soundFifoLevel);
+    serializer.array(soundFifoTimer);
+    serializer.value(soundMasterEnable);
+    serializer.array(soundFifoDma);
+    serializer.array(soundFifoDmaFifo);
+    serializer.array(soundFifoDmaSourceStep);
+    serializer.array(soundFifoDmaControl);
+}
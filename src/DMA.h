@@ -4,6 +4,8 @@
 class Bus;
 class ARM7TDMI;
 class Scheduler;
+class Serializer;
+class Timer;
 
 class DMA {
 
@@ -11,16 +13,36 @@ class DMA {
         void connectBus(std::shared_ptr<Bus> bus);
         void connectCpu(std::shared_ptr<ARM7TDMI> cpu);
         void connectScheduler(std::shared_ptr<Scheduler> scheduler);
+        void connectTimer(std::shared_ptr<Timer> timer);
 
         uint32_t dmaX(uint8_t x, bool vBlank, bool hBlank, uint16_t scanline);
 
         void updateDmaUponWrite(uint32_t address, uint32_t value, uint8_t width);
+        // SOUNDCNT_H (the timer that clocks each sound fifo and the fifo resets) and SOUNDCNT_X (master enable)
+        void updateSoundControlUponWrite(uint32_t address, uint32_t value, uint8_t width);
         bool eepromBusWidthDetected = true;
 
+        /*
+            Sound fifo DMA (DMA1/DMA2 with start timing 3). There is no sound controller yet, only the fifo levels
+            are modelled: while the sound master enable (SOUNDCNT_X bit 7) is set, every overflow of the timer
+            selected in SOUNDCNT_H plays one byte of the fifo, and when 16 bytes or less are left the DMA feeding it
+            refills it with 4 words. With the master enable off the fifos are empty and never request data. Refills don't go through the
+            scheduler, they are done by the timer while it accounts for the overflows (see Timer::advanceTimers).
+            The fifo a channel feeds is decoded when it is enabled and the rest of its settings on its first
+            refill, later refills only copy the words and charge their cycles at once.
+        */
+        // called with the number of overflows of timer x (0 or 1) since the last call
+        void soundTimerOverflow(uint8_t x, uint64_t overflows);
+        // overflows of timer x until the next refill, 0 if no fifo clocked by timer x is fed by a DMA
+        uint64_t getSoundFifoOverflowsUntilRefill(uint8_t x);
+
+        void serialize(Serializer& serializer);
+
     private:
         std::shared_ptr<Bus> bus;
         std::shared_ptr<ARM7TDMI> cpu;
         std::shared_ptr<Scheduler> scheduler;
+        std::shared_ptr<Timer> timer;
 
         void scheduleDmaX(uint32_t x, uint8_t upperControlByte, bool immediately);
 
@@ -39,4 +61,28 @@ class DMA {
 
         bool inVideoCaptureMode = false;
 
+        static constexpr uint32_t SOUND_FIFO_SIZE = 32;
+        static constexpr uint32_t SOUND_FIFO_REFILL_LEVEL = 16;
+        static constexpr uint32_t SOUND_FIFO_REFILL_WORDS = 4;
+        // 2 internal cycles and 2 per word, like the other transfers
+        static constexpr uint32_t SOUND_FIFO_REFILL_CYCLES = 2 + SOUND_FIFO_REFILL_WORDS * 2;
+
+        // enables the sound fifo mode of DMA x (1 or 2), or disables it if the control byte doesn't select it
+        void setSoundFifoDma(uint8_t x, uint8_t upperControlByte);
+        // the DMA feeding the fifo (DMA1 first), 0 if there is none
+        uint8_t getSoundFifoDma(uint8_t fifo);
+        void refillSoundFifo(uint8_t x);
+
+        // fifo A and B
+        uint32_t soundFifoLevel[2] = {0, 0};
+        uint8_t soundFifoTimer[2] = {0, 0};
+        // SOUNDCNT_X bit 7
+        bool soundMasterEnable = false;
+        // DMA x is in sound fifo mode
+        bool soundFifoDma[4] = {false, false, false, false};
+        // decoded on the first refill, the source address is kept in dmaXSourceAddr
+        uint8_t soundFifoDmaFifo[4] = {0, 0, 0, 0};
+        int32_t soundFifoDmaSourceStep[4] = {0, 0, 0, 0};
+        uint16_t soundFifoDmaControl[4] = {0, 0, 0, 0};
+
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Debugger.h"
 #include "arm7tdmi/ARM7TDMI.h"
 #include "memory/Bus.h"
+#include "util/Log.h"
 
 
 #define WORD_TO_BINARY_PATTERN "%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c"
@@ -184,7 +185,7 @@ std::string Debugger::disassembleArm(uint32_t instruction) {
 
             sprintf(buffer, "%s #0x%08X", (lo ? "bl lo" : "bl hi"), offset);
         } else {
-            DEBUGWARN("capstone disassemble count != 1, instead is " << count << " \n");
+            LOG_WARN(DEBUGGER, "capstone disassemble count != 1, instead is " << count << " \n");
         }
 
     }    
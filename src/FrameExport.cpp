@@ -0,0 +1,132 @@
+#include "FrameExport.h"
+#include "PPU.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+constexpr char FrameExport::MAGIC[8];
+
+static_assert(sizeof(FrameExport::Header) <= FrameExport::HEADER_SIZE, "frame export header doesn't fit");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory atomics have to be lock free");
+
+FrameExport::~FrameExport() {
+    stop();
+}
+
+bool FrameExport::start(std::string name, uint32_t slots, ColourLut::Format format) {
+    stop();
+    if(name.empty() || name[0] != '/') {
+        name = "/" + name;
+    }
+    slots = std::max(slots, 2u);
+    colourLut.configure(format, false);
+
+    uint32_t bytesPerPixel = ColourLut::bytesPerPixel(format);
+    uint32_t pixelBytes = PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT * bytesPerPixel;
+    uint32_t slotSize = SLOT_HEADER_SIZE + ((pixelBytes + 63) & ~63u);
+    size_t size = HEADER_SIZE + (size_t)slotSize * slots;
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0) {
+        std::cerr << "could not create shared memory " << name << "\n";
+        return false;
+    }
+    if(ftruncate(fd, size) != 0) {
+        std::cerr << "could not size shared memory " << name << "\n";
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED) {
+        std::cerr << "could not map shared memory " << name << "\n";
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    this->name = name;
+    this->memory = (uint8_t*)memory;
+    this->size = size;
+    frameNumber = 0;
+
+    header = new(memory) Header;
+    header->version = VERSION;
+    header->slotCount = slots;
+    header->slotSize = slotSize;
+    header->width = PPU::SCREEN_WIDTH;
+    header->height = PPU::SCREEN_HEIGHT;
+    header->bytesPerPixel = bytesPerPixel;
+    header->format = format;
+    header->closed.store(0, std::memory_order_relaxed);
+    header->latestFrame.store(0, std::memory_order_relaxed);
+    header->futexWord.store(0, std::memory_order_relaxed);
+    header->waiters.store(0, std::memory_order_relaxed);
+    for(uint32_t i = 0; i < slots; i++) {
+        new(slot(i)) SlotHeader;
+        slot(i)->sequence.store(0, std::memory_order_relaxed);
+    }
+    // readers check the magic last, so it's only there once everything else is
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    return true;
+}
+
+void FrameExport::stop() {
+    if(memory == nullptr) {
+        return;
+    }
+    header->closed.store(1, std::memory_order_release);
+    // seq_cst, orders it before the waiters load in wakeReaders (see FrameExport.h)
+    header->futexWord.fetch_add(1, std::memory_order_seq_cst);
+    wakeReaders();
+    munmap(memory, size);
+    shm_unlink(name.c_str());
+    memory = nullptr;
+    header = nullptr;
+}
+
+bool FrameExport::isActive() {
+    return memory != nullptr;
+}
+
+FrameExport::SlotHeader* FrameExport::slot(uint32_t index) {
+    return (SlotHeader*)(memory + HEADER_SIZE + (size_t)index * header->slotSize);
+}
+
+void FrameExport::publish(const uint16_t* frame, uint32_t width, uint32_t height) {
+    frameNumber++;
+    SlotHeader* slotHeader = slot(frameNumber % header->slotCount);
+
+    // odd while writing, readers that see it (or see it change) discard what they read
+    slotHeader->sequence.store(frameNumber * 2 - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    colourLut.convert(frame, (uint8_t*)slotHeader + SLOT_HEADER_SIZE, (size_t)width * height);
+    slotHeader->sequence.store(frameNumber * 2, std::memory_order_release);
+
+    header->latestFrame.store(frameNumber, std::memory_order_release);
+    // seq_cst, orders it before the waiters load in wakeReaders (see FrameExport.h)
+    header->futexWord.fetch_add(1, std::memory_order_seq_cst);
+    wakeReaders();
+}
+
+void FrameExport::wakeReaders() {
+#ifdef __linux__
+    if(header->waiters.load(std::memory_order_seq_cst) != 0) {
+        // not FUTEX_PRIVATE, the readers are other processes
+        syscall(SYS_futex, (uint32_t*)&header->futexWord, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+#endif
+}
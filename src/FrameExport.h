@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "ColourLut.h"
+
+/*
+    Publishes every completed frame into a POSIX shared memory ring, so other local processes can read frames in
+    place without any IPC serialization. The emulator never waits for readers.
+
+    Layout of the shared memory object: a Header, then slotCount slots of slotSize bytes, each a SlotHeader followed by
+    the pixels (width * height * bytesPerPixel, rows tightly packed). Frame n (counting from 1) goes into slot
+    n % slotCount and every slot is a seqlock:
+        - the writer sets sequence to an odd value, writes the pixels, then sets sequence to 2 * n
+        - a reader loads latestFrame (n), checks the slot's sequence is 2 * n, reads the pixels and checks the
+          sequence again. If it changed the frame was overwritten while reading (the reader is slotCount - 1 frames
+          behind) and must be discarded
+    futexWord is incremented after every frame. On Linux readers can block on it with FUTEX_WAIT, readers that block
+    map the object read write. The writer only makes the wake up system call while waiters is non zero, which is safe
+    because both sides order their two accesses with seq_cst (a store followed by a load needs a full barrier):
+        - writer: futexWord.fetch_add(1) (seq_cst), then waiters.load() (seq_cst), FUTEX_WAKE if it isn't 0
+        - reader: waiters.fetch_add(1) (seq_cst), then word = futexWord.load() (seq_cst), check latestFrame and
+          closed, FUTEX_WAIT(&futexWord, word) if there is nothing new, then waiters.fetch_sub(1)
+    Either the writer sees the reader in waiters and wakes it, or the reader sees the new futexWord and FUTEX_WAIT
+    returns at once, a wake up is never lost.
+    Elsewhere readers poll latestFrame. closed is set when the export stops.
+*/
+class FrameExport {
+
+    public:
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t slotCount;
+            uint32_t slotSize;
+            uint32_t width;
+            uint32_t height;
+            uint32_t bytesPerPixel;
+            // ColourLut::Format
+            uint32_t format;
+            std::atomic<uint32_t> closed;
+            std::atomic<uint64_t> latestFrame;
+            std::atomic<uint32_t> futexWord;
+            std::atomic<uint32_t> waiters;
+        };
+
+        struct SlotHeader {
+            std::atomic<uint64_t> sequence;
+        };
+
+        static constexpr char MAGIC[8] = {'G', 'B', 'A', 'F', 'R', 'A', 'M', 'E'};
+        static constexpr uint32_t VERSION = 1;
+        // slots and their pixels start on cache line boundaries
+        static constexpr uint32_t HEADER_SIZE = 64;
+        static constexpr uint32_t SLOT_HEADER_SIZE = 64;
+
+        ~FrameExport();
+
+        // name is the shared memory object ("/gba-frames" or "gba-frames"), replaced if it exists.
+        // Returns false if it can't be created
+        bool start(std::string name, uint32_t slots, ColourLut::Format format);
+        // marks the ring closed and unlinks it, readers that have it mapped keep their mapping
+        void stop();
+        bool isActive();
+
+        void publish(const uint16_t* frame, uint32_t width, uint32_t height);
+
+    private:
+        std::string name;
+        uint8_t* memory = nullptr;
+        size_t size = 0;
+        Header* header = nullptr;
+        uint64_t frameNumber = 0;
+        ColourLut colourLut;
+
+        SlotHeader* slot(uint32_t index);
+        void wakeReaders();
+};
@@ -1,6 +1,7 @@
 
 #include "../include/GameBoyAdvance.hpp"
 #include "GameBoyAdvanceImpl.h"
+#include "RamSearch.h"
 #include <iostream>
 
 
@@ -25,6 +26,122 @@ void GameBoyAdvance::printCpuState() {
     pimpl->printCpuState();
 } 
 
+void GameBoyAdvance::setKeyState(uint16_t keys) {
+    pimpl->setKeyState(keys);
+}
+
+void GameBoyAdvance::setInputSampleInterval(uint32_t scanlines) {
+    pimpl->setInputSampleInterval(scanlines);
+}
+
+void GameBoyAdvance::setColourCorrection(bool enabled) {
+    pimpl->setColourCorrection(enabled);
+}
+
+ColourLut::Format toColourLutFormat(GameBoyAdvance::PixelFormat format) {
+    switch(format) {
+        case GameBoyAdvance::PixelFormat::BGRA8888: {
+            return ColourLut::BGRA8888;
+        }
+        case GameBoyAdvance::PixelFormat::RGB565: {
+            return ColourLut::RGB565;
+        }
+        default: {
+            return ColourLut::RGBA8888;
+        }
+    }
+}
+
+void GameBoyAdvance::setPixelFormat(PixelFormat format) {
+    pimpl->setPixelFormat(toColourLutFormat(format));
+}
+
+void GameBoyAdvance::setUpscaleFilter(UpscaleFilter filter, uint32_t scale) {
+    switch(filter) {
+        case UpscaleFilter::NONE: {
+            pimpl->setUpscaleFilter(Upscaler::NONE, scale);
+            break;
+        }
+        case UpscaleFilter::NEAREST: {
+            pimpl->setUpscaleFilter(Upscaler::NEAREST, scale);
+            break;
+        }
+        case UpscaleFilter::SCALE2X: {
+            pimpl->setUpscaleFilter(Upscaler::SCALE2X, scale);
+            break;
+        }
+        case UpscaleFilter::SCALE3X: {
+            pimpl->setUpscaleFilter(Upscaler::SCALE3X, scale);
+            break;
+        }
+        case UpscaleFilter::XBR2X: {
+            pimpl->setUpscaleFilter(Upscaler::XBR2X, scale);
+            break;
+        }
+    }
+}
+
+void GameBoyAdvance::setWarmStart(std::string directory, uint32_t frame) {
+    pimpl->setWarmStart(directory, frame);
+}
+
+bool GameBoyAdvance::setCheat(uint32_t index, bool enabled, std::string codes) {
+    return pimpl->setCheat(index, enabled, codes);
+}
+
+void GameBoyAdvance::clearCheats() {
+    pimpl->clearCheats();
+}
+
+void GameBoyAdvance::startRamSearch(uint32_t width, bool isSigned) {
+    pimpl->getRamSearch()->reset(width, isSigned);
+}
+
+// the enums are in the same order
+size_t GameBoyAdvance::filterRamSearch(SearchComparison comparison) {
+    return pimpl->getRamSearch()->filterPrevious((RamSearch::Comparison)comparison);
+}
+
+size_t GameBoyAdvance::filterRamSearchValue(SearchComparison comparison, uint32_t value) {
+    return pimpl->getRamSearch()->filterValue((RamSearch::Comparison)comparison, value);
+}
+
+std::vector<GameBoyAdvance::SearchCandidate> GameBoyAdvance::getRamSearchCandidates(size_t max) {
+    std::vector<SearchCandidate> result;
+    for(RamSearch::Candidate& candidate : pimpl->getRamSearch()->getCandidates(max)) {
+        result.push_back({candidate.address, candidate.value, candidate.previous});
+    }
+    return result;
+}
+
+void GameBoyAdvance::setRenderThreads(uint32_t threads) {
+    pimpl->setRenderThreads(threads);
+}
+
+void GameBoyAdvance::getFrame(void* buffer) {
+    pimpl->getFrame(buffer);
+}
+
+bool GameBoyAdvance::startCapture(std::string videoPath, std::string audioPath, bool blockWhenFull) {
+    return pimpl->startCapture(videoPath, audioPath, blockWhenFull);
+}
+
+void GameBoyAdvance::stopCapture() {
+    pimpl->stopCapture();
+}
+
+bool GameBoyAdvance::startFrameExport(std::string name, uint32_t slots, PixelFormat format) {
+    return pimpl->startFrameExport(name, slots, toColourLutFormat(format));
+}
+
+void GameBoyAdvance::stopFrameExport() {
+    pimpl->stopFrameExport();
+}
+
+bool GameBoyAdvance::linkWith(GameBoyAdvance& other) {
+    return pimpl->connectLinkCable(other.pimpl->getLinkCable());
+}
+
 void GameBoyAdvance::runRom() {
     pimpl->enterMainLoop();
 }
@@ -6,6 +6,7 @@
 #include <iterator>
 #include <chrono>
 #include <algorithm> 
+#include <cstring>
 
 #include "arm7tdmi/ARM7TDMI.h"
 #include "memory/Bus.h"
@@ -15,10 +16,20 @@
 #include "DMA.h"
 #include "Timer.h"
 #include "Debugger.h"
+#include "Serial.h"
+#include "LinkCable.h"
+#include "VideoTiming.h"
+#include "Capture.h"
+#include "FrameExport.h"
+#include "WarmStart.h"
+#include "Cheats.h"
+#include "RamSearch.h"
+#include "util/Serializer.h"
+#include "util/Log.h"
 
 using milliseconds = std::chrono::milliseconds;
 
-uint64_t GameBoyAdvanceImpl::cyclesSinceStart = 0;
+thread_local uint64_t GameBoyAdvanceImpl::cyclesSinceStart = 0;
 
 GameBoyAdvanceImpl::GameBoyAdvanceImpl() {
     this->arm7tdmi = std::make_shared<ARM7TDMI>();
@@ -36,10 +47,35 @@ GameBoyAdvanceImpl::GameBoyAdvanceImpl() {
     this->timer->connectBus(bus);
     bus->connectTimer(timer);
     this->timer->connectCpu(arm7tdmi);
+    this->timer->connectDma(dma);
+    dma->connectTimer(timer);
     this->scheduler =  std::make_shared<Scheduler>();
     dma->connectScheduler(scheduler);
     timer->connectScheduler(scheduler);
     this->debugger =  std::make_shared<Debugger>();
+    this->gamepad = std::make_shared<Gamepad>();
+    gamepad->connectBus(bus);
+    gamepad->connectCpu(arm7tdmi);
+    gamepad->connectScheduler(scheduler);
+    bus->connectGamepad(gamepad);
+    this->serial = std::make_shared<Serial>();
+    serial->connectBus(bus);
+    serial->connectCpu(arm7tdmi);
+    serial->connectScheduler(scheduler);
+    bus->connectSerial(serial);
+    this->videoTiming = std::make_shared<VideoTiming>();
+    videoTiming->connectBus(bus);
+    videoTiming->connectCpu(arm7tdmi);
+    videoTiming->connectPpu(ppu);
+    videoTiming->connectScheduler(scheduler);
+    this->capture = std::make_shared<Capture>();
+    this->frameColourLut = std::make_shared<ColourLut>();
+    this->frameExport = std::make_shared<FrameExport>();
+    this->warmStart = std::make_shared<WarmStart>();
+    this->cheats = std::make_shared<Cheats>();
+    cheats->connectBus(bus);
+    this->ramSearch = std::make_shared<RamSearch>(bus.get());
+    measureStateSize();
 }
 
 void GameBoyAdvanceImpl::printCpuState() {\
@@ -57,9 +93,205 @@ bool GameBoyAdvanceImpl::loadRom(std::string path) {
     }
     std::vector<uint8_t> buffer(std::istreambuf_iterator<char>(binFile), {});
     
+    loadRom(buffer);
+    return true;
+}
+
+void GameBoyAdvanceImpl::loadRom(std::vector<uint8_t>& buffer) {
+    cheats->clear();
     bus->loadRom(buffer); 
     arm7tdmi->initializeWithRom();
-    return true;
+    // once per rom instead of in every saveState and loadState
+    measureStateSize();
+    bootSnapshot = takeSnapshot();
+
+    warmStartPending = false;
+    if(warmStart->isEnabled()) {
+        std::vector<uint8_t> state = warmStart->open(buffer, getStateSize());
+        if(!state.empty() && loadState(state.data(), state.size())) {
+            LOG_INFO(GENERAL, "started from the warm start state\n");
+        } else {
+            warmStartPending = true;
+            bus->keypadRead = false;
+        }
+    }
+}
+
+void GameBoyAdvanceImpl::setSkipRendering(bool skip) {
+    ppu->setSkipRendering(skip);
+}
+
+void GameBoyAdvanceImpl::setRenderThreads(uint32_t threads) {
+    ppu->setRenderThreads(threads);
+}
+
+void GameBoyAdvanceImpl::setKeyState(uint16_t keys) {
+    keyboardInput = false;
+    gamepad->setKeyState(keys);
+}
+
+void GameBoyAdvanceImpl::setInputSampleInterval(uint32_t scanlines) {
+    gamepad->setSampleInterval(scanlines);
+}
+
+std::shared_ptr<LinkCable> GameBoyAdvanceImpl::getLinkCable() {
+    if(!serial->getLinkCable()) {
+        serial->connectLinkCable(std::make_shared<LinkCable>());
+    }
+    return serial->getLinkCable();
+}
+
+bool GameBoyAdvanceImpl::connectLinkCable(std::shared_ptr<LinkCable> linkCable) {
+    return serial->connectLinkCable(linkCable);
+}
+
+void GameBoyAdvanceImpl::setColourCorrection(bool enabled) {
+    screen->setColourCorrection(enabled);
+    frameColourLut->configure(frameColourLut->getFormat(), enabled);
+}
+
+void GameBoyAdvanceImpl::setPixelFormat(ColourLut::Format format) {
+    frameColourLut->configure(format, frameColourLut->getLcdCorrection());
+}
+
+void GameBoyAdvanceImpl::setUpscaleFilter(Upscaler::Filter filter, uint32_t scale) {
+    screen->setUpscaleFilter(filter, scale);
+}
+
+void GameBoyAdvanceImpl::getFrame(void* buffer) {
+    frameColourLut->convert(ppu->pixelBuffer.data(), buffer, ppu->pixelBuffer.size());
+}
+
+bool GameBoyAdvanceImpl::startCapture(std::string videoPath, std::string audioPath, bool blockWhenFull) {
+    Capture::Options options;
+    options.videoPath = videoPath;
+    options.audioPath = audioPath;
+    options.blockWhenFull = blockWhenFull;
+    return capture->start(options);
+}
+
+void GameBoyAdvanceImpl::stopCapture() {
+    capture->stop();
+}
+
+bool GameBoyAdvanceImpl::startFrameExport(std::string name, uint32_t slots, ColourLut::Format format) {
+    return frameExport->start(name, slots, format);
+}
+
+void GameBoyAdvanceImpl::stopFrameExport() {
+    frameExport->stop();
+}
+
+struct StateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+};
+
+static constexpr char STATE_MAGIC[8] = {'G', 'B', 'A', 'S', 'T', 'A', 'T', 'E'};
+
+void GameBoyAdvanceImpl::measureStateSize() {
+    Serializer serializer(Serializer::MEASURE);
+    serialize(serializer);
+    stateSize = sizeof(StateHeader) + serializer.getOffset();
+}
+
+size_t GameBoyAdvanceImpl::getStateSize() {
+    return stateSize;
+}
+
+bool GameBoyAdvanceImpl::saveState(void* buffer, size_t size) {
+    if(size < stateSize) {
+        return false;
+    }
+    StateHeader header;
+    memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.version = STATE_VERSION;
+    header.size = stateSize;
+    memcpy(buffer, &header, sizeof(header));
+
+    Serializer serializer(Serializer::SAVE, (uint8_t*)buffer + sizeof(header), stateSize - sizeof(header));
+    serialize(serializer);
+    return !serializer.hasFailed();
+}
+
+bool GameBoyAdvanceImpl::loadState(const void* buffer, size_t size) {
+    // everything is checked up front, a state that fails half way would leave a broken machine
+    StateHeader header;
+    if(size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    if(memcmp(header.magic, STATE_MAGIC, sizeof(header.magic)) != 0 || header.version != STATE_VERSION ||
+       header.size != stateSize || size < stateSize) {
+        LOG_WARN(GENERAL, "incompatible save state\n");
+        return false;
+    }
+
+    Serializer serializer(Serializer::LOAD, (uint8_t*)buffer + sizeof(header), stateSize - sizeof(header));
+    serialize(serializer);
+    // the state's work ram replaced the bytes held by cheats
+    bus->applyRamPatches();
+    return !serializer.hasFailed();
+}
+
+std::vector<uint8_t> GameBoyAdvanceImpl::takeSnapshot() {
+    std::vector<uint8_t> snapshot(getStateSize());
+    saveState(snapshot.data(), snapshot.size());
+    return snapshot;
+}
+
+bool GameBoyAdvanceImpl::resetTo(const std::vector<uint8_t>& snapshot) {
+    return loadState(snapshot.data(), snapshot.size());
+}
+
+bool GameBoyAdvanceImpl::reset() {
+    return resetTo(bootSnapshot);
+}
+
+bool GameBoyAdvanceImpl::setCheat(uint32_t index, bool enabled, std::string codes) {
+    return cheats->set(index, enabled, codes);
+}
+
+void GameBoyAdvanceImpl::clearCheats() {
+    cheats->clear();
+}
+
+RamSearch* GameBoyAdvanceImpl::getRamSearch() {
+    return ramSearch.get();
+}
+
+void GameBoyAdvanceImpl::setWarmStart(std::string directory, uint32_t frame) {
+    warmStart->configure(directory, frame);
+}
+
+void GameBoyAdvanceImpl::storeWarmStart() {
+    bool triggered = warmStart->getFrame() == 0 ? bus->keypadRead : frames >= warmStart->getFrame();
+    if(triggered) {
+        warmStart->store(takeSnapshot());
+        warmStartPending = false;
+    }
+}
+
+void GameBoyAdvanceImpl::serialize(Serializer& serializer) {
+    // thread local, copied so it can be read and written like any other value
+    uint64_t cycles = cyclesSinceStart;
+    serializer.value(cycles);
+    serializer.value(instructionsExecuted);
+    serializer.value(frames);
+    serializer.value(eventsInitialized);
+    arm7tdmi->serialize(serializer);
+    bus->serialize(serializer);
+    ppu->serialize(serializer);
+    dma->serialize(serializer);
+    timer->serialize(serializer);
+    scheduler->serialize(serializer);
+    gamepad->serialize(serializer);
+    serial->serialize(serializer);
+    videoTiming->serialize(serializer);
+    if(serializer.isLoading()) {
+        cyclesSinceStart = cycles;
+    }
 }
 
 void GameBoyAdvanceImpl::testDisplay() {
@@ -74,30 +306,77 @@ uint64_t GameBoyAdvanceImpl::getTotalCyclesElapsed() {
     return totalCycles;
 }
 
-void GameBoyAdvanceImpl::enterMainLoop() {
-    screen->initWindow();
+void GameBoyAdvanceImpl::setHeadless(bool headless) {
+    this->headless = headless;
+    if(headless) {
+        keyboardInput = false;
+    }
+}
+
+void GameBoyAdvanceImpl::setProfiling(bool profiling) {
+    this->profiling = profiling;
+}
+
+GameBoyAdvanceImpl::Profile GameBoyAdvanceImpl::getProfile() {
+    return profile;
+}
+
+uint64_t GameBoyAdvanceImpl::getInstructionsExecuted() {
+    return instructionsExecuted;
+}
+
+void GameBoyAdvanceImpl::setFastPaths(FastPaths fastPaths) {
+    this->fastPaths = fastPaths;
+    ppu->setLazyRendering(fastPaths.lazyRendering);
+}
+
+uint64_t getCurrentTimeNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void GameBoyAdvanceImpl::initializeEvents() {
     // add initial events
-    scheduler->addEvent(Scheduler::EventType::HBLANK, PPU::H_VISIBLE_CYCLES, Scheduler::EventCondition::NULL_CONDITION, false);
-    scheduler->addEvent(Scheduler::EventType::VBLANK, PPU::V_VISIBLE_CYCLES, Scheduler::EventCondition::NULL_CONDITION, false);
-    scheduler->addEvent(Scheduler::EventType::HBLANK_END, 0, Scheduler::EventCondition::NULL_CONDITION, false);
-    scheduler->addEvent(Scheduler::EventType::VBLANK_END, 227 * PPU::H_TOTAL, Scheduler::EventCondition::NULL_CONDITION, false);
-    bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x1);
-    bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x2);
-
-    uint16_t currentScanline = -1;
-    uint16_t nextScanline = 0;
-    uint64_t cyclesSinceLastScanline = 0;
+    videoTiming->start();
+    gamepad->startSampling();
+    serial->scheduleSerialEvent();
+
     previousTime = getCurrentTime();
-    double previous60Frame = getCurrentTime();
+    previous60Frame = getCurrentTime();
     startTimeSeconds = getCurrentTime() / 1000.0;
+    eventsInitialized = true;
+}
 
-    // TODO: initialize this somewhere else
-    bus->iORegisters[Bus::IORegister::KEYINPUT] = 0xFF;
-    bus->iORegisters[Bus::IORegister::KEYINPUT + 1] = 0x03;
-    double fps = 60.0;
+void GameBoyAdvanceImpl::enterMainLoop() {
+    screen->initWindow();
 
     // STARTING MAIN EMULATION LOOP!
     while(true) {
+        runFrame();
+    }
+}
+
+void GameBoyAdvanceImpl::runFrame() {
+    frameCompleted = false;
+    run(UINT64_MAX);
+}
+
+void GameBoyAdvanceImpl::runInstructions(uint64_t instructions) {
+    uint64_t instructionLimit = instructionsExecuted + instructions;
+    while(instructionsExecuted < instructionLimit) {
+        frameCompleted = false;
+        run(instructionLimit);
+    }
+}
+
+void GameBoyAdvanceImpl::run(uint64_t instructionLimit) {
+    if(!eventsInitialized) {
+        initializeEvents();
+    }
+
+    uint64_t frameStart = profiling ? getCurrentTimeNanoseconds() : 0;
+    uint64_t eventNanoseconds = 0;
+
+    while(!frameCompleted && instructionsExecuted < instructionLimit) {
         if(debugMode) {
             debugger->step(arm7tdmi.get(), bus.get());
             if(Debugger::stepMode) {
@@ -116,163 +395,185 @@ void GameBoyAdvanceImpl::enterMainLoop() {
             }
         }
 
-       if(!bus->haltMode) {
+       if(!bus->haltMode && !bus->stopMode) {
             uint32_t cpuCycles = arm7tdmi->step();
             cyclesSinceStart += cpuCycles;
+            instructionsExecuted++;
+        } else if(bus->stopMode) {
+            if(((bus->iORegisters[Bus::IORegister::IE] & bus->iORegisters[Bus::IORegister::IF]) & 0x80) ||
+               ((bus->iORegisters[Bus::IORegister::IE + 1] & bus->iORegisters[Bus::IORegister::IF + 1]) & 0x30)) {
+                // stop mode over, serial, keypad or game pak interrupt fired
+                bus->stopMode = false;
+            } else if(fastPaths.idleSkip) {
+                // skip to next event
+                cyclesSinceStart = scheduler->peekNextEvent()->startCycle;
+            } else {
+                cyclesSinceStart++;
+            }
         } else {
             if(((bus->iORegisters[Bus::IORegister::IE] & bus->iORegisters[Bus::IORegister::IF]) || 
                ((bus->iORegisters[Bus::IORegister::IE + 1] & 0x3F) & (bus->iORegisters[Bus::IORegister::IF + 1] & 0x3F)))) {
                 // halt mode over, interrupt fired
                 bus->haltMode = false;
-            } else {
+            } else if(fastPaths.idleSkip) {
                 // skip to next event
                 cyclesSinceStart = scheduler->peekNextEvent()->startCycle;
+            } else {
+                cyclesSinceStart++;
             }
         }
 
         Scheduler::Event* nextEvent = scheduler->getNextEvent(cyclesSinceStart);
         
         while(nextEvent != nullptr) {
-            uint64_t eventCycles = 0;
-            switch(nextEvent->eventType) {
-                case Scheduler::EventType::DMA0: {
-                    dmaXEvent(0, nextEvent, currentScanline);
-                    break;
-                }
-                case Scheduler::EventType::DMA1: {
-                    dmaXEvent(1, nextEvent, currentScanline);             
-                    break;
-                }
-                case Scheduler::EventType::DMA2: {
-                    dmaXEvent(2, nextEvent, currentScanline);                 
-                    break;
-                }
-                case Scheduler::EventType::DMA3: {
-                    dmaXEvent(3, nextEvent, currentScanline);
-                    break;
-                }
-                case Scheduler::EventType::TIMER0: {
-                    timer->timerXOverflowEvent(0);
-                    break;
-                }
-                case Scheduler::EventType::TIMER1: {
-                    timer->timerXOverflowEvent(1);
-                    break;
-                }
-                case Scheduler::EventType::TIMER2: {
-                    timer->timerXOverflowEvent(2);
-                    break;
-                }
-                case Scheduler::EventType::TIMER3: {
-                    timer->timerXOverflowEvent(3);
-                    break;
-                }
-                case Scheduler::EventType::VBLANK: {
-                    // vblank time!
-                    // (do frame stuff)
-                    // TODO: put some of this stuff to separate methods / classes
-                    if(bus->iORegisters[Bus::IORegister::DISPSTAT] & 0x8) {
-                        arm7tdmi->queueInterrupt(ARM7TDMI::Interrupt::VBlank);
-                    }
-                    Gamepad::getInput(bus.get());
+            if(profiling) {
+                uint64_t eventStart = getCurrentTimeNanoseconds();
+                handleEvent(nextEvent);
+                uint64_t elapsed = getCurrentTimeNanoseconds() - eventStart;
+                addEventProfile(nextEvent->eventType, elapsed);
+                eventNanoseconds += elapsed;
+            } else {
+                handleEvent(nextEvent);
+            }
+            nextEvent = scheduler->getNextEvent(cyclesSinceStart);
+        }
+    }
 
-                    // setting vblank flag to 1
-                    bus->iORegisters[Bus::IORegister::DISPSTAT] |= 0x1;
+    if(warmStartPending && frameCompleted) {
+        // between frames, like any other save state
+        storeWarmStart();
+    }
 
-                    frames++;
-                    
-                    while(getCurrentTime() - previousTime < 17) {
-                        usleep(500);
-                    }
+    if(profiling) {
+        // everything that isn't an event is the cpu (including skipping ahead while halted)
+        profile.cpu += (getCurrentTimeNanoseconds() - frameStart) - eventNanoseconds;
+    }
+}
 
-                    if((frames % 60) == 0) {
-                        double smoothing = 0.8;
-                        fps = fps * smoothing + ((double)60 / ((getCurrentTime() / 1000.0 - previous60Frame / 1000.0))) * (1.0 - smoothing);
-                        std::cout << "fps: " << fps << "\n";
-                        previous60Frame = previousTime;
-                    }
+void GameBoyAdvanceImpl::addEventProfile(Scheduler::EventType eventType, uint64_t nanoseconds) {
+    switch(eventType) {
+        case Scheduler::EventType::HBLANK:
+        case Scheduler::EventType::HBLANK_END: {
+            profile.video += nanoseconds;
+            break;
+        }
+        case Scheduler::EventType::TIMER0:
+        case Scheduler::EventType::TIMER1:
+        case Scheduler::EventType::TIMER2:
+        case Scheduler::EventType::TIMER3: {
+            profile.timers += nanoseconds;
+            break;
+        }
+        case Scheduler::EventType::DMA0:
+        case Scheduler::EventType::DMA1:
+        case Scheduler::EventType::DMA2:
+        case Scheduler::EventType::DMA3: {
+            profile.dma += nanoseconds;
+            break;
+        }
+        default: {
+            profile.other += nanoseconds;
+            break;
+        }
+    }
+}
 
-                    previousTime = getCurrentTime();
-                    screen->drawWindow(ppu->renderCurrentScreen());  
+void GameBoyAdvanceImpl::presentFrame(std::array<uint16_t, 38400>& frame) {
+    while(getCurrentTime() - previousTime < 17) {
+        usleep(500);
+    }
 
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Z)) {
-                        std::cout << "Entering DEBUG mode! Press LSHIFT to step through CPU instructions\n";
-                        debugMode = true;
-                        Debugger::stepMode = true;
-                    }
-                    // add next vblank event
-                    scheduler->addEvent(Scheduler::EventType::VBLANK, 
-                                        PPU::V_TOTAL - ((cyclesSinceStart + PPU::V_VISIBLE_CYCLES) % PPU::V_TOTAL), 
-                                        Scheduler::EventCondition::NULL_CONDITION, 
-                                        false);                    
-                    break;
-                }
-                case Scheduler::EventType::HBLANK: {      
-                    // hblank time!
-                    if(bus->iORegisters[Bus::IORegister::DISPSTAT] & 0x10) {
-                        arm7tdmi->queueInterrupt(ARM7TDMI::Interrupt::HBlank);
-                    }
-                    bus->iORegisters[Bus::IORegister::DISPSTAT] |= 0x2;
-
-                    // add next hblank event
-                    scheduler->addEvent(Scheduler::EventType::HBLANK,
-                                        PPU::H_TOTAL - ((cyclesSinceStart + PPU::H_VISIBLE_CYCLES) % PPU::H_TOTAL), 
-                                        Scheduler::EventCondition::NULL_CONDITION,
-                                        false);
-                    
-                    break;
-                }
-                case Scheduler::EventType::VBLANK_END: {
-                    bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x1);
-                    // add next vblank end event
-                    scheduler->addEvent(Scheduler::EventType::VBLANK_END, 
-                                        PPU::V_TOTAL - (cyclesSinceStart % PPU::V_TOTAL), 
-                                        Scheduler::EventCondition::NULL_CONDITION, 
-                                        false);
-                    break;
-                }
-                case Scheduler::EventType::HBLANK_END: {
-                    ppu->renderScanline(currentScanline);
-                    // setting hblank flag to 0
-                    currentScanline += (cyclesSinceStart - cyclesSinceLastScanline) / PPU::H_TOTAL;    
-                    cyclesSinceLastScanline = cyclesSinceStart - (cyclesSinceStart % PPU::H_TOTAL);
-                    currentScanline %= 228;
-                    nextScanline = (currentScanline + 1) % 228;
-
-                    
-                    
-                    bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x2);
-                    if(currentScanline == ((uint16_t)(bus->iORegisters[Bus::IORegister::DISPSTAT + 1]))) {
-                        // current scanline == vcount bits in DISPSTAT
-                        // set vcounter flag
-                        bus->iORegisters[Bus::IORegister::DISPSTAT] |= 0x04;
-                        if(bus->iORegisters[Bus::IORegister::DISPSTAT] & 0x20) {
-                            // if vcount irq enabled, queue the interrupt!
-                            arm7tdmi->queueInterrupt(ARM7TDMI::Interrupt::VCounterMatch);
-                        }
-                    } else {
-                        // toggle vcounter flag off
-                        bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x04);
+    if((frames % 60) == 0) {
+        double smoothing = 0.8;
+        fps = fps * smoothing + ((double)60 / ((getCurrentTime() / 1000.0 - previous60Frame / 1000.0))) * (1.0 - smoothing);
+        std::cout << "fps: " << fps << "\n";
+        previous60Frame = previousTime;
+    }
 
-                    }
+    previousTime = getCurrentTime();
+    screen->drawWindow(frame, ppu->getChangedLines());
+
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Z)) {
+        std::cout << "Entering DEBUG mode! Press LSHIFT to step through CPU instructions\n";
+        debugMode = true;
+        Debugger::stepMode = true;
+    }
+}
 
-                    bus->iORegisters[Bus::IORegister::VCOUNT] = currentScanline;
-
-                    // add next hblank end event
-                    scheduler->addEvent(Scheduler::EventType::HBLANK_END, 
-                                        PPU::H_TOTAL - (cyclesSinceStart % PPU::H_TOTAL), 
-                                        Scheduler::EventCondition::NULL_CONDITION, 
-                                        false);
-                    break;
-                }
-                default: {
-                    break;
-                    //assert(false);
-                }
+void GameBoyAdvanceImpl::handleEvent(Scheduler::Event* nextEvent) {
+    switch(nextEvent->eventType) {
+        case Scheduler::EventType::DMA0: {
+            dmaXEvent(0, nextEvent, videoTiming->getScanline());
+            break;
+        }
+        case Scheduler::EventType::DMA1: {
+            dmaXEvent(1, nextEvent, videoTiming->getScanline());             
+            break;
+        }
+        case Scheduler::EventType::DMA2: {
+            dmaXEvent(2, nextEvent, videoTiming->getScanline());                 
+            break;
+        }
+        case Scheduler::EventType::DMA3: {
+            dmaXEvent(3, nextEvent, videoTiming->getScanline());
+            break;
+        }
+        case Scheduler::EventType::TIMER0: {
+            timer->timerXOverflowEvent(0);
+            break;
+        }
+        case Scheduler::EventType::TIMER1: {
+            timer->timerXOverflowEvent(1);
+            break;
+        }
+        case Scheduler::EventType::TIMER2: {
+            timer->timerXOverflowEvent(2);
+            break;
+        }
+        case Scheduler::EventType::TIMER3: {
+            timer->timerXOverflowEvent(3);
+            break;
+        }
+        case Scheduler::EventType::HBLANK:
+        case Scheduler::EventType::HBLANK_END: {
+            if(!videoTiming->transitionEvent()) {
+                break;
             }
-            nextEvent = scheduler->getNextEvent(cyclesSinceStart);
+            // vblank started, the frame is complete
+            frames++;
+            frameCompleted = true;
+            if(cheats->hasFrameCodes()) {
+                cheats->runFrame();
+            }
+
+            std::array<uint16_t, 38400>& frame = ppu->renderCurrentScreen();
+            if(capture->isActive()) {
+                capture->pushFrame(frame, ppu->getChangedLines().any());
+            }
+            if(frameExport->isActive()) {
+                frameExport->publish(frame.data(), PPU::SCREEN_WIDTH, PPU::SCREEN_HEIGHT);
+            }
+            if(!headless) {
+                presentFrame(frame);
+            }
+            break;
+        }
+        case Scheduler::EventType::KEYPAD: {
+            if(keyboardInput) {
+                // read at every sample point, so shorter sample intervals see key changes within the frame
+                gamepad->setKeyState(Gamepad::pollKeyboard());
+            }
+            gamepad->sampleInputEvent();
+            break;
+        }
+        case Scheduler::EventType::SERIAL: {
+            serial->serialEvent();
+            break;
+        }
+        default: {
+            break;
+            //assert(false);
         }
-        
     }
 }
 
@@ -281,6 +582,14 @@ ARM7TDMI* GameBoyAdvanceImpl::getCpu() {
     return arm7tdmi.get();
 }
 
+Bus* GameBoyAdvanceImpl::getBus() {
+    return bus.get();
+}
+
+PPU* GameBoyAdvanceImpl::getPpu() {
+    return ppu.get();
+}
+
 
 inline 
 void GameBoyAdvanceImpl::dmaXEvent(uint8_t x, Scheduler::Event* dmaEvent, uint16_t currentScanline) {
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <array>
+#include <vector>
 #include <string>
 #include <memory>
 #include "Scheduler.h"
+#include "ColourLut.h"
+#include "Upscaler.h"
 
 class ARM7TDMI;
 class Bus;
@@ -11,6 +15,16 @@ class PPU;
 class DMA;
 class Timer;
 class Debugger;
+class Gamepad;
+class Serial;
+class LinkCable;
+class VideoTiming;
+class Capture;
+class FrameExport;
+class WarmStart;
+class Cheats;
+class RamSearch;
+class Serializer;
 
 
 class GameBoyAdvanceImpl {
@@ -19,12 +33,105 @@ class GameBoyAdvanceImpl {
     GameBoyAdvanceImpl();
 
     bool loadRom(std::string path);
+    void loadRom(std::vector<uint8_t>& buffer);
     void enterMainLoop();
+    // runs until the current frame is completed (the next vblank)
+    void runFrame();
+    // runs until the given number of instructions have been executed, frames completed on the way are presented
+    void runInstructions(uint64_t instructions);
     void printCpuState();
 
+    // no window, frame limiting or keyboard input, for benchmarks and tests
+    void setHeadless(bool headless);
+
+    // host time spent per subsystem in nanoseconds, only recorded while profiling is enabled
+    struct Profile {
+        uint64_t cpu = 0;
+        // video timing events, scanline rendering and frame presentation
+        uint64_t video = 0;
+        uint64_t timers = 0;
+        uint64_t dma = 0;
+        uint64_t other = 0;
+    };
+    void setProfiling(bool profiling);
+    Profile getProfile();
+
+    uint64_t getInstructionsExecuted();
+
+    // shortcuts that must not change emulated behaviour, they can be turned off to get the plain
+    // reference behaviour for differential testing (see test/testLockstep.cpp)
+    struct FastPaths {
+        // while halted or stopped, jump straight to the next event instead of idling cycle by cycle
+        bool idleSkip = true;
+        // render scanlines in batches when something they depend on changes instead of at the end of every line
+        bool lazyRendering = true;
+    };
+    void setFastPaths(FastPaths fastPaths);
+
+    // frames completed while set are not rendered, the last rendered frame is presented again (for fast forwarding).
+    // Takes effect from the next frame
+    void setSkipRendering(bool skip);
+    // threads rendering each frame, see PPU::setRenderThreads
+    void setRenderThreads(uint32_t threads);
+
+    // key state in KEYINPUT format (0=Pressed, 1=Released), replaces keyboard input
+    void setKeyState(uint16_t keys);
+    void setInputSampleInterval(uint32_t scanlines);
+
+    // LCD colour correction for the window and getFrame
+    void setColourCorrection(bool enabled);
+    void setPixelFormat(ColourLut::Format format);
+    // filter for the window, see Upscaler.h
+    void setUpscaleFilter(Upscaler::Filter filter, uint32_t scale);
+    // the last completed frame converted to the pixel format (240x160, bytesPerPixel of the format each)
+    void getFrame(void* buffer);
+
+    // records every completed frame (and audio) on a writer thread, see Capture.h. Returns false if a file
+    // could not be opened
+    bool startCapture(std::string videoPath, std::string audioPath, bool blockWhenFull);
+    void stopCapture();
+
+    // publishes every completed frame to a shared memory ring for other processes, see FrameExport.h
+    bool startFrameExport(std::string name, uint32_t slots, ColourLut::Format format);
+    void stopFrameExport();
+
+    // save states of the whole machine except the rom, bios and frontend configuration (window, capture, link
+    // cable). A state only loads into an instance running the same rom, with the same STATE_VERSION
+    static constexpr uint32_t STATE_VERSION = 3;
+    // measured when the machine is created and when a rom is loaded, the layout is fixed in between
+    size_t getStateSize();
+    bool saveState(void* buffer, size_t size);
+    bool loadState(const void* buffer, size_t size);
+
+    // resets restore a snapshot in place with a few copies instead of constructing a new machine, the rom and
+    // everything derived from it (save type, frontend configuration) are kept. A snapshot is a save state
+    std::vector<uint8_t> takeSnapshot();
+    bool resetTo(const std::vector<uint8_t>& snapshot);
+    // back to the snapshot taken when the rom was loaded, save memory included. Returns false if it didn't load
+    bool reset();
+
+    // cache a state of every rom at its first keypad read (frame 0) or at the given frame in directory and start
+    // from it on later launches, see WarmStart.h. Must be set before loadRom
+    void setWarmStart(std::string directory, uint32_t frame);
+
+    // GameShark / Action Replay v1-v2 and CodeBreaker codes, see Cheats.h. setCheat replaces the cheat at index and
+    // returns false (keeping the old one) if a code isn't supported. Loading a rom clears them
+    bool setCheat(uint32_t index, bool enabled, std::string codes);
+    void clearCheats();
+
+    // search of the work ram for the addresses of game variables, see RamSearch.h. Filter it between frames
+    RamSearch* getRamSearch();
+
+    // creates a link cable with this instance attached if there isn't one yet
+    std::shared_ptr<LinkCable> getLinkCable();
+    bool connectLinkCable(std::shared_ptr<LinkCable> linkCable);
+
     ARM7TDMI* getCpu();
+    Bus* getBus();
+    PPU* getPpu();
 
-    static uint64_t cyclesSinceStart;
+    // thread local so that instances running on separate threads (ie. linked instances) don't share it
+    static thread_local uint64_t cyclesSinceStart;
 
    private:
     std::shared_ptr<ARM7TDMI> arm7tdmi;
@@ -35,15 +142,38 @@ class GameBoyAdvanceImpl {
     std::shared_ptr<Timer> timer;
     std::shared_ptr<Debugger> debugger;
     std::shared_ptr<Scheduler> scheduler;
+    std::shared_ptr<Gamepad> gamepad;
+    std::shared_ptr<Serial> serial;
+    std::shared_ptr<VideoTiming> videoTiming;
+    std::shared_ptr<Capture> capture;
+    std::shared_ptr<ColourLut> frameColourLut;
+    std::shared_ptr<FrameExport> frameExport;
+    std::shared_ptr<WarmStart> warmStart;
+    std::shared_ptr<Cheats> cheats;
+    std::shared_ptr<RamSearch> ramSearch;
+
+    // taken by loadRom, see reset
+    std::vector<uint8_t> bootSnapshot;
+    // see getStateSize
+    size_t stateSize = 0;
+    // the rom had no warm start state, one is stored once the trigger is reached
+    bool warmStartPending = false;
 
     uint64_t getTotalCyclesElapsed();
     void testDisplay();
 
     void dmaXEvent(uint8_t x, Scheduler::Event* dmaEvent, uint16_t currentScanline);
 
-    bool hBlank = false;
-    bool scanlineRendered = false;
-    bool vBlank = false;
+    void serialize(Serializer& serializer);
+    void measureStateSize();
+    void storeWarmStart();
+
+    void initializeEvents();
+    // runs until the frame is completed or instructionLimit instructions have been executed in total
+    void run(uint64_t instructionLimit);
+    void handleEvent(Scheduler::Event* event);
+    void presentFrame(std::array<uint16_t, 38400>& frame);
+    void addEventProfile(Scheduler::EventType eventType, uint64_t nanoseconds);
 
     long previousTime = 0;
     long currentTime = 0;
@@ -53,5 +183,21 @@ class GameBoyAdvanceImpl {
 
     bool debugMode = false;
 
+    bool headless = false;
+    bool eventsInitialized = false;
+    bool frameCompleted = false;
+
+    double previous60Frame = 0.0;
+    double fps = 60.0;
+
+    uint64_t instructionsExecuted = 0;
+
+    bool profiling = false;
+    Profile profile;
+
+    FastPaths fastPaths;
+
+    bool keyboardInput = true;
+
 };
 
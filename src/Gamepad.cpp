@@ -1,7 +1,31 @@
 #include "memory/Bus.h"
+#include "arm7tdmi/ARM7TDMI.h"
 #include "Gamepad.h"
+#include "PPU.h"
+#include "Scheduler.h"
+#include "util/Serializer.h"
 
-void Gamepad::getInput(Bus* bus) {
+Gamepad::Gamepad() :
+    keyState(ALL_KEYS_RELEASED),
+    sampledKeyState(ALL_KEYS_RELEASED),
+    sampleIntervalCycles(PPU::V_TOTAL) {
+}
+
+void Gamepad::connectBus(std::shared_ptr<Bus> bus) {
+    this->bus = bus;
+    bus->iORegisters[Bus::IORegister::KEYINPUT] = sampledKeyState & 0xFF;
+    bus->iORegisters[Bus::IORegister::KEYINPUT + 1] = sampledKeyState >> 8;
+}
+
+void Gamepad::connectCpu(std::shared_ptr<ARM7TDMI> cpu) {
+    this->cpu = cpu;
+}
+
+void Gamepad::connectScheduler(std::shared_ptr<Scheduler> scheduler) {
+    this->scheduler = scheduler;
+}
+
+uint16_t Gamepad::pollKeyboard() {
     /*
         Bit   Expl.
         0     Button A        (0=Pressed, 1=Released)
@@ -16,20 +40,87 @@ void Gamepad::getInput(Bus* bus) {
         9     Button L        (etc.)
         10-15 Not used
     */
-    uint8_t keysPressedByte1 = 0;
-    uint8_t keysPressedByte2 = 0;
-
-    keysPressedByte1 |= !sf::Keyboard::isKeyPressed(A);
-    keysPressedByte1 |= (!sf::Keyboard::isKeyPressed(B) << 1);
-    keysPressedByte1 |= (!sf::Keyboard::isKeyPressed(SELECT) << 2);
-    keysPressedByte1 |= (!sf::Keyboard::isKeyPressed(START) << 3);
-    keysPressedByte1 |= (!sf::Keyboard::isKeyPressed(DPAD_RIGHT) << 4);
-    keysPressedByte1 |= (!sf::Keyboard::isKeyPressed(DPAD_LEFT) << 5);
-    keysPressedByte1 |= (!sf::Keyboard::isKeyPressed(DPAD_UP) << 6);
-    keysPressedByte1 |= (!sf::Keyboard::isKeyPressed(DPAD_DOWN) << 7);
-    keysPressedByte2 |= (!sf::Keyboard::isKeyPressed(SHOULDER_RIGHT) << 0);
-    keysPressedByte2 |= (!sf::Keyboard::isKeyPressed(SHOULDER_LEFT) << 1);
-
-    bus->iORegisters[Bus::IORegister::KEYINPUT] = keysPressedByte1;
-    bus->iORegisters[Bus::IORegister::KEYINPUT + 1] = keysPressedByte2;
-}
\ No newline at end of file
+    uint16_t keys = 0;
+
+    keys |= !sf::Keyboard::isKeyPressed(A);
+    keys |= (!sf::Keyboard::isKeyPressed(B) << 1);
+    keys |= (!sf::Keyboard::isKeyPressed(SELECT) << 2);
+    keys |= (!sf::Keyboard::isKeyPressed(START) << 3);
+    keys |= (!sf::Keyboard::isKeyPressed(DPAD_RIGHT) << 4);
+    keys |= (!sf::Keyboard::isKeyPressed(DPAD_LEFT) << 5);
+    keys |= (!sf::Keyboard::isKeyPressed(DPAD_UP) << 6);
+    keys |= (!sf::Keyboard::isKeyPressed(DPAD_DOWN) << 7);
+    keys |= (!sf::Keyboard::isKeyPressed(SHOULDER_RIGHT) << 8);
+    keys |= (!sf::Keyboard::isKeyPressed(SHOULDER_LEFT) << 9);
+
+    return keys;
+}
+
+void Gamepad::setKeyState(uint16_t keys) {
+    keyState.store(keys & ALL_KEYS_RELEASED, std::memory_order_relaxed);
+}
+
+void Gamepad::setSampleInterval(uint32_t scanlines) {
+    if(scanlines == 0) {
+        scanlines = 1;
+    } else if(scanlines > 228) {
+        scanlines = 228;
+    }
+    sampleIntervalCycles = scanlines * PPU::H_TOTAL;
+}
+
+void Gamepad::startSampling() {
+    // first sample point lines up with the start of vblank, where input used to be read once per frame
+    scheduler->addEvent(Scheduler::EventType::KEYPAD,
+                        PPU::V_VISIBLE_CYCLES % sampleIntervalCycles,
+                        Scheduler::EventCondition::NULL_CONDITION,
+                        false);
+}
+
+void Gamepad::sampleInputEvent() {
+    sampleInput();
+    scheduler->addEvent(Scheduler::EventType::KEYPAD,
+                        sampleIntervalCycles,
+                        Scheduler::EventCondition::NULL_CONDITION,
+                        false);
+}
+
+inline
+void Gamepad::sampleInput() {
+    uint16_t keys = keyState.load(std::memory_order_relaxed);
+    if(keys == sampledKeyState) {
+        return;
+    }
+    sampledKeyState = keys;
+    bus->iORegisters[Bus::IORegister::KEYINPUT] = keys & 0xFF;
+    bus->iORegisters[Bus::IORegister::KEYINPUT + 1] = keys >> 8;
+    checkKeypadInterrupt();
+}
+
+/*
+    4000132h - KEYCNT - Key Interrupt Control (R/W)
+    Bit   Expl.
+    0-9   Button Select Mask (0=Ignore, 1=Select)
+    10-13 Not used
+    14    Button IRQ Enable  (0=Disable, 1=Enable)
+    15    Button IRQ Condition   (0=Logical OR, 1=Logical AND)
+*/
+void Gamepad::checkKeypadInterrupt() {
+    uint16_t keyControl = (uint16_t)bus->iORegisters[Bus::IORegister::KEYCNT] |
+                          ((uint16_t)bus->iORegisters[Bus::IORegister::KEYCNT + 1] << 8);
+    if(!(keyControl & 0x4000)) {
+        return;
+    }
+
+    uint16_t mask = keyControl & ALL_KEYS_RELEASED;
+    uint16_t pressed = ~sampledKeyState & mask;
+    bool condition = (keyControl & 0x8000) ? (mask != 0 && pressed == mask) : (pressed != 0);
+
+    if(condition) {
+        cpu->queueInterrupt(ARM7TDMI::Interrupt::Keypad);
+    }
+}
+
+void Gamepad::serialize(Serializer& serializer) {
+    serializer.value(sampledKeyState);
+}
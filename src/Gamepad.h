@@ -1,11 +1,43 @@
 #include <SFML/Graphics.hpp>
+#include <atomic>
+#include <memory>
 
 class Bus;
+class ARM7TDMI;
+class Scheduler;
+class Serializer;
 
 class Gamepad {
 
     public:
-        static void getInput(Bus* bus);
+        Gamepad();
+
+        void connectBus(std::shared_ptr<Bus> bus);
+        void connectCpu(std::shared_ptr<ARM7TDMI> cpu);
+        void connectScheduler(std::shared_ptr<Scheduler> scheduler);
+
+        // reads the keyboard, returns the key state in KEYINPUT format
+        static uint16_t pollKeyboard();
+
+        // can be called by the frontend from any thread, applied to KEYINPUT at the next sample point
+        void setKeyState(uint16_t keys);
+
+        // number of scanlines between sample points, 1 = every scanline, 228 = every frame
+        void setSampleInterval(uint32_t scanlines);
+
+        // schedules the first sample point
+        void startSampling();
+
+        // scheduled keypad event, copies the latest key state into KEYINPUT
+        void sampleInputEvent();
+
+        // check KEYCNT's irq condition against KEYINPUT
+        void checkKeypadInterrupt();
+
+        // the key state set by the frontend is input, not state, only the sampled one is saved
+        void serialize(Serializer& serializer);
+
+        static constexpr uint16_t ALL_KEYS_RELEASED = 0x03FF;
 
         // TODO make configurable
         static const sf::Keyboard::Key A = sf::Keyboard::K;
@@ -19,4 +51,15 @@ class Gamepad {
         static const sf::Keyboard::Key START = sf::Keyboard::Space;
         static const sf::Keyboard::Key SELECT = sf::Keyboard::RShift;
 
-};
\ No newline at end of file
+    private:
+        std::shared_ptr<Bus> bus;
+        std::shared_ptr<ARM7TDMI> cpu;
+        std::shared_ptr<Scheduler> scheduler;
+
+        void sampleInput();
+
+        std::atomic<uint16_t> keyState;
+        uint16_t sampledKeyState;
+
+        uint32_t sampleIntervalCycles;
+};
@@ -2,97 +2,107 @@
 // TODO: common include file for defines (like DEBUG)
 #include "arm7tdmi/ARM7TDMI.h"
 #include "PPU.h"
-
-/**
- * Helper function for changing resolution
- * TODO: move this somewere else
- * */
-void changeResolution(sf::VertexArray& pixels, float xRes, float yRes) {
-    float aspectRatio = (float)(PPU::SCREEN_WIDTH) / (float)(PPU::SCREEN_HEIGHT); // 1.5
-    float newAspectRatio = (xRes / yRes);
-
-    float xScale = xRes / PPU::SCREEN_WIDTH;
-    float yScale = yRes / PPU::SCREEN_HEIGHT;
-
-    if(newAspectRatio <= aspectRatio) {
-        // xRes is limiting scale factor
-        float yShift = yRes/2.0 - (PPU::SCREEN_HEIGHT * xScale / 2.0);
-        for(int x = 0; x < PPU::SCREEN_WIDTH; x++) {
-            for(int y = 0; y < PPU::SCREEN_HEIGHT; y++) {  
-                sf::Vertex* quad = &pixels[(y * PPU::SCREEN_WIDTH + x) * 4];
-                quad[0].position = sf::Vector2f(x * xScale, y * xScale + yShift);
-                quad[1].position = sf::Vector2f((x + 1) * xScale, y * xScale + yShift);
-                quad[2].position = sf::Vector2f((x + 1) * xScale, (y + 1) * xScale + yShift);
-                quad[3].position = sf::Vector2f(x * xScale, (y + 1) * xScale + yShift);
-            }
-        }
-    } else {
-        float xShift = xRes/2.0 - (PPU::SCREEN_WIDTH * yScale / 2.0);
-        for(int x = 0; x < PPU::SCREEN_WIDTH; x++) {
-            for(int y = 0; y < PPU::SCREEN_HEIGHT; y++) {  
-                sf::Vertex* quad = &pixels[(y * PPU::SCREEN_WIDTH + x) * 4];
-                quad[0].position = sf::Vector2f(x * yScale + xShift, y * yScale);
-                quad[1].position = sf::Vector2f((x + 1) * yScale + xShift, y * yScale);
-                quad[2].position = sf::Vector2f((x + 1) * yScale + xShift, (y + 1) * yScale);
-                quad[3].position = sf::Vector2f(x * yScale + xShift, (y + 1) * yScale);
-            }
-        }
-    }
-}
+#include <algorithm>
+#include <cstring>
 
 void LCD::initWindow() {
     gbaWindow = std::make_shared<sf::RenderWindow>(sf::VideoMode(PPU::SCREEN_WIDTH * defaultScreenSize, 
                                                    PPU::SCREEN_HEIGHT * defaultScreenSize), 
                                                    "gba-mu");
-    pixels.resize(PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT * 4);
-    pixels.setPrimitiveType(sf::Quads);
-
-    for(int x = 0; x < PPU::SCREEN_WIDTH; x++) {
-        for(int y = 0; y < PPU::SCREEN_HEIGHT; y++) {  
-            sf::Vertex* quad = &pixels[(y * PPU::SCREEN_WIDTH + x) * 4];
-            sf::Color color = sf::Color(rand());
-            quad[0].color = color;
-            quad[1].color = color;
-            quad[2].color = color;
-            quad[3].color = color;
-
-            quad[0].position = sf::Vector2f(x, y);
-            quad[1].position = sf::Vector2f(x + 1, y);
-            quad[2].position = sf::Vector2f(x + 1, y + 1);
-            quad[3].position = sf::Vector2f(x, y + 1);
-        }
-    }
 
     sf::FloatRect visibleArea(0, 0, PPU::SCREEN_WIDTH * defaultScreenSize, 
                                     PPU::SCREEN_HEIGHT * defaultScreenSize);
 
     sf::View view = sf::View(visibleArea);
     gbaWindow->setView(view);
-    changeResolution(pixels, (float)(PPU::SCREEN_WIDTH * defaultScreenSize), 
-                             (float)(PPU::SCREEN_HEIGHT * defaultScreenSize));
+    windowWidth = (float)(PPU::SCREEN_WIDTH * defaultScreenSize);
+    windowHeight = (float)(PPU::SCREEN_HEIGHT * defaultScreenSize);
 
     gbaWindow->clear(sf::Color::Black);
     gbaWindow->display();
 }
 
+void LCD::setColourCorrection(bool enabled) {
+    colourLut.configure(ColourLut::RGBA8888, enabled);
+    textureStale = true;
+}
+
+void LCD::setUpscaleFilter(Upscaler::Filter filter, uint32_t scale) {
+    upscaler.setFilter(filter, scale);
+    textureStale = true;
+}
+
+// scales the sprite to the largest size that fits the window at the gba's aspect ratio, centered
+void LCD::fitSprite() {
+    float scale = std::min(windowWidth / PPU::SCREEN_WIDTH, windowHeight / PPU::SCREEN_HEIGHT) / upscaler.getScale();
+    sprite.setScale(scale, scale);
+    sprite.setPosition((windowWidth - PPU::SCREEN_WIDTH * upscaler.getScale() * scale) / 2.0,
+                       (windowHeight - PPU::SCREEN_HEIGHT * upscaler.getScale() * scale) / 2.0);
+}
+
+void LCD::uploadChangedLines(const std::bitset<160>& changedLines) {
+    uint32_t scale = upscaler.getScale();
+    if(upscaler.getFilter() == Upscaler::NONE) {
+        // one upload per run of changed rows
+        for(uint32_t y = 0; y < PPU::SCREEN_HEIGHT; y++) {
+            if(!changedLines[y]) {
+                continue;
+            }
+            uint32_t first = y;
+            while(y + 1 < PPU::SCREEN_HEIGHT && changedLines[y + 1]) {
+                y++;
+            }
+            texture.update((const uint8_t*)&convertedPixels[first * PPU::SCREEN_WIDTH], PPU::SCREEN_WIDTH,
+                           y - first + 1, 0, first);
+        }
+        return;
+    }
+
+    // the filters work on whole frames, the rows between the first and last change (and the rows the filter
+    // spreads them to) are uploaded in one go
+    const std::vector<uint32_t>& upscaled = upscaler.process(convertedPixels.data(), PPU::SCREEN_WIDTH, PPU::SCREEN_HEIGHT);
+    uint32_t first = 0;
+    while(!changedLines[first]) {
+        first++;
+    }
+    uint32_t last = PPU::SCREEN_HEIGHT - 1;
+    while(!changedLines[last]) {
+        last--;
+    }
+    first = first > FILTER_REACH ? first - FILTER_REACH : 0;
+    last = std::min(last + FILTER_REACH, PPU::SCREEN_HEIGHT - 1);
+    uint32_t width = PPU::SCREEN_WIDTH * scale;
+    texture.update((const uint8_t*)&upscaled[first * scale * width], width, (last - first + 1) * scale, 0, first * scale);
+}
+
 /*
   0-4   Red Intensity   (0-31)
   5-9   Green Intensity (0-31)
   10-14 Blue Intensity  (0-31)
 */
 
-void LCD::drawWindow(std::array<uint16_t, 38400>& pixelBuffer) {
-
-    for(int i = 0; i < (pixelBuffer.size() * 4); i += 4) {
-        uint16_t val = pixelBuffer[i >> 2];
-        sf::Color colour = sf::Color((val & 0x1f) << 3, /* R */
-                                     (val & 0x3E0) >> 2,  /* G */
-                                     (val & 0x7C00) >> 7, 255); /* B */
-        pixels[i].color = colour;
-        pixels[i + 1].color = colour;
-        pixels[i + 2].color = colour;
-        pixels[i + 3].color = colour;
-    }    
+void LCD::drawWindow(std::array<uint16_t, 38400>& pixelBuffer, const std::bitset<160>& changedLines) {
+    uint32_t width = PPU::SCREEN_WIDTH * upscaler.getScale();
+    uint32_t height = PPU::SCREEN_HEIGHT * upscaler.getScale();
+    if(texture.getSize().x != width || texture.getSize().y != height) {
+        // first frame or the filter's scale changed
+        texture.create(width, height);
+        sprite.setTexture(texture, true);
+        fitSprite();
+        textureStale = true;
+    }
+    std::bitset<160> linesToUpload = textureStale ? std::bitset<160>().set() : changedLines;
+    textureStale = false;
+
+    if(linesToUpload.any()) {
+        for(uint32_t y = 0; y < PPU::SCREEN_HEIGHT; y++) {
+            if(linesToUpload[y]) {
+                colourLut.convert(&pixelBuffer[y * PPU::SCREEN_WIDTH], &convertedPixels[y * PPU::SCREEN_WIDTH],
+                                  PPU::SCREEN_WIDTH);
+            }
+        }
+        uploadChangedLines(linesToUpload);
+    }
 
     if(gbaWindow->isOpen()) {
         while(gbaWindow->pollEvent(event)) {
@@ -104,11 +114,13 @@ void LCD::drawWindow(std::array<uint16_t, 38400>& pixelBuffer) {
                 sf::FloatRect visibleArea(0, 0, event.size.width, event.size.height);
                 sf::View view = sf::View(visibleArea);
                 gbaWindow->setView(view);
-                changeResolution(pixels, (float)event.size.width, (float)event.size.height);
+                windowWidth = (float)event.size.width;
+                windowHeight = (float)event.size.height;
+                fitSprite();
             }
         }
         gbaWindow->clear(sf::Color::Black);
-        gbaWindow->draw(pixels);
+        gbaWindow->draw(sprite);
         
         gbaWindow->display();
     }
@@ -1,18 +1,41 @@
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <bitset>
 #include <vector>
 #include <memory>
+#include "ColourLut.h"
+#include "Upscaler.h"
 
 class LCD {
 
     public: 
         void initWindow();
-        void drawWindow(std::array<uint16_t, 38400 /* width x height */>& pixelBuffer);
+        // only the changedLines (see PPU::getChangedLines) are converted and uploaded to the texture, nothing is
+        // uploaded if none changed
+        void drawWindow(std::array<uint16_t, 38400 /* width x height */>& pixelBuffer, const std::bitset<160>& changedLines);
         void closeWindow();
+        void setColourCorrection(bool enabled);
+        // NONE draws the native frame, anything else is filtered on the cpu first
+        void setUpscaleFilter(Upscaler::Filter filter, uint32_t scale);
 
     private: 
         static void drawPixel();
         std::shared_ptr<sf::RenderWindow> gbaWindow;
-        sf::VertexArray pixels;
         sf::Event event;
         int defaultScreenSize = 7;
+        ColourLut colourLut;
+        std::array<uint32_t, 38400> convertedPixels;
+        Upscaler upscaler;
+        // the frame at the upscaler's scale, kept on the gpu between frames
+        sf::Texture texture;
+        sf::Sprite sprite;
+        // everything has to be uploaded again (new texture, colours or filter)
+        bool textureStale = true;
+        // rows of the source frame on either side of a changed row that a filter's output rows depend on (xBR
+        // reads a 5x5 neighbourhood)
+        static const uint32_t FILTER_REACH = 2;
+        float windowWidth = 0;
+        float windowHeight = 0;
+        void uploadChangedLines(const std::bitset<160>& changedLines);
+        void fitSprite();
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "LinkCable.h"
+
+#include <algorithm>
+
+
+uint8_t LinkCable::attach() {
+    for(uint8_t player = 0; player < MAX_PLAYERS; player++) {
+        bool expected = false;
+        if(connected[player].compare_exchange_strong(expected, true)) {
+            cycles[player].store(0, std::memory_order_release);
+            playerCount++;
+            return player;
+        }
+    }
+    return MAX_PLAYERS;
+}
+
+void LinkCable::detach(uint8_t player) {
+    if(player < MAX_PLAYERS && connected[player].exchange(false)) {
+        playerCount--;
+    }
+}
+
+bool LinkCable::isConnected(uint8_t player) {
+    return player < MAX_PLAYERS && connected[player].load(std::memory_order_acquire);
+}
+
+uint8_t LinkCable::getPlayerCount() {
+    return playerCount.load(std::memory_order_acquire);
+}
+
+bool LinkCable::send(uint8_t from, uint8_t to, const Message& message) {
+    if(!isConnected(to)) {
+        return false;
+    }
+    return channels[from][to].push(message);
+}
+
+bool LinkCable::receive(uint8_t to, uint8_t from, Message& message) {
+    return channels[from][to].pop(message);
+}
+
+void LinkCable::publishCycles(uint8_t player, uint64_t cycles) {
+    this->cycles[player].store(cycles, std::memory_order_release);
+}
+
+uint64_t LinkCable::getSlowestCycles(uint8_t player) {
+    uint64_t slowest = UINT64_MAX;
+    for(uint8_t other = 0; other < MAX_PLAYERS; other++) {
+        if(other != player && isConnected(other)) {
+            slowest = std::min(slowest, cycles[other].load(std::memory_order_acquire));
+        }
+    }
+    return slowest;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include "util/SpscQueue.h"
+
+/*
+    In-process link cable connecting up to 4 emulator instances.
+    Every ordered pair of players has its own SPSC channel, so each instance can run on its own thread.
+    Each player also publishes how far it has emulated, which Serial uses to keep the players within a bounded
+    number of cycles of each other.
+    Players must be attached before the instances start running.
+*/
+class LinkCable {
+
+    public:
+        static constexpr uint8_t MAX_PLAYERS = 4;
+
+        struct Message {
+            enum Type : uint8_t {
+                START,  // master started a transfer, data = master's outgoing data
+                REPLY,  // slave answering a START, data = slave's outgoing data
+                RESULT  // multiplayer only, parent sends every player's data once the transfer is done
+            };
+            Type type;
+            uint8_t mode;
+            uint64_t cycle;
+            // multiplayer transfers need all 4 halfwords in a RESULT
+            std::array<uint32_t, MAX_PLAYERS> data;
+        };
+
+        // returns the player id, or MAX_PLAYERS if the cable is full
+        uint8_t attach();
+        void detach(uint8_t player);
+
+        bool isConnected(uint8_t player);
+        uint8_t getPlayerCount();
+
+        bool send(uint8_t from, uint8_t to, const Message& message);
+        bool receive(uint8_t to, uint8_t from, Message& message);
+
+        void publishCycles(uint8_t player, uint64_t cycles);
+        // the lowest cycle count published by a connected player other than player, UINT64_MAX if there is none
+        uint64_t getSlowestCycles(uint8_t player);
+
+    private:
+        // [from][to]
+        std::array<std::array<SpscQueue<Message, 16>, MAX_PLAYERS>, MAX_PLAYERS> channels;
+
+        std::array<std::atomic<bool>, MAX_PLAYERS> connected = {{false, false, false, false}};
+        std::atomic<uint8_t> playerCount = {0};
+        std::array<std::atomic<uint64_t>, MAX_PLAYERS> cycles = {{0, 0, 0, 0}};
+};
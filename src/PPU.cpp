@@ -6,8 +6,12 @@
 #include <string>
 #include <iostream>
 #include "util/macros.h"
+#include "util/Log.h"
+#include "util/Serializer.h"
+#include "util/WorkerPool.h"
 #include "assert.h"
 #include <cmath>
+#include <cstring>
 
 
 PPU::PPU() {
@@ -42,11 +46,11 @@ void PPU::renderScanline(uint16_t scanline) {
             break;
         }
         case 1: {
-            DEBUGWARN("in bg mode 1 unimplemented\n");
+            LOG_WARN(PPU, "bg mode 1 unimplemented\n");
             break;
         }
         case 2: {
-            DEBUGWARN("in bg mode 2 unimplemented\n");
+            LOG_WARN(PPU, "bg mode 2 unimplemented\n");
             break;
         }
         /*
@@ -114,6 +118,90 @@ void PPU::renderScanline(uint16_t scanline) {
     }
 }
 
+void PPU::scanlineEnded(uint16_t scanline) {
+    if(pendingLines == 0) {
+        firstPendingLine = scanline;
+    }
+    pendingLines++;
+    if(!lazyRendering) {
+        renderPendingLines();
+    }
+}
+
+void PPU::renderPendingLines() {
+    // runs of visible lines can be rendered in parallel. Lines 159 - 227 are rendered one at a time and in order,
+    // 226 and 227 both prepare line 0 and 226 latches frameSkipped
+    uint16_t runStart = 0;
+    uint16_t runLength = 0;
+    for(uint16_t i = 0; i < pendingLines; i++) {
+        uint16_t scanline = (firstPendingLine + i) % 228;
+        if(scanline < SCREEN_HEIGHT - 1) {
+            if(!frameSkipped) {
+                if(runLength == 0) {
+                    runStart = scanline;
+                }
+                runLength++;
+            }
+            continue;
+        }
+        renderLines(runStart, runLength);
+        runLength = 0;
+        if(scanline == 226) {
+            // the end of line 226 prepares line 0 of the next frame
+            frameSkipped = skipRendering;
+        }
+        if(!frameSkipped) {
+            renderScanline(scanline);
+        }
+    }
+    renderLines(runStart, runLength);
+    pendingLines = 0;
+}
+
+template <typename LineTask>
+void PPU::forEachLine(uint32_t count, LineTask lineTask) {
+    if(!workerPool || count < MIN_PARALLEL_LINES) {
+        for(uint32_t i = 0; i < count; i++) {
+            lineTask(i);
+        }
+        return;
+    }
+    // a couple of bands per thread, sprites and windows make some lines a lot slower than others
+    uint32_t bands = std::min(count, workerPool->getThreadCount() * 2);
+    uint32_t bandHeight = (count + bands - 1) / bands;
+    workerPool->run(bands, [&](size_t band) {
+        uint32_t end = std::min(count, (uint32_t)(band + 1) * bandHeight);
+        for(uint32_t i = band * bandHeight; i < end; i++) {
+            lineTask(i);
+        }
+    });
+}
+
+void PPU::renderLines(uint16_t first, uint16_t count) {
+    forEachLine(count, [&](uint32_t i) {
+        renderScanline(first + i);
+    });
+}
+
+void PPU::setLazyRendering(bool lazy) {
+    catchUp();
+    lazyRendering = lazy;
+}
+
+void PPU::setSkipRendering(bool skip) {
+    catchUp();
+    skipRendering = skip;
+}
+
+void PPU::setRenderThreads(uint32_t threads) {
+    catchUp();
+    if(threads == 1) {
+        workerPool.reset();
+    } else if(!workerPool || threads == 0 || workerPool->getThreadCount() != threads) {
+        workerPool = std::make_unique<WorkerPool>(threads);
+    }
+}
+
 void PPU::connectBus(std::shared_ptr<Bus> _bus) {
     this->bus = _bus;
 }
@@ -518,8 +606,7 @@ PPU::Coords PPU::convertScreenCoordsToSpriteCoords(int32_t screenX, int32_t scre
     // uint32_t spriteX = (paScale * (float)((int32_t)screenX ) + pbScale * (float)((int32_t)screenY) );
     // uint32_t spriteY = (pcScale * (float)((int32_t)screenX ) + pdScale * (float)((int32_t)screenY) );
 
-    DEBUGWARN(spriteX << " spriteX\n");
-    DEBUGWARN(spriteX << " spriteY\n");
+    LOG_INFO(PPU, "affine sprite texel " << spriteX << ", " << spriteY << "\n");
 
     return {spriteX, spriteY};
 }
@@ -527,7 +614,11 @@ PPU::Coords PPU::convertScreenCoordsToSpriteCoords(int32_t screenX, int32_t scre
 
 // this is only called once per frame
 std::array<uint16_t, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT>& PPU::renderCurrentScreen() {
-    pixelBuffer.fill(0);
+    catchUp();
+    if(frameSkipped) {
+        changedLines.reset();
+        return pixelBuffer;
+    }
     // get the priorities of the backgrounds
     std::vector<std::pair<uint8_t, uint8_t>> bgPriorities;
     bgPriorities.push_back({(bgBuffer[0 * SCREEN_WIDTH * SCREEN_HEIGHT] & 0x30000) >> 16, 0});
@@ -543,100 +634,138 @@ std::array<uint16_t, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT>& PPU::renderCurrent
     bool win1Enabled = false;
 
 
-    for(int y = 0; y < SCREEN_HEIGHT; y++) {
-        uint8_t windowBgMask;
-        uint8_t window0Left = 0;
-        uint8_t window0Right = 0;
-        uint8_t window1Left = 0;
-        uint8_t window1Right = 0;
-        bool window0 = false;
-        bool window1 = false;
-        bool windowed = false;
-        if(scanlineBgWindowData[y].enabled) {
-            windowed = true;
-            // WINDOW 0
-            if((scanlineBgWindowData[y].top <= y && y < scanlineBgWindowData[y].bottom) || 
-               ((int8_t)scanlineBgWindowData[y].top <= y && y < (int8_t)scanlineBgWindowData[y].bottom)) {
-                window0 = true;
-                window0Left = scanlineBgWindowData[y].left;
-                window0Right = scanlineBgWindowData[y].right;
-            }
-        }
-        if(scanlineBgWindowData[SCREEN_HEIGHT + y].enabled) {
-            windowed = true;
-            // WINDOW 1
-            if((scanlineBgWindowData[SCREEN_HEIGHT + y].top <= y && y < scanlineBgWindowData[SCREEN_HEIGHT + y].bottom) || 
-               ((int8_t)scanlineBgWindowData[SCREEN_HEIGHT + y].top <= y && y < (int8_t)scanlineBgWindowData[SCREEN_HEIGHT + y].bottom)) {
-                window1 = true;
-                window1Left = scanlineBgWindowData[SCREEN_HEIGHT + y].left;
-                window1Right = scanlineBgWindowData[SCREEN_HEIGHT + y].right;
-            }         
-        }
+    forEachLine(SCREEN_HEIGHT, [&](uint32_t y) {
+        composeLine(y, bgPriorities);
+    });
+    for(uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+        changedLines[y] = allLinesChanged || lineChanged[y];
+    }
+    allLinesChanged = false;
+    bgBuffer.fill(transparentColour | lowestPrio);
+    spriteBuffer.fill(transparentColour);
+    for(auto& windowData : scanlineBgWindowData) {
+        windowData.enabled = false;
+    }
 
-        for(int x = 0; x < SCREEN_WIDTH; x++) {
-            pixelBuffer[y * SCREEN_WIDTH + x] = scanlineBackDropColours[y];
-
-            for(int priority = 3; priority >= 0; priority--) {
-                uint32_t bgOffset = (bgPriorities[priority].second) * SCREEN_HEIGHT * SCREEN_WIDTH;
-                uint32_t bgPixel = bgBuffer[bgOffset + y * SCREEN_WIDTH + x];
-                int spriteRelativePrio = bgPriorities[priority].first;
-
-                if(windowed) {
-                    if(window0 && 
-                       ((window0Left <= x && x < window0Right) || 
-                        ((int8_t)window0Left <= (int8_t)x && (int8_t)x < (int8_t)window0Right))) {
-                        windowBgMask = scanlineBgWindowData[y].metaData; 
-                    }   
-                    else if(window1 &&                        
-                           ((window1Left <= x && x < window1Right) || 
-                           ((int8_t)window1Left <= (int8_t)x && (int8_t)x < (int8_t)window1Right))) {
-                        windowBgMask = scanlineBgWindowData[SCREEN_HEIGHT + y].metaData; 
-                    }
-                    else {
-                        windowBgMask = scanlineOutsideWindowData[y]; 
-                    }
-                    if((windowBgMask & (1 << (bgPriorities[priority].second)))) {
-                        if(!isTransparent(bgPixel)) {
-                            pixelBuffer[y * SCREEN_WIDTH + x] = bgPixel & 0xFFFF;
-                        }                        
-                    } 
-                    if(windowBgMask & 0x10) {
-                        // obj enable
-                        for(int spritePrio = spriteRelativePrio; spritePrio >= 0; spritePrio--) {
-                            uint32_t spriteOffset = spritePrio * SCREEN_HEIGHT * SCREEN_WIDTH;
-                            uint32_t spritePixel = spriteBuffer[spriteOffset + y * SCREEN_WIDTH + x];
-                            if(!isTransparent(spritePixel)) {
-                                pixelBuffer[y * SCREEN_WIDTH + x] = spritePixel & 0xFFFF;
-                        
-                            }
-                        }
-                    }
-                    // TODO: sprite window
+    return pixelBuffer;
+}
 
-                } else {
+
+
+void PPU::composeLine(int y, const std::vector<std::pair<uint8_t, uint8_t>>& bgPriorities) {
+    uint8_t windowBgMask;
+    uint8_t window0Left = 0;
+    uint8_t window0Right = 0;
+    uint8_t window1Left = 0;
+    uint8_t window1Right = 0;
+    bool window0 = false;
+    bool window1 = false;
+    bool windowed = false;
+    if(scanlineBgWindowData[y].enabled) {
+        windowed = true;
+        // WINDOW 0
+        if((scanlineBgWindowData[y].top <= y && y < scanlineBgWindowData[y].bottom) || 
+           ((int8_t)scanlineBgWindowData[y].top <= y && y < (int8_t)scanlineBgWindowData[y].bottom)) {
+            window0 = true;
+            window0Left = scanlineBgWindowData[y].left;
+            window0Right = scanlineBgWindowData[y].right;
+        }
+    }
+    if(scanlineBgWindowData[SCREEN_HEIGHT + y].enabled) {
+        windowed = true;
+        // WINDOW 1
+        if((scanlineBgWindowData[SCREEN_HEIGHT + y].top <= y && y < scanlineBgWindowData[SCREEN_HEIGHT + y].bottom) || 
+           ((int8_t)scanlineBgWindowData[SCREEN_HEIGHT + y].top <= y && y < (int8_t)scanlineBgWindowData[SCREEN_HEIGHT + y].bottom)) {
+            window1 = true;
+            window1Left = scanlineBgWindowData[SCREEN_HEIGHT + y].left;
+            window1Right = scanlineBgWindowData[SCREEN_HEIGHT + y].right;
+        }         
+    }
+
+    // composed on the side so it can be compared with the previous frame's line
+    std::array<uint16_t, SCREEN_WIDTH> line;
+    for(int x = 0; x < SCREEN_WIDTH; x++) {
+        line[x] = scanlineBackDropColours[y];
+
+        for(int priority = 3; priority >= 0; priority--) {
+            uint32_t bgOffset = (bgPriorities[priority].second) * SCREEN_HEIGHT * SCREEN_WIDTH;
+            uint32_t bgPixel = bgBuffer[bgOffset + y * SCREEN_WIDTH + x];
+            int spriteRelativePrio = bgPriorities[priority].first;
+
+            if(windowed) {
+                if(window0 && 
+                   ((window0Left <= x && x < window0Right) || 
+                    ((int8_t)window0Left <= (int8_t)x && (int8_t)x < (int8_t)window0Right))) {
+                    windowBgMask = scanlineBgWindowData[y].metaData; 
+                }   
+                else if(window1 &&                        
+                       ((window1Left <= x && x < window1Right) || 
+                       ((int8_t)window1Left <= (int8_t)x && (int8_t)x < (int8_t)window1Right))) {
+                    windowBgMask = scanlineBgWindowData[SCREEN_HEIGHT + y].metaData; 
+                }
+                else {
+                    windowBgMask = scanlineOutsideWindowData[y]; 
+                }
+                if((windowBgMask & (1 << (bgPriorities[priority].second)))) {
                     if(!isTransparent(bgPixel)) {
-                        pixelBuffer[y * SCREEN_WIDTH + x] = bgPixel & 0xFFFF;
-                    } 
+                        line[x] = bgPixel & 0xFFFF;
+                    }                        
+                } 
+                if(windowBgMask & 0x10) {
+                    // obj enable
                     for(int spritePrio = spriteRelativePrio; spritePrio >= 0; spritePrio--) {
                         uint32_t spriteOffset = spritePrio * SCREEN_HEIGHT * SCREEN_WIDTH;
                         uint32_t spritePixel = spriteBuffer[spriteOffset + y * SCREEN_WIDTH + x];
                         if(!isTransparent(spritePixel)) {
-                            pixelBuffer[y * SCREEN_WIDTH + x] = spritePixel & 0xFFFF;        
+                            line[x] = spritePixel & 0xFFFF;
+                    
                         }
                     }
                 }
+                // TODO: sprite window
 
+            } else {
+                if(!isTransparent(bgPixel)) {
+                    line[x] = bgPixel & 0xFFFF;
+                } 
+                for(int spritePrio = spriteRelativePrio; spritePrio >= 0; spritePrio--) {
+                    uint32_t spriteOffset = spritePrio * SCREEN_HEIGHT * SCREEN_WIDTH;
+                    uint32_t spritePixel = spriteBuffer[spriteOffset + y * SCREEN_WIDTH + x];
+                    if(!isTransparent(spritePixel)) {
+                        line[x] = spritePixel & 0xFFFF;        
+                    }
+                }
             }
 
         }
-    }
-    bgBuffer.fill(transparentColour | lowestPrio);
-    spriteBuffer.fill(transparentColour);
-    for(auto& windowData : scanlineBgWindowData) {
-        windowData.enabled = false;
+
     }
 
-    return pixelBuffer;
+    uint16_t* previous = &pixelBuffer[y * SCREEN_WIDTH];
+    lineChanged[y] = memcmp(previous, line.data(), sizeof(line)) != 0;
+    if(lineChanged[y]) {
+        memcpy(previous, line.data(), sizeof(line));
+    }
 }
 
+void PPU::serialize(Serializer& serializer) {
+    serializer.array(pixelBuffer);
+    serializer.array(spriteBuffer);
+    serializer.array(bgBuffer);
+    serializer.array(scanlineBackDropColours);
+    serializer.array(scanlineBgWindowData);
+    serializer.array(scanlineOutsideWindowData);
+    serializer.array(scanlineObjectWindowData);
+    serializer.value(dirty);
+    serializer.value(firstPendingLine);
+    serializer.value(pendingLines);
+    serializer.value(frameSkipped);
+    if(serializer.isLoading()) {
+        // the frame on screen isn't the one loaded
+        allLinesChanged = true;
+    }
+}
 
+const std::bitset<PPU::SCREEN_HEIGHT>& PPU::getChangedLines() {
+    return changedLines;
+}
@@ -1,11 +1,15 @@
 #include <cstdint>
 #include <vector>
 #include <array>
+#include <bitset>
 #include <queue>
 #include <memory>
+#include <utility>
 
 class Bus; 
 class Scheduler;
+class Serializer;
+class WorkerPool;
 
 class PPU {
 
@@ -14,6 +18,27 @@ class PPU {
         ~PPU();
 
         void renderScanline(uint16_t scanline);
+
+        /*
+            Catch-up rendering: the end of every scanline is only recorded, the lines are rendered in one batch
+            (renderScanline for each) right before anything they depend on changes, ie. a write to vram, oam,
+            palette ram or the display io registers (Bus calls catchUp), and when the frame is completed.
+            Nothing else changes what they render, so the pixels are the same as rendering every line at its end.
+        */
+        void scanlineEnded(uint16_t scanline);
+        void catchUp();
+        // renders every line immediately instead (the reference behaviour)
+        void setLazyRendering(bool lazy);
+        // frames prepared while set are not rendered at all, renderCurrentScreen keeps returning the last rendered
+        // frame. Takes effect from the next frame
+        void setSkipRendering(bool skip);
+        /*
+            Renders in parallel on a pool of threads (including the emulation thread, 0 uses every core, 1 renders
+            serially). Runs of visible lines in a catch-up batch and the composition of the frame are split into
+            bands of lines, a batch is already a consistent snapshot of everything the lines read and every line
+            only writes its own rows of the buffers, so the pixels are the same as rendering serially.
+        */
+        void setRenderThreads(uint32_t threads);
         void renderObject();
         bool isObjectDirty();
 
@@ -32,12 +57,20 @@ class PPU {
 
         std::array<uint16_t, SCREEN_WIDTH * SCREEN_HEIGHT> pixelBuffer = {};
 
+        // lines of pixelBuffer that differ from the frame before, set by renderCurrentScreen (none for a skipped
+        // frame). Every line is reported for the first frame and the first one after a save state is loaded, so a
+        // presenter that only uploads these rows never keeps stale ones
+        const std::bitset<SCREEN_HEIGHT>& getChangedLines();
+
         void connectBus(std::shared_ptr<Bus> bus);
 
         void updateOamState(uint32_t address, uint8_t value);
 
         void setObjectsDirty();
 
+        // includes the lines rendered ahead and the last completed frame, see util/Serializer.h
+        void serialize(Serializer& serializer);
+
     private:
         std::shared_ptr<Bus> bus; 
         std::shared_ptr<Scheduler> scheduler;
@@ -66,6 +99,32 @@ class PPU {
 
         bool dirty;
 
+        // lines that have ended but haven't been rendered yet, starting at firstPendingLine
+        uint16_t firstPendingLine = 0;
+        uint16_t pendingLines = 0;
+        bool lazyRendering = true;
+        bool skipRendering = false;
+        // latched when the frame starts being prepared (at the end of line 226, see renderScanline)
+        bool frameSkipped = false;
+
+        std::bitset<SCREEN_HEIGHT> changedLines;
+        // one byte per line while the lines are composed in parallel, packed into changedLines afterwards
+        std::array<uint8_t, SCREEN_HEIGHT> lineChanged = {};
+        bool allLinesChanged = true;
+
+        // runs shorter than this aren't worth waking the workers for
+        static const uint32_t MIN_PARALLEL_LINES = 16;
+        std::unique_ptr<WorkerPool> workerPool;
+
+        void renderPendingLines();
+        // renderScanline for first .. first + count - 1, all of them visible lines (0 - 158)
+        void renderLines(uint16_t first, uint16_t count);
+        // runs lineTask for 0 .. count - 1, in parallel bands if there is a worker pool
+        template <typename LineTask>
+        void forEachLine(uint32_t count, LineTask lineTask);
+        // composes line y of pixelBuffer from the backdrop, bg and sprite buffers and records if it changed
+        void composeLine(int y, const std::vector<std::pair<uint8_t, uint8_t>>& bgPriorities);
+
         void renderSprites(uint16_t scanline);
         void renderBg(uint16_t scanline);
         void renderBgX(uint16_t scanline, uint8_t x);
@@ -131,4 +190,11 @@ class PPU {
         Coords convertScreenCoordsToSpriteCoords(int32_t x, int32_t y, int16_t pa, int16_t pb, int16_t pc, int16_t pd, int32_t xRotCentre, int32_t yRotCentre);
 
 
-};
\ No newline at end of file
+};
+
+inline
+void PPU::catchUp() {
+    if(pendingLines != 0) {
+        renderPendingLines();
+    }
+}
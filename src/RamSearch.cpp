@@ -0,0 +1,353 @@
+#include "RamSearch.h"
+#include "memory/Bus.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RAM_SEARCH_SIMD 1
+#endif
+
+namespace {
+
+// values per bitset word
+constexpr uint32_t WORD_VALUES = 32;
+
+// candidates of a bitset word that pass, from the bits of the values greater than and equal to their reference
+uint32_t selectBits(RamSearch::Comparison comparison, uint32_t greater, uint32_t equal) {
+    switch(comparison) {
+        case RamSearch::EQUAL: {
+            return equal;
+        }
+        case RamSearch::NOT_EQUAL: {
+            return ~equal;
+        }
+        case RamSearch::LESS: {
+            return ~(greater | equal);
+        }
+        case RamSearch::LESS_OR_EQUAL: {
+            return ~greater;
+        }
+        case RamSearch::GREATER: {
+            return greater;
+        }
+        case RamSearch::GREATER_OR_EQUAL: {
+            return greater | equal;
+        }
+        default: {
+            assert(false);
+            return 0;
+        }
+    }
+}
+
+template<uint32_t WIDTH>
+int64_t readScalar(const uint8_t* memory, bool isSigned) {
+    uint32_t value = 0;
+    for(uint32_t byte = 0; byte < WIDTH; byte++) {
+        value |= (uint32_t)memory[byte] << (byte * 8);
+    }
+    if(isSigned) {
+        uint32_t shift = 32 - WIDTH * 8;
+        return (int32_t)(value << shift) >> shift;
+    }
+    return value;
+}
+
+// the filters go over words of the bitset, current and reference point at the values of the first word and
+// reference moves by referenceStep per word (0 for a constant). Return the number of candidates left
+template<uint32_t WIDTH>
+size_t filterScalar(uint32_t* words, size_t wordCount, const uint8_t* current, const uint8_t* reference,
+                    size_t referenceStep, RamSearch::Comparison comparison, bool isSigned) {
+    size_t count = 0;
+    for(size_t i = 0; i < wordCount; i++) {
+        if(words[i] == 0) {
+            continue;
+        }
+        uint32_t greater = 0;
+        uint32_t equal = 0;
+        for(uint32_t value = 0; value < WORD_VALUES; value++) {
+            int64_t a = readScalar<WIDTH>(current + (i * WORD_VALUES + value) * WIDTH, isSigned);
+            int64_t b = readScalar<WIDTH>(reference + i * referenceStep + value * WIDTH, isSigned);
+            greater |= (uint32_t)(a > b) << value;
+            equal |= (uint32_t)(a == b) << value;
+        }
+        words[i] &= selectBits(comparison, greater, equal);
+        count += __builtin_popcount(words[i]);
+    }
+    return count;
+}
+
+#ifdef RAM_SEARCH_SIMD
+// unsigned values are compared as signed ones after flipping their sign bits
+
+__attribute__((target("sse2")))
+inline __m128i signBiasSse2(uint32_t width, bool isSigned) {
+    if(isSigned) {
+        return _mm_setzero_si128();
+    }
+    return width == 1 ? _mm_set1_epi8((char)0x80) : width == 2 ? _mm_set1_epi16((short)0x8000) :
+                                                                 _mm_set1_epi32((int)0x80000000);
+}
+
+// byte masks of 16 values in order, the bytes of one value are the same so the masks can be narrowed with
+// saturating packs
+template<uint32_t WIDTH>
+__attribute__((target("sse2")))
+inline void compareSse2(const uint8_t* a, const uint8_t* b, __m128i bias, __m128i& greater, __m128i& equal) {
+    __m128i greaters[WIDTH];
+    __m128i equals[WIDTH];
+    for(uint32_t i = 0; i < WIDTH; i++) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i * 16)), bias);
+        __m128i y = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(b + i * 16)), bias);
+        if constexpr(WIDTH == 1) {
+            greaters[i] = _mm_cmpgt_epi8(x, y);
+            equals[i] = _mm_cmpeq_epi8(x, y);
+        } else if constexpr(WIDTH == 2) {
+            greaters[i] = _mm_cmpgt_epi16(x, y);
+            equals[i] = _mm_cmpeq_epi16(x, y);
+        } else {
+            greaters[i] = _mm_cmpgt_epi32(x, y);
+            equals[i] = _mm_cmpeq_epi32(x, y);
+        }
+    }
+    if constexpr(WIDTH == 1) {
+        greater = greaters[0];
+        equal = equals[0];
+    } else if constexpr(WIDTH == 2) {
+        greater = _mm_packs_epi16(greaters[0], greaters[1]);
+        equal = _mm_packs_epi16(equals[0], equals[1]);
+    } else {
+        greater = _mm_packs_epi16(_mm_packs_epi32(greaters[0], greaters[1]),
+                                  _mm_packs_epi32(greaters[2], greaters[3]));
+        equal = _mm_packs_epi16(_mm_packs_epi32(equals[0], equals[1]),
+                                _mm_packs_epi32(equals[2], equals[3]));
+    }
+}
+
+template<uint32_t WIDTH>
+__attribute__((target("sse2")))
+size_t filterSse2(uint32_t* words, size_t wordCount, const uint8_t* current, const uint8_t* reference,
+                  size_t referenceStep, RamSearch::Comparison comparison, bool isSigned) {
+    const __m128i bias = signBiasSse2(WIDTH, isSigned);
+    size_t count = 0;
+    for(size_t i = 0; i < wordCount; i++) {
+        if(words[i] == 0) {
+            continue;
+        }
+        const uint8_t* a = current + i * WORD_VALUES * WIDTH;
+        const uint8_t* b = reference + i * referenceStep;
+        __m128i greaterLow, equalLow, greaterHigh, equalHigh;
+        compareSse2<WIDTH>(a, b, bias, greaterLow, equalLow);
+        compareSse2<WIDTH>(a + 16 * WIDTH, b + 16 * WIDTH, bias, greaterHigh, equalHigh);
+        uint32_t greater = (uint32_t)_mm_movemask_epi8(greaterLow) | (uint32_t)_mm_movemask_epi8(greaterHigh) << 16;
+        uint32_t equal = (uint32_t)_mm_movemask_epi8(equalLow) | (uint32_t)_mm_movemask_epi8(equalHigh) << 16;
+        words[i] &= selectBits(comparison, greater, equal);
+        count += __builtin_popcount(words[i]);
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+inline __m256i signBiasAvx2(uint32_t width, bool isSigned) {
+    if(isSigned) {
+        return _mm256_setzero_si256();
+    }
+    return width == 1 ? _mm256_set1_epi8((char)0x80) : width == 2 ? _mm256_set1_epi16((short)0x8000) :
+                                                                    _mm256_set1_epi32((int)0x80000000);
+}
+
+// byte masks of 32 values in order, like compareSse2. The packs work within 128 bit lanes, so the result is
+// permuted back into order
+template<uint32_t WIDTH>
+__attribute__((target("avx2")))
+inline void compareAvx2(const uint8_t* a, const uint8_t* b, __m256i bias, __m256i& greater, __m256i& equal) {
+    __m256i greaters[WIDTH];
+    __m256i equals[WIDTH];
+    for(uint32_t i = 0; i < WIDTH; i++) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i * 32)), bias);
+        __m256i y = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(b + i * 32)), bias);
+        if constexpr(WIDTH == 1) {
+            greaters[i] = _mm256_cmpgt_epi8(x, y);
+            equals[i] = _mm256_cmpeq_epi8(x, y);
+        } else if constexpr(WIDTH == 2) {
+            greaters[i] = _mm256_cmpgt_epi16(x, y);
+            equals[i] = _mm256_cmpeq_epi16(x, y);
+        } else {
+            greaters[i] = _mm256_cmpgt_epi32(x, y);
+            equals[i] = _mm256_cmpeq_epi32(x, y);
+        }
+    }
+    if constexpr(WIDTH == 1) {
+        greater = greaters[0];
+        equal = equals[0];
+    } else if constexpr(WIDTH == 2) {
+        // 64 bit blocks come out as 0 low, 1 low, 0 high, 1 high
+        greater = _mm256_permute4x64_epi64(_mm256_packs_epi16(greaters[0], greaters[1]), 0xD8);
+        equal = _mm256_permute4x64_epi64(_mm256_packs_epi16(equals[0], equals[1]), 0xD8);
+    } else {
+        // 32 bit blocks come out as 0 low, 1 low, 2 low, 3 low, 0 high, 1 high, 2 high, 3 high
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        greater = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(_mm256_packs_epi32(greaters[0], greaters[1]),
+                                                                 _mm256_packs_epi32(greaters[2], greaters[3])), order);
+        equal = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(_mm256_packs_epi32(equals[0], equals[1]),
+                                                               _mm256_packs_epi32(equals[2], equals[3])), order);
+    }
+}
+
+template<uint32_t WIDTH>
+__attribute__((target("avx2")))
+size_t filterAvx2(uint32_t* words, size_t wordCount, const uint8_t* current, const uint8_t* reference,
+                  size_t referenceStep, RamSearch::Comparison comparison, bool isSigned) {
+    const __m256i bias = signBiasAvx2(WIDTH, isSigned);
+    size_t count = 0;
+    for(size_t i = 0; i < wordCount; i++) {
+        if(words[i] == 0) {
+            continue;
+        }
+        __m256i greater, equal;
+        compareAvx2<WIDTH>(current + i * WORD_VALUES * WIDTH, reference + i * referenceStep, bias, greater, equal);
+        words[i] &= selectBits(comparison, (uint32_t)_mm256_movemask_epi8(greater),
+                               (uint32_t)_mm256_movemask_epi8(equal));
+        count += __builtin_popcount(words[i]);
+    }
+    return count;
+}
+#endif
+
+size_t filterWords(RamSearch::Kernel kernel, uint32_t width, uint32_t* words, size_t wordCount,
+                   const uint8_t* current, const uint8_t* reference, size_t referenceStep,
+                   RamSearch::Comparison comparison, bool isSigned) {
+#ifdef RAM_SEARCH_SIMD
+    if(kernel == RamSearch::AVX2) {
+        switch(width) {
+            case 1: return filterAvx2<1>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+            case 2: return filterAvx2<2>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+            default: return filterAvx2<4>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+        }
+    }
+    if(kernel == RamSearch::SSE2) {
+        switch(width) {
+            case 1: return filterSse2<1>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+            case 2: return filterSse2<2>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+            default: return filterSse2<4>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+        }
+    }
+#endif
+    switch(width) {
+        case 1: return filterScalar<1>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+        case 2: return filterScalar<2>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+        default: return filterScalar<4>(words, wordCount, current, reference, referenceStep, comparison, isSigned);
+    }
+}
+
+}
+
+RamSearch::RamSearch(Bus* bus) : bus(bus) {
+    setKernel(AUTO);
+    reset(1, false);
+}
+
+bool RamSearch::isSupported(Kernel kernel) {
+    switch(kernel) {
+#ifdef RAM_SEARCH_SIMD
+        case AVX2: {
+            static const bool avx2 = __builtin_cpu_supports("avx2");
+            return avx2;
+        }
+        case SSE2: {
+            static const bool sse2 = __builtin_cpu_supports("sse2");
+            return sse2;
+        }
+#endif
+        case AUTO:
+        case SCALAR: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+void RamSearch::setKernel(Kernel kernel) {
+    if(kernel == AUTO || !isSupported(kernel)) {
+        kernel = isSupported(AVX2) ? AVX2 : isSupported(SSE2) ? SSE2 : SCALAR;
+    }
+    this->kernel = kernel;
+}
+
+void RamSearch::reset(uint32_t width, bool isSigned) {
+    assert(width == 1 || width == 2 || width == 4);
+    this->width = width;
+    this->isSigned = isSigned;
+    count = (EWRAM_SIZE + IWRAM_SIZE) / width;
+    candidates.assign(count / WORD_VALUES, 0xFFFFFFFF);
+    takeSnapshot();
+}
+
+size_t RamSearch::filterPrevious(Comparison comparison) {
+    return filter(comparison, snapshot.data(), snapshot.data() + EWRAM_SIZE, WORD_VALUES * width);
+}
+
+size_t RamSearch::filterValue(Comparison comparison, uint32_t value) {
+    // one word's worth of the value, reused for every word
+    uint8_t constant[WORD_VALUES * 4];
+    for(uint32_t byte = 0; byte < WORD_VALUES * width; byte++) {
+        constant[byte] = value >> ((byte % width) * 8);
+    }
+    return filter(comparison, constant, constant, 0);
+}
+
+size_t RamSearch::filter(Comparison comparison, const uint8_t* ewramReference, const uint8_t* iwramReference,
+                         size_t referenceStep) {
+    size_t ewramWords = EWRAM_SIZE / width / WORD_VALUES;
+    size_t iwramWords = IWRAM_SIZE / width / WORD_VALUES;
+    count = filterWords(kernel, width, candidates.data(), ewramWords, bus->wRamBoard.data(), ewramReference,
+                        referenceStep, comparison, isSigned) +
+            filterWords(kernel, width, candidates.data() + ewramWords, iwramWords, bus->wRamChip.data(),
+                        iwramReference, referenceStep, comparison, isSigned);
+    takeSnapshot();
+    return count;
+}
+
+size_t RamSearch::getCount() {
+    return count;
+}
+
+std::vector<RamSearch::Candidate> RamSearch::getCandidates(size_t max) {
+    std::vector<Candidate> result;
+    size_t ewramWords = EWRAM_SIZE / width / WORD_VALUES;
+    for(size_t i = 0; i < candidates.size() && result.size() < max; i++) {
+        uint32_t bits = candidates[i];
+        while(bits != 0 && result.size() < max) {
+            uint32_t index = i * WORD_VALUES + __builtin_ctz(bits);
+            bits &= bits - 1;
+            uint32_t offset = index * width;
+            if(i < ewramWords) {
+                result.push_back({0x02000000 + offset, readValue(bus->wRamBoard.data() + offset),
+                                  readValue(snapshot.data() + offset)});
+            } else {
+                result.push_back({0x03000000 + offset - EWRAM_SIZE,
+                                  readValue(bus->wRamChip.data() + offset - EWRAM_SIZE),
+                                  readValue(snapshot.data() + offset)});
+            }
+        }
+    }
+    return result;
+}
+
+void RamSearch::takeSnapshot() {
+    snapshot.resize(EWRAM_SIZE + IWRAM_SIZE);
+    memcpy(snapshot.data(), bus->wRamBoard.data(), EWRAM_SIZE);
+    memcpy(snapshot.data() + EWRAM_SIZE, bus->wRamChip.data(), IWRAM_SIZE);
+}
+
+uint32_t RamSearch::readValue(const uint8_t* memory) {
+    switch(width) {
+        case 1: return readScalar<1>(memory, isSigned);
+        case 2: return readScalar<2>(memory, isSigned);
+        default: return readScalar<4>(memory, isSigned);
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Bus;
+
+/*
+    Ram search over the work ram (256K EWRAM followed by 32K IWRAM), for finding the addresses of game variables:
+    every aligned value of the search's width starts out as a candidate and each filter keeps the candidates whose
+    current value compares to their value in the last snapshot (changed, unchanged, increased, ...) or to a
+    constant. Candidates are a bitset, one bit per value, and filters run 32 values at a time with AVX2 or SSE2
+    compares, skipping whole words of the bitset with no candidates left, so a pass over all of it takes
+    microseconds. Every filter takes a new snapshot afterwards.
+
+    The bus must outlive the search. Filters read the memory directly, call them between frames.
+*/
+class RamSearch {
+
+    public:
+        enum Comparison {
+            EQUAL,
+            NOT_EQUAL,
+            LESS,
+            LESS_OR_EQUAL,
+            GREATER,
+            GREATER_OR_EQUAL
+        };
+
+        struct Candidate {
+            uint32_t address;
+            // the value in memory now and in the last snapshot, sign extended for signed searches
+            uint32_t value;
+            uint32_t previous;
+        };
+
+        // the filter implementation, AUTO picks the fastest one the cpu supports. All of them give the same
+        // candidates, the others are there to be checked against (see test/testRamSearch.cpp)
+        enum Kernel {
+            AUTO,
+            AVX2,
+            SSE2,
+            SCALAR
+        };
+
+        explicit RamSearch(Bus* bus);
+
+        static bool isSupported(Kernel kernel);
+        // an unsupported kernel falls back to AUTO
+        void setKernel(Kernel kernel);
+
+        // starts over with every address as a candidate, width is 1, 2 or 4 bytes
+        void reset(uint32_t width, bool isSigned);
+
+        // current value `comparison` the snapshot value, eg. GREATER keeps the values that increased
+        size_t filterPrevious(Comparison comparison);
+        // current value `comparison` value (truncated to the width)
+        size_t filterValue(Comparison comparison, uint32_t value);
+
+        size_t getCount();
+        // the first max candidates in address order
+        std::vector<Candidate> getCandidates(size_t max);
+
+        static constexpr uint32_t EWRAM_SIZE = 0x40000;
+        static constexpr uint32_t IWRAM_SIZE = 0x8000;
+
+    private:
+        Bus* bus;
+        uint32_t width = 1;
+        bool isSigned = false;
+        Kernel kernel = AUTO;
+        // one bit per value, EWRAM first
+        std::vector<uint32_t> candidates;
+        std::vector<uint8_t> snapshot;
+        size_t count = 0;
+
+        size_t filter(Comparison comparison, const uint8_t* ewramReference, const uint8_t* iwramReference,
+                      size_t referenceStep);
+        void takeSnapshot();
+        uint32_t readValue(const uint8_t* memory);
+};
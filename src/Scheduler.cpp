@@ -2,6 +2,7 @@
 #include "GameBoyAdvanceImpl.h"
 #include <iostream>
 #include "util/macros.h"
+#include "util/Serializer.h"
 
 #include "assert.h"
 
@@ -11,68 +12,49 @@ void Scheduler::addEvent(EventType eventType, uint64_t cyclesInFuture, EventCond
     uint64_t startAt = GameBoyAdvanceImpl::cyclesSinceStart + cyclesInFuture;
 
     EventNode* node = &events[eventType];
+    removeNode(node);
     node->event.active = true;
     node->event.startCycle = startAt;
-    node->next = nullptr;
     node->event.eventCondition = eventCondition;
 
-    if(startNode == nullptr && eventCondition == NULL_CONDITION) {
-        startNode = node;
+    if(eventCondition != NULL_CONDITION && !ignoreCondition) {
+        // scheduled by triggerCondition
+        node->waitingForCondition = true;
+        return;
+    }
+    node->waitingForCondition = false;
+    insertNode(node);
+}
+
+void Scheduler::insertNode(EventNode* node) {
+    EventNode* curr = startNode;
+    EventNode* prev = nullptr;
+    while(curr != nullptr) {
+        if((curr->event.startCycle > node->event.startCycle) || 
+           (curr->event.startCycle == node->event.startCycle && node->event.eventType < curr->event.eventType)) {
+            break;
+        } 
+        prev = curr;
+        curr = curr->next;
+    }
+
+    node->next = curr;
+    if(prev != nullptr) {
+        prev->next = node;
     } else {
-        removeNode(node);
-        EventNode* curr = startNode;
-        EventNode* prev = nullptr;
-        while(curr != nullptr) {
-            if(eventCondition == NULL_CONDITION || ignoreCondition) {
-                if((curr->event.startCycle > startAt) || 
-                (curr->event.startCycle == startAt && eventType < curr->event.eventType)) {
-                    break;
-                } 
-            } else {
-                bool found = false;
-                switch(eventCondition) {
-                    case EventCondition::HBLANK_START:
-                    case EventCondition::DMA3_VIDEO_MODE: {
-                        if(curr->event.eventType == EventType::HBLANK ) {
-                            found = true;
-                            node->event.startCycle = curr->event.startCycle;
-                        }
-                        break;
-                    }
-                    case EventCondition::VBLANK_START: {
-                        if(curr->event.eventType == EventType::VBLANK) {
-                            found = true;
-                            node->event.startCycle = curr->event.startCycle;
-                        }                                
-                        break;
-                    }
-                    default: {
-                        assert(false);
-                        break;
-                    }
-                }
-                if(found) {
-                    // putting the event condition event *after* the event that activates the condition
-                    prev = curr;
-                    curr = curr->next;
-                    while(curr != nullptr && 
-                          curr->event.eventType < eventType && 
-                          curr->event.eventCondition == eventCondition) {
-                        // make sure DMA priority is maintained
-                        curr = curr->next;
-                    }
-                    break;
-                }
-            }
-            prev = curr;
-            curr = curr->next;
-        }
+        startNode = node;
+    }
+}
 
-        node->next = curr;
-        if(prev != nullptr) {
-            prev->next = node;
-        } else {
-            startNode = node;
+void Scheduler::triggerCondition(EventCondition eventCondition) {
+    for(EventNode& node : events) {
+        if(!node.waitingForCondition) {
+            continue;
+        }
+        // video capture dma is started by hblank
+        if(node.event.eventCondition == eventCondition ||
+           (eventCondition == EventCondition::HBLANK_START && node.event.eventCondition == EventCondition::DMA3_VIDEO_MODE)) {
+            addEvent(node.event.eventType, 0, node.event.eventCondition, true);
         }
     }
 }
@@ -118,6 +100,7 @@ Scheduler::Event* Scheduler::peekNextEvent() {
 
 void Scheduler::removeEvent(EventType eventType) {
     EventNode* node = &events[eventType];
+    node->waitingForCondition = false;
     removeNode(node);
 
 }
@@ -137,4 +120,30 @@ void Scheduler::printEventList() {
     }
     std::cout << "]\n";
 
-}  
\ No newline at end of file
+}  
+
+void Scheduler::serialize(Serializer& serializer) {
+    std::array<bool, 13> queued = {};
+    for(EventNode* curr = startNode; curr != nullptr; curr = curr->next) {
+        queued[curr->event.eventType] = true;
+    }
+    serializer.array(queued);
+    for(EventNode& node : events) {
+        serializer.value(node.event.startCycle);
+        serializer.value(node.event.active);
+        serializer.value(node.event.eventCondition);
+        serializer.value(node.waitingForCondition);
+    }
+
+    if(serializer.isLoading()) {
+        startNode = nullptr;
+        for(EventNode& node : events) {
+            node.next = nullptr;
+        }
+        for(EventNode& node : events) {
+            if(queued[node.event.eventType]) {
+                insertNode(&node);
+            }
+        }
+    }
+}
@@ -5,29 +5,32 @@
 #include <list>
 #include <array>
 
+class Serializer;
+
 class Scheduler {
 
     public: 
         //Scheduler();
 
         enum EventType {
+            // the visible part of the current scanline ends / the scanline ends, see VideoTiming
             HBLANK = 0,
-            VBLANK = 1,
+            HBLANK_END = 1,
             
             TIMER0 = 2,
             TIMER1 = 3,
             TIMER2 = 4,
             TIMER3 = 5,
 
-            VBLANK_END = 6,
-            HBLANK_END = 7,
+            NULL_EVENT = 6,
 
-            NULL_EVENT = 8,
+            DMA0 = 7,
+            DMA1 = 8,
+            DMA2 = 9,
+            DMA3 = 10,
 
-            DMA0 = 9,
-            DMA1 = 10,
-            DMA2 = 11,
-            DMA3 = 12,
+            KEYPAD = 11,
+            SERIAL = 12,
         };
 
         enum EventCondition {
@@ -38,11 +41,11 @@ class Scheduler {
         };
 
         static constexpr inline uint8_t convertDmaTypeToDmaVal(EventType dma) {
-            return dma - 9;
+            return dma - DMA0;
         };
 
         static constexpr inline uint8_t convertDmaValToDmaEvent(uint8_t x) {
-            return x + 9;
+            return x + DMA0;
         };
 
 
@@ -53,9 +56,16 @@ class Scheduler {
             EventCondition eventCondition;
         };
 
+        /*
+            Events with an eventCondition other than NULL_CONDITION wait until that condition is triggered
+            (cyclesInFuture is ignored), unless ignoreCondition is set
+        */
         void addEvent(EventType eventType, uint64_t cyclesInFuture, EventCondition EventCondition, bool ignoreCondition);
         void removeEvent(EventType eventType);
 
+        // schedules every event waiting for the condition now, in event type (ie. DMA priority) order
+        void triggerCondition(EventCondition eventCondition);
+
         /*
             get next event with a cycle start less than currentCycle. Removes the event from the queue
 
@@ -67,31 +77,38 @@ class Scheduler {
 
         void printEventList();
 
+        // every event and whether it is queued, the queue order follows from the start cycles
+        void serialize(Serializer& serializer);
+
     private: 
         struct EventNode {
             Event event;
             EventNode* next = nullptr;
             EventNode* prev = nullptr;
+            // not in the list, waiting for triggerCondition
+            bool waitingForCondition = false;
         };
 
          std::array<EventNode, 13> events = {{
                                     {{HBLANK, 0, false, NULL_CONDITION}, nullptr, nullptr}, 
-                                    {{VBLANK, 0, false, NULL_CONDITION}, nullptr, nullptr},
+                                    {{HBLANK_END, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{TIMER0, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{TIMER1, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{TIMER2, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{TIMER3, 0, false, NULL_CONDITION}, nullptr, nullptr},
-                                    {{VBLANK_END, 0, false, NULL_CONDITION}, nullptr, nullptr},
-                                    {{HBLANK_END, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{NULL_EVENT, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{DMA0, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{DMA1, 0, false, NULL_CONDITION}, nullptr, nullptr},
                                     {{DMA2, 0, false, NULL_CONDITION}, nullptr, nullptr},
-                                    {{DMA3, 0, false, NULL_CONDITION}, nullptr, nullptr}
+                                    {{DMA3, 0, false, NULL_CONDITION}, nullptr, nullptr},
+                                    {{KEYPAD, 0, false, NULL_CONDITION}, nullptr, nullptr},
+                                    {{SERIAL, 0, false, NULL_CONDITION}, nullptr, nullptr}
                                 }};
 
         EventNode* startNode = nullptr;
         
         void removeNode(EventNode* eventNode);
+        // inserts the node in start cycle order, ties in event type order
+        void insertNode(EventNode* eventNode);
         
 };
\ No newline at end of file
@@ -0,0 +1,382 @@
+#include "Serial.h"
+#include "memory/Bus.h"
+#include "arm7tdmi/ARM7TDMI.h"
+#include "Scheduler.h"
+#include "GameBoyAdvanceImpl.h"
+#include "util/Serializer.h"
+#include "util/Log.h"
+
+#include <thread>
+#include <algorithm>
+
+
+Serial::~Serial() {
+    disconnectLinkCable();
+}
+
+void Serial::connectBus(std::shared_ptr<Bus> bus) {
+    this->bus = bus;
+}
+
+void Serial::connectCpu(std::shared_ptr<ARM7TDMI> cpu) {
+    this->cpu = cpu;
+}
+
+void Serial::connectScheduler(std::shared_ptr<Scheduler> scheduler) {
+    this->scheduler = scheduler;
+}
+
+bool Serial::connectLinkCable(std::shared_ptr<LinkCable> linkCable) {
+    disconnectLinkCable();
+    uint8_t id = linkCable->attach();
+    if(id == LinkCable::MAX_PLAYERS) {
+        return false;
+    }
+    this->linkCable = linkCable;
+    player = id;
+    linkCable->publishCycles(player, GameBoyAdvanceImpl::cyclesSinceStart);
+    return true;
+}
+
+void Serial::disconnectLinkCable() {
+    if(linkCable) {
+        linkCable->detach(player);
+    }
+    linkCable = nullptr;
+    player = LinkCable::MAX_PLAYERS;
+}
+
+std::shared_ptr<LinkCable> Serial::getLinkCable() {
+    return linkCable;
+}
+
+/*
+    4000134h - RCNT (R/W)
+    Bit 15: 0 = SIOCNT selects the mode, 1 = General Purpose / JOY Bus
+
+    4000128h - SIOCNT
+    Bit 12-13: 0 = Normal 8bit, 1 = Normal 32bit, 2 = Multiplayer, 3 = UART
+*/
+inline
+Serial::Mode Serial::getMode() {
+    if(bus->iORegisters[Bus::IORegister::RCNT + 1] & 0x80) {
+        return GENERAL_PURPOSE;
+    }
+    switch((bus->iORegisters[Bus::IORegister::SIOCNT + 1] & 0x30) >> 4) {
+        case 0: { return NORMAL_8BIT; }
+        case 1: { return NORMAL_32BIT; }
+        case 2: { return MULTIPLAYER; }
+        default: { return UART; }
+    }
+}
+
+inline
+uint16_t Serial::getControl() {
+    return (uint16_t)bus->iORegisters[Bus::IORegister::SIOCNT] |
+           ((uint16_t)bus->iORegisters[Bus::IORegister::SIOCNT + 1] << 8);
+}
+
+inline
+void Serial::setControl(uint16_t control) {
+    bus->iORegisters[Bus::IORegister::SIOCNT] = control & 0xFF;
+    bus->iORegisters[Bus::IORegister::SIOCNT + 1] = control >> 8;
+}
+
+uint32_t Serial::getOutgoingData(Mode mode) {
+    switch(mode) {
+        case NORMAL_8BIT: {
+            return bus->iORegisters[Bus::IORegister::SIODATA8];
+        }
+        case NORMAL_32BIT: {
+            return (uint32_t)bus->iORegisters[Bus::IORegister::SIODATA32] |
+                   ((uint32_t)bus->iORegisters[Bus::IORegister::SIODATA32 + 1] << 8) |
+                   ((uint32_t)bus->iORegisters[Bus::IORegister::SIODATA32 + 2] << 16) |
+                   ((uint32_t)bus->iORegisters[Bus::IORegister::SIODATA32 + 3] << 24);
+        }
+        case MULTIPLAYER: {
+            return (uint32_t)bus->iORegisters[Bus::IORegister::SIOMLT_SEND] |
+                   ((uint32_t)bus->iORegisters[Bus::IORegister::SIOMLT_SEND + 1] << 8);
+        }
+        default: {
+            return disconnectedData;
+        }
+    }
+}
+
+uint32_t Serial::getTransferCycles(Mode mode) {
+    uint16_t control = getControl();
+    switch(mode) {
+        case NORMAL_8BIT:
+        case NORMAL_32BIT: {
+            // bit 1: internal shift clock (0=256KHz, 1=2MHz)
+            uint32_t cyclesPerBit = (control & 0x2) ? 8 : 64;
+            return cyclesPerBit * ((mode == NORMAL_8BIT) ? 8 : 32);
+        }
+        case MULTIPLAYER: {
+            // bit 0-1: baud rate (0-3: 9600, 38400, 57600, 115200 bps)
+            static constexpr uint32_t cyclesPerBit[4] = {1747, 436, 291, 145};
+            uint32_t players = linkCable ? std::max<uint32_t>(linkCable->getPlayerCount(), 1) : 1;
+            // start bit, 16 data bits and a stop bit from each player
+            return cyclesPerBit[control & 0x3] * 18 * players;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+void Serial::updateSerialUponWrite() {
+    uint16_t control = getControl();
+    Mode mode = getMode();
+
+    if(mode == UART || mode == GENERAL_PURPOSE) {
+        // not emulated, SIOCNT bit 7 means something else in UART mode and general purpose mode has no transfers
+        LOG_WARN(GENERAL, (mode == UART ? "UART" : "general purpose") << " serial mode is not supported\n");
+        return;
+    }
+
+    if(mode == MULTIPLAYER) {
+        // bits 2-6 are read only, and so is the busy bit for children
+        control = (control & ~0x007C) | multiplayerStatus;
+        if(linkCable && player != 0) {
+            control &= ~0x80;
+            control |= (multiplayerStatus & 0x80);
+        }
+        setControl(control);
+    }
+
+    if((control & 0x80) && !transferActive) {
+        startTransfer();
+    }
+}
+
+void Serial::startTransfer() {
+    Mode mode = getMode();
+    uint16_t control = getControl();
+
+    if(mode != MULTIPLAYER && !(control & 0x1)) {
+        // external clock, wait for the master to start the transfer
+        return;
+    }
+    if(mode == MULTIPLAYER && linkCable && player != 0) {
+        // only the parent can start a multiplayer transfer
+        return;
+    }
+
+    uint8_t self = linkCable ? player : 0;
+    transferActive = true;
+    transferMode = mode;
+    transferStartCycle = GameBoyAdvanceImpl::cyclesSinceStart;
+    transferEndCycle = transferStartCycle + getTransferCycles(mode);
+    transferData.fill(disconnectedData);
+    transferData[self] = getOutgoingData(mode);
+    waitingForReply.fill(false);
+
+    if(linkCable) {
+        LinkCable::Message message = {LinkCable::Message::START, (uint8_t)mode, transferStartCycle, {}};
+        message.data[0] = transferData[self];
+        for(uint8_t other = 0; other < LinkCable::MAX_PLAYERS; other++) {
+            if(other == player) {
+                continue;
+            }
+            if(linkCable->send(player, other, message)) {
+                waitingForReply[other] = true;
+                if(mode != MULTIPLAYER) {
+                    // normal mode only connects two gbas
+                    break;
+                }
+            }
+        }
+    }
+
+    scheduleSerialEvent();
+}
+
+void Serial::finishTransfer() {
+    // wait for every player that was sent a START, they answer at their next poll (or while they wait for this
+    // instance in waitForPlayers). Only a player that detaches never answers
+    if(linkCable) {
+        linkCable->publishCycles(player, GameBoyAdvanceImpl::cyclesSinceStart);
+    }
+    while(std::any_of(waitingForReply.begin(), waitingForReply.end(), [](bool waiting) { return waiting; })) {
+        serviceLinkCable();
+        for(uint8_t other = 0; other < LinkCable::MAX_PLAYERS; other++) {
+            if(waitingForReply[other] && !linkCable->isConnected(other)) {
+                waitingForReply[other] = false;
+            }
+        }
+        std::this_thread::yield();
+    }
+    transferActive = false;
+
+    uint8_t self = linkCable ? player : 0;
+    if(transferMode == MULTIPLAYER) {
+        if(linkCable) {
+            LinkCable::Message result = {LinkCable::Message::RESULT, (uint8_t)transferMode, transferStartCycle, transferData};
+            for(uint8_t other = 0; other < LinkCable::MAX_PLAYERS; other++) {
+                if(other != player && transferData[other] != disconnectedData) {
+                    linkCable->send(player, other, result);
+                }
+            }
+        }
+        completeMultiplayerTransfer(transferData);
+    } else {
+        uint32_t received = disconnectedData;
+        for(uint8_t other = 0; other < LinkCable::MAX_PLAYERS; other++) {
+            if(other != self && transferData[other] != disconnectedData) {
+                received = transferData[other];
+            }
+        }
+        completeNormalTransfer(transferMode, received);
+    }
+    waitingForReply.fill(false);
+}
+
+void Serial::completeNormalTransfer(Mode mode, uint32_t received) {
+    if(mode == NORMAL_8BIT) {
+        bus->iORegisters[Bus::IORegister::SIODATA8] = received & 0xFF;
+    } else {
+        bus->iORegisters[Bus::IORegister::SIODATA32] = received & 0xFF;
+        bus->iORegisters[Bus::IORegister::SIODATA32 + 1] = (received >> 8) & 0xFF;
+        bus->iORegisters[Bus::IORegister::SIODATA32 + 2] = (received >> 16) & 0xFF;
+        bus->iORegisters[Bus::IORegister::SIODATA32 + 3] = (received >> 24) & 0xFF;
+    }
+
+    // transfer done, clear start bit
+    uint16_t control = getControl() & ~0x80;
+    setControl(control);
+    if(control & 0x4000) {
+        cpu->queueInterrupt(ARM7TDMI::Interrupt::SerialComm);
+    }
+}
+
+/*
+    Multiplayer SIOCNT status bits
+    2     SI-Terminal             (0=Parent, 1=Child)
+    3     SD-Terminal             (0=Bad connection, 1=All GBAs Ready)
+    4-5   Multi-Player ID         (0=Parent, 1-3=1st-3rd child)
+    6     Multi-Player Error      (0=Normal, 1=Error)
+*/
+void Serial::completeMultiplayerTransfer(const std::array<uint32_t, LinkCable::MAX_PLAYERS>& data) {
+    for(uint8_t i = 0; i < LinkCable::MAX_PLAYERS; i++) {
+        bus->iORegisters[Bus::IORegister::SIOMULTI0 + i * 2] = data[i] & 0xFF;
+        bus->iORegisters[Bus::IORegister::SIOMULTI0 + i * 2 + 1] = (data[i] >> 8) & 0xFF;
+    }
+
+    uint8_t self = linkCable ? player : 0;
+    multiplayerStatus = ((self != 0) ? 0x4 : 0) | 0x8 | (self << 4);
+
+    uint16_t control = (getControl() & ~0x00FC) | multiplayerStatus;
+    setControl(control);
+    if(control & 0x4000) {
+        cpu->queueInterrupt(ARM7TDMI::Interrupt::SerialComm);
+    }
+}
+
+void Serial::serviceLinkCable() {
+    if(!linkCable) {
+        return;
+    }
+    LinkCable::Message message;
+    for(uint8_t other = 0; other < LinkCable::MAX_PLAYERS; other++) {
+        if(other == player) {
+            continue;
+        }
+        while(linkCable->receive(player, other, message)) {
+            handleMessage(other, message);
+        }
+    }
+}
+
+void Serial::waitForPlayers() {
+    uint64_t cycles = GameBoyAdvanceImpl::cyclesSinceStart;
+    linkCable->publishCycles(player, cycles);
+    while(cycles > maxSkewCycles && linkCable->getSlowestCycles(player) < cycles - maxSkewCycles) {
+        serviceLinkCable();
+        std::this_thread::yield();
+    }
+}
+
+void Serial::handleMessage(uint8_t from, const LinkCable::Message& message) {
+    switch(message.type) {
+        case LinkCable::Message::START: {
+            LinkCable::Message reply = {LinkCable::Message::REPLY, message.mode, message.cycle, {}};
+            reply.data[0] = disconnectedData;
+
+            Mode mode = (Mode)message.mode;
+            uint16_t control = getControl();
+            if(getMode() == mode) {
+                if(mode == MULTIPLAYER) {
+                    // child is busy until the parent sends the RESULT
+                    reply.data[0] = getOutgoingData(mode);
+                    multiplayerStatus |= 0x80;
+                    setControl(control | 0x80);
+                } else if(!(control & 0x1) && (control & 0x80)) {
+                    // slave is ready (external clock and start bit set), exchange the data
+                    reply.data[0] = getOutgoingData(mode);
+                    completeNormalTransfer(mode, message.data[0]);
+                }
+            }
+            linkCable->send(player, from, reply);
+            break;
+        }
+        case LinkCable::Message::REPLY: {
+            if(transferActive && waitingForReply[from] && message.cycle == transferStartCycle) {
+                transferData[from] = message.data[0];
+                waitingForReply[from] = false;
+            }
+            break;
+        }
+        case LinkCable::Message::RESULT: {
+            multiplayerStatus &= ~0x80;
+            if(getMode() == MULTIPLAYER) {
+                completeMultiplayerTransfer(message.data);
+            }
+            break;
+        }
+    }
+}
+
+void Serial::serialEvent() {
+    if(linkCable) {
+        waitForPlayers();
+    }
+    serviceLinkCable();
+    if(transferActive && GameBoyAdvanceImpl::cyclesSinceStart >= transferEndCycle) {
+        finishTransfer();
+    }
+    scheduleSerialEvent();
+}
+
+void Serial::scheduleSerialEvent() {
+    scheduler->removeEvent(Scheduler::EventType::SERIAL);
+
+    uint64_t cyclesInFuture;
+    if(transferActive) {
+        cyclesInFuture = (transferEndCycle > GameBoyAdvanceImpl::cyclesSinceStart) ?
+                         (transferEndCycle - GameBoyAdvanceImpl::cyclesSinceStart) : 0;
+        if(linkCable) {
+            cyclesInFuture = std::min<uint64_t>(cyclesInFuture, pollIntervalCycles);
+        }
+    } else if(linkCable) {
+        cyclesInFuture = pollIntervalCycles;
+    } else {
+        // nothing to do until a transfer is started
+        return;
+    }
+
+    scheduler->addEvent(Scheduler::EventType::SERIAL,
+                        cyclesInFuture,
+                        Scheduler::EventCondition::NULL_CONDITION,
+                        false);
+}
+
+void Serial::serialize(Serializer& serializer) {
+    serializer.value(transferActive);
+    serializer.value(transferMode);
+    serializer.value(transferStartCycle);
+    serializer.value(transferEndCycle);
+    serializer.array(transferData);
+    serializer.array(waitingForReply);
+    serializer.value(multiplayerStatus);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include "LinkCable.h"
+
+class Bus;
+class ARM7TDMI;
+class Scheduler;
+class Serializer;
+
+/*
+    Serial port emulation over an in-process LinkCable. Supports Normal 8bit/32bit and Multiplayer mode, UART and
+    general purpose mode are not emulated (the port acts as if nothing were connected).
+    The master (internal clock / multiplayer parent) sends START to the other players and waits for their
+    REPLY when its own transfer finishes. Every player polls the cable once per scanline, answers what it received
+    and publishes its cycle count. A player more than maxSkewCycles ahead of another connected player waits for it
+    (still answering messages), so the instances never drift further apart than that in emulated time whatever the
+    host's scheduling, and a master always gets its replies.
+    Linked instances must each run on their own thread, an instance that stops running while it is attached stalls
+    the others until it is detached (also done when it is destroyed).
+*/
+class Serial {
+
+    public:
+        ~Serial();
+
+        void connectBus(std::shared_ptr<Bus> bus);
+        void connectCpu(std::shared_ptr<ARM7TDMI> cpu);
+        void connectScheduler(std::shared_ptr<Scheduler> scheduler);
+
+        // returns false if the cable already has MAX_PLAYERS attached
+        bool connectLinkCable(std::shared_ptr<LinkCable> linkCable);
+        void disconnectLinkCable();
+        std::shared_ptr<LinkCable> getLinkCable();
+
+        // called after SIOCNT has been written to
+        void updateSerialUponWrite();
+
+        // scheduled event, services the link cable and finishes the current transfer
+        void serialEvent();
+        void scheduleSerialEvent();
+
+        // the current transfer, the link cable itself is not saved
+        void serialize(Serializer& serializer);
+
+    private:
+        enum Mode {
+            NORMAL_8BIT,
+            NORMAL_32BIT,
+            MULTIPLAYER,
+            UART,
+            GENERAL_PURPOSE
+        };
+
+        std::shared_ptr<Bus> bus;
+        std::shared_ptr<ARM7TDMI> cpu;
+        std::shared_ptr<Scheduler> scheduler;
+        std::shared_ptr<LinkCable> linkCable;
+
+        uint8_t player = LinkCable::MAX_PLAYERS;
+
+        Mode getMode();
+        uint16_t getControl();
+        void setControl(uint16_t control);
+        uint32_t getOutgoingData(Mode mode);
+        uint32_t getTransferCycles(Mode mode);
+
+        void startTransfer();
+        void finishTransfer();
+        void completeNormalTransfer(Mode mode, uint32_t received);
+        void completeMultiplayerTransfer(const std::array<uint32_t, LinkCable::MAX_PLAYERS>& data);
+
+        void serviceLinkCable();
+        // publishes the cycle count and waits until no connected player is more than maxSkewCycles behind
+        void waitForPlayers();
+        void handleMessage(uint8_t from, const LinkCable::Message& message);
+
+        bool transferActive = false;
+        Mode transferMode = NORMAL_8BIT;
+        uint64_t transferStartCycle = 0;
+        uint64_t transferEndCycle = 0;
+        std::array<uint32_t, LinkCable::MAX_PLAYERS> transferData = {};
+        std::array<bool, LinkCable::MAX_PLAYERS> waitingForReply = {};
+
+        // bits 2-6 of SIOCNT in multiplayer mode are read only
+        uint16_t multiplayerStatus = 0;
+
+        // one scanline
+        static constexpr uint32_t pollIntervalCycles = 1232;
+        static constexpr uint64_t maxSkewCycles = 8 * pollIntervalCycles;
+        static constexpr uint32_t disconnectedData = 0xFFFFFFFF;
+};
@@ -0,0 +1,180 @@
+#include "SessionHost.h"
+#include "GameBoyAdvanceImpl.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+uint64_t getCurrentTimeNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+SessionHost::SessionHost(uint32_t threads) {
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = threads;
+}
+
+SessionHost::~SessionHost() {
+    stop();
+}
+
+uint32_t SessionHost::addSession(std::unique_ptr<GameBoyAdvanceImpl> gba) {
+    std::unique_ptr<Session> session = std::make_unique<Session>();
+    session->gba = std::move(gba);
+    uint32_t index;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        index = sessions.size();
+        session->index = index;
+        session->deadline = getCurrentTimeNanoseconds() + FRAME_NANOSECONDS;
+        sessions.push_back(std::move(session));
+    }
+    wake.notify_one();
+    return index;
+}
+
+uint32_t SessionHost::getSessionCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions.size();
+}
+
+void SessionHost::setFrameCallback(FrameCallback callback) {
+    frameCallback = callback;
+}
+
+void SessionHost::setMaxFrameSkip(uint32_t frames) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxFrameSkip = frames;
+}
+
+void SessionHost::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(running) {
+        return;
+    }
+    running = true;
+    stopping = false;
+    // time spent stopped doesn't count as lag
+    uint64_t now = getCurrentTimeNanoseconds();
+    for(std::unique_ptr<Session>& session : sessions) {
+        session->deadline = now + FRAME_NANOSECONDS;
+    }
+    for(uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&SessionHost::workerLoop, this, i);
+    }
+}
+
+void SessionHost::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!running) {
+            return;
+        }
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+}
+
+void SessionHost::setKeyState(uint32_t session, uint16_t keys) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sessions[session]->keys = keys;
+}
+
+SessionHost::Stats SessionHost::getStats(uint32_t session) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions[session]->stats;
+}
+
+SessionHost::Session* SessionHost::pickSession(uint64_t now, uint64_t& nextRelease) {
+    // a linear scan, there are tens of sessions and it happens once per frame per session
+    Session* next = nullptr;
+    nextRelease = UINT64_MAX;
+    for(std::unique_ptr<Session>& session : sessions) {
+        if(session->running) {
+            continue;
+        }
+        uint64_t release = session->deadline - FRAME_NANOSECONDS;
+        if(release > now) {
+            nextRelease = std::min(nextRelease, release);
+        } else if(!next || session->deadline < next->deadline) {
+            next = session.get();
+        }
+    }
+    return next;
+}
+
+void SessionHost::workerLoop(uint32_t worker) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!stopping) {
+        uint64_t now = getCurrentTimeNanoseconds();
+        uint64_t nextRelease;
+        Session* session = pickSession(now, nextRelease);
+        if(!session) {
+            if(nextRelease == UINT64_MAX) {
+                wake.wait(lock);
+            } else {
+                wake.wait_for(lock, std::chrono::nanoseconds(nextRelease - now));
+            }
+            continue;
+        }
+
+        if(now > session->deadline + MAX_LAG * FRAME_NANOSECONDS) {
+            // too far behind to catch up by skipping rendering, give up on the frames it missed entirely
+            uint64_t missedFrames = (now - session->deadline) / FRAME_NANOSECONDS;
+            session->deadline += missedFrames * FRAME_NANOSECONDS;
+            session->stats.droppedFrames += missedFrames;
+        }
+        bool skip = session->consecutiveSkips < maxFrameSkip && now + session->frameNanoseconds > session->deadline;
+        session->consecutiveSkips = skip ? session->consecutiveSkips + 1 : 0;
+        if(session->lastWorker != worker && session->lastWorker != UINT32_MAX) {
+            session->stats.migrations++;
+        }
+        session->lastWorker = worker;
+        session->running = true;
+
+        lock.unlock();
+        bool rendered = runFrame(*session, skip);
+        uint64_t finished = getCurrentTimeNanoseconds();
+        lock.lock();
+
+        // the first frame sets the estimate, later ones are smoothed in
+        uint64_t elapsed = finished - now;
+        session->frameNanoseconds = session->stats.frames == 0 ? elapsed : (session->frameNanoseconds * 7 + elapsed) / 8;
+        session->stats.frames++;
+        session->stats.skippedFrames += rendered ? 0 : 1;
+        if(finished > session->deadline) {
+            session->stats.deadlineMisses++;
+            session->stats.worstLatenessNanoseconds = std::max(session->stats.worstLatenessNanoseconds,
+                                                               finished - session->deadline);
+        }
+        session->deadline += FRAME_NANOSECONDS;
+        session->running = false;
+    }
+}
+
+bool SessionHost::runFrame(Session& session, bool skip) {
+    GameBoyAdvanceImpl& gba = *session.gba;
+    GameBoyAdvanceImpl::cyclesSinceStart = session.cycles;
+    gba.setKeyState(session.keys);
+    // latched at the end of line 226, which is emulated in this frame (except in the very first one)
+    gba.setSkipRendering(skip);
+    bool rendered = !skip || session.stats.frames == 0;
+    gba.runFrame();
+    session.cycles = GameBoyAdvanceImpl::cyclesSinceStart;
+
+    if(frameCallback) {
+        frameCallback(session.index, gba, rendered);
+    }
+    return rendered;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class GameBoyAdvanceImpl;
+
+/*
+    Runs many headless sessions (machines) in one process in real time on a fixed set of worker threads.
+    Every session has a deadline for its next frame, one frame period (280896 cycles at 16.78MHz) after the last
+    one, and becomes ready one period before it. Idle workers take the ready session with the earliest deadline
+    and emulate one frame of it, so sessions move freely between workers from frame to frame. The only thread
+    bound emulator state, GameBoyAdvanceImpl::cyclesSinceStart, is kept per session and swapped in around the frame.
+
+    When the host can't keep up, sessions that would finish late skip rendering (up to maxFrameSkip frames in a
+    row, PPU::setSkipRendering) and a session more than MAX_LAG frames behind drops frames to catch up with real
+    time instead of running fast forward. Frames finished after their deadline are counted as deadline misses.
+*/
+class SessionHost {
+
+    public:
+        struct Stats {
+            // frames emulated, skippedFrames of them without rendering
+            uint64_t frames = 0;
+            uint64_t skippedFrames = 0;
+            // frames never emulated because the session was too far behind
+            uint64_t droppedFrames = 0;
+            uint64_t deadlineMisses = 0;
+            uint64_t worstLatenessNanoseconds = 0;
+            // frames run on another worker than the one before
+            uint64_t migrations = 0;
+        };
+
+        // called on the worker that ran the frame, rendered is false if the frame was skipped (the last rendered
+        // frame is still in the ppu). Must not block for long, the worker is not available for other sessions
+        using FrameCallback = std::function<void(uint32_t session, GameBoyAdvanceImpl& gba, bool rendered)>;
+
+        static constexpr uint64_t FRAME_NANOSECONDS = 280896ull * 1000000000 / 16777216;
+        static constexpr uint64_t MAX_LAG = 4;
+
+        // 0 uses the hardware concurrency
+        explicit SessionHost(uint32_t threads = 0);
+        ~SessionHost();
+
+        // the machine must be headless with a rom loaded. Can be called while running, the session's first
+        // deadline is one frame from now. Returns the session index
+        uint32_t addSession(std::unique_ptr<GameBoyAdvanceImpl> gba);
+        uint32_t getSessionCount();
+
+        // before start
+        void setFrameCallback(FrameCallback callback);
+        // 0 never skips rendering
+        void setMaxFrameSkip(uint32_t frames);
+
+        void start();
+        // waits for the frames in progress
+        void stop();
+
+        // KEYINPUT format (0=Pressed, 1=Released), safe from any thread, applied from the session's next frame
+        void setKeyState(uint32_t session, uint16_t keys);
+        Stats getStats(uint32_t session);
+
+    private:
+        struct Session {
+            uint32_t index;
+            std::unique_ptr<GameBoyAdvanceImpl> gba;
+            // GameBoyAdvanceImpl::cyclesSinceStart of the session while it isn't running
+            uint64_t cycles = 0;
+            std::atomic<uint16_t> keys = {0x3FF};
+
+            // the rest is guarded by mutex
+            uint64_t deadline = 0;
+            bool running = false;
+            uint32_t lastWorker = UINT32_MAX;
+            uint32_t consecutiveSkips = 0;
+            // moving average of the host time per frame
+            uint64_t frameNanoseconds = 0;
+            Stats stats;
+        };
+
+        uint32_t threadCount;
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<Session>> sessions;
+        FrameCallback frameCallback;
+        uint32_t maxFrameSkip = 2;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool running = false;
+        bool stopping = false;
+
+        void workerLoop(uint32_t worker);
+        // earliest deadline among the ready sessions, nullptr if none. nextRelease is set to the earliest time
+        // a waiting session becomes ready
+        Session* pickSession(uint64_t now, uint64_t& nextRelease);
+        // returns true if the frame was rendered
+        bool runFrame(Session& session, bool skip);
+};
@@ -2,50 +2,45 @@
 #include "memory/Bus.h"
 #include "arm7tdmi/ARM7TDMI.h"
 #include "Scheduler.h"
+#include "DMA.h"
 #include "GameBoyAdvanceImpl.h"
+#include "util/Serializer.h"
+
+#include <algorithm>
 
 
 /*
-    update IORegister state in bus because about to read from the timer
+    read from the timer registers, the counters are derived from the timer state 
+    rather than being written through to the IORegisters
 */
-uint8_t Timer::updateBusToPrepareForTimerRead(uint32_t address, uint8_t width) {
-    // manually preparing the memory so that what's read will be up to date
-    switch(address) {
-        case 0x4000100: {
-            calculateTimerXCounter(0, GameBoyAdvanceImpl::cyclesSinceStart);
-            bus->iORegisters[Bus::IORegister::TM0CNT_L] = timerCounter[0]; 
-            bus->iORegisters[Bus::IORegister::TM0CNT_L + 1] = (timerCounter[0]) >> 8; 
-            break;
-        }
-        case 0x4000104: {
-            calculateTimerXCounter(1, GameBoyAdvanceImpl::cyclesSinceStart);
-            bus->iORegisters[Bus::IORegister::TM1CNT_L] = timerCounter[1]; 
-            bus->iORegisters[Bus::IORegister::TM1CNT_L + 1] = (timerCounter[1]) >> 8; 
-            break;
-        }
-        case 0x4000108: {
-            calculateTimerXCounter(2, GameBoyAdvanceImpl::cyclesSinceStart);
-            bus->iORegisters[Bus::IORegister::TM2CNT_L] = timerCounter[2]; 
-            bus->iORegisters[Bus::IORegister::TM2CNT_L + 1] = (timerCounter[2]) >> 8; 
-            break;
-        }
-        case 0x400010C: {
-            calculateTimerXCounter(3, GameBoyAdvanceImpl::cyclesSinceStart);
-            bus->iORegisters[Bus::IORegister::TM3CNT_L] = timerCounter[3]; 
-            bus->iORegisters[Bus::IORegister::TM3CNT_L + 1] = (timerCounter[3]) >> 8; 
-            break;
-        } 
-        default: {
-            break;
+uint32_t Timer::readTimerRegisters(uint32_t address, uint8_t width) {
+    uint32_t value = 0;
+    for(uint8_t shift = 0; shift < width; shift += 8) {
+        uint32_t byteAddress = address + (shift >> 3);
+        uint8_t byte;
+        if(0x4000100 <= byteAddress && byteAddress <= 0x400010F && !(byteAddress & 0x2)) {
+            // TMxCNT_L
+            uint16_t counter = getTimerXCounter((byteAddress - 0x4000100) >> 2);
+            byte = (byteAddress & 0x1) ? (counter >> 8) : counter;
+        } else {
+            byte = bus->iORegisters[byteAddress - 0x4000000];
         }
+        value |= (uint32_t)byte << shift;
     }
-    return 0;
+    return value;
+}
+
+uint16_t Timer::getTimerXCounter(uint8_t x) {
+    return calculateTimerXCounter(x, GameBoyAdvanceImpl::cyclesSinceStart);
 }
 
 /*
     update Timer state upon write
 */
 void Timer::updateTimerUponWrite(uint32_t address, uint32_t value, uint8_t width) {
+    // bring every timer up to date using the old settings before changing them
+    advanceTimers(GameBoyAdvanceImpl::cyclesSinceStart);
+
     while(width != 0) {
         uint8_t byte = value & 0xFF;
 
@@ -123,7 +118,8 @@ void Timer::updateTimerUponWrite(uint32_t address, uint32_t value, uint8_t width
         address += 1;
         value = value >> 8;
     }
-    return;
+
+    scheduleTimerEvents();
 }
 
 inline
@@ -132,18 +128,6 @@ void Timer::setTimerXControlHi(uint8_t val, uint8_t x) {
 
 inline
 void Timer::setTimerXControlLo(uint8_t val, uint8_t x) {
-    Scheduler::EventType timerEvent;
-    switch(x) {
-        case 0: { timerEvent = Scheduler::EventType::TIMER0; break; }
-        case 1: { timerEvent = Scheduler::EventType::TIMER1; break; }
-        case 2: { timerEvent = Scheduler::EventType::TIMER2; break; }
-        case 3: { timerEvent = Scheduler::EventType::TIMER3; break; }
-        default: { break; }
-    }
-
-    // remove old event
-    scheduler->removeEvent(timerEvent);
-
     uint8_t prescalerSelection = val & 0x3;
     switch(prescalerSelection) {
         case 0: { timerPrescaler[x] = 1; break; }
@@ -156,32 +140,12 @@ void Timer::setTimerXControlLo(uint8_t val, uint8_t x) {
     if(!timerStart[x] && (val & 0x80)) {
         // reload value is copied into the counter when the timer start bit becomes changed from 0 to 1.
         timerCounter[x] = timerReload[x];
+        timerExcessCycles[x] = 0;
     }
 
-    uint64_t cyclesPassed = GameBoyAdvanceImpl::cyclesSinceStart;
-
-    // update counter
-    calculateTimerXCounter(x, cyclesPassed);
-
     timerCountUp[x] = val & 0x4;
     timerIrqEnable[x] = val & 0x40;
     timerStart[x] = val & 0x80;
-
-    if((val & 0x80) && !(val & 0x4)) {
-        // only schedule if the timer is not count-up (since count up timers will automatically overflow)
-        // timer enabled, so schedule new event
-        if(timerCounter[x] > 0xFFFF) { // if overflow
-            DEBUGWARN("timer overflowed outside of scheduled event!\n");
-            // schedule timer to run immediately
-            scheduler->addEvent(timerEvent, 0, Scheduler::EventCondition::NULL_CONDITION, false);
-        } else {
-            // add event at time when timer will go off
-            scheduler->addEvent(timerEvent, 
-                                (0x10000 - timerCounter[x]) * timerPrescaler[x], 
-                                Scheduler::EventCondition::NULL_CONDITION,
-                                false);
-        }
-    }
 }
 
 inline
@@ -206,46 +170,15 @@ void Timer::connectScheduler(std::shared_ptr<Scheduler> scheduler) {
     this->scheduler = scheduler;
 }
 
+void Timer::connectDma(std::shared_ptr<DMA> dma) {
+    this->dma = dma;
+}
 
-void Timer::timerXOverflowEvent(uint8_t x) {
-    calculateTimerXCounter(x, GameBoyAdvanceImpl::cyclesSinceStart);
-    if(timerCounter[x] <= 0xFFFF) {
-        DEBUGWARN("timer didn't overflow! scheduling error\n");
-        scheduler->printEventList();
-        return;
-    }
-
-    if(timerIrqEnable[x]) {
-        queueTimerInterrupt(x);
-    }
 
-    timerCounter[x] = timerReload[x];
-    uint8_t cascadeX = x + 1;
-    bool overflow = true;
-    while(overflow && cascadeX <= 3 && timerCountUp[cascadeX] && timerStart[cascadeX]) {
-        timerCounter[cascadeX] += 1;
-        if(timerCounter[cascadeX] > 0xFFFF) {
-            if(timerIrqEnable[cascadeX]) {
-                queueTimerInterrupt(cascadeX);
-            }
-            timerCounter[cascadeX] = timerReload[cascadeX];
-        } else {
-            overflow = false;
-        }
-        cascadeX++;
-    }
-    Scheduler::EventType timerEvent;
-    switch(x) {
-        case 0: { timerEvent = Scheduler::EventType::TIMER0; break; }
-        case 1: { timerEvent = Scheduler::EventType::TIMER1; break; }
-        case 2: { timerEvent = Scheduler::EventType::TIMER2; break; }
-        case 3: { timerEvent = Scheduler::EventType::TIMER3; break; }
-        default: { break; }
-    }
-    scheduler->addEvent(timerEvent,
-                       (0x10000 - timerCounter[x]) * timerPrescaler[x], 
-                        Scheduler::EventCondition::NULL_CONDITION, 
-                        false);
+void Timer::timerXOverflowEvent(uint8_t x) {
+    // interrupts for every timer in the chain are queued while advancing
+    advanceTimers(GameBoyAdvanceImpl::cyclesSinceStart);
+    scheduleTimerEvents();
 }
 
 inline
@@ -274,20 +207,147 @@ void Timer::queueTimerInterrupt(uint8_t x) {
 }
 
 inline
-void Timer::calculateTimerXCounter(uint8_t x, uint64_t cyclesPassed) {
-    // update counter
-    if(!timerCountUp[x]) {
-        if(timerStart[x]) {
-            uint32_t increments = ((cyclesPassed - timerCycleOfLastUpdate[x]) + timerExcessCycles[x]) / timerPrescaler[x];
-
-            if(increments != 0) {
-                timerExcessCycles[x] = ((cyclesPassed - timerCycleOfLastUpdate[x]) + timerExcessCycles[x]) % (timerPrescaler[x]);
-            } else {
-                timerExcessCycles[x] += (cyclesPassed - timerCycleOfLastUpdate[x]);
+bool Timer::isTimerXCountUp(uint8_t x) {
+    // count-up timing is ignored for timer 0, since there is no timer below it
+    return x != 0 && timerCountUp[x];
+}
+
+uint64_t Timer::getTimerXTicks(uint8_t x, uint64_t currentCycle) {
+    if(!timerStart[x]) {
+        return 0;
+    }
+    if(isTimerXCountUp(x)) {
+        // count-up timers tick once every time the timer below them overflows
+        return getTimerXOverflows(x - 1, currentCycle);
+    }
+    return ((currentCycle - timerCycleOfLastUpdate) + timerExcessCycles[x]) / timerPrescaler[x];
+}
+
+uint64_t Timer::getTimerXOverflows(uint8_t x, uint64_t currentCycle) {
+    uint64_t ticks = getTimerXTicks(x, currentCycle);
+    uint64_t ticksUntilFirstOverflow = 0x10000 - timerCounter[x];
+    if(ticks < ticksUntilFirstOverflow) {
+        return 0;
+    }
+    // after the first overflow the counter restarts from the reload value
+    return 1 + (ticks - ticksUntilFirstOverflow) / (0x10000 - timerReload[x]);
+}
+
+uint16_t Timer::calculateTimerXCounter(uint8_t x, uint64_t currentCycle) {
+    uint64_t ticks = getTimerXTicks(x, currentCycle);
+    uint64_t ticksUntilFirstOverflow = 0x10000 - timerCounter[x];
+    if(ticks < ticksUntilFirstOverflow) {
+        return timerCounter[x] + ticks;
+    }
+    return timerReload[x] + (ticks - ticksUntilFirstOverflow) % (0x10000 - timerReload[x]);
+}
+
+uint64_t Timer::getChainTicksUntilOverflow(uint8_t chainStart, uint8_t x, uint64_t n) {
+    uint64_t ticksUntilFirstOverflow = 0x10000 - timerCounter[x];
+    uint64_t period = 0x10000 - timerReload[x];
+    if((n - 1) > (maxEventCycles - ticksUntilFirstOverflow) / period) {
+        // so far in the future that it will never be reached, avoid overflowing
+        return maxEventCycles;
+    }
+    uint64_t ticks = ticksUntilFirstOverflow + (n - 1) * period;
+    if(x == chainStart) {
+        return ticks;
+    }
+    // timer x needs one overflow of the timer below it for each of its ticks
+    return getChainTicksUntilOverflow(chainStart, x - 1, ticks);
+}
+
+void Timer::advanceTimers(uint64_t currentCycle) {
+    uint16_t counters[4];
+    uint64_t overflows[4];
+
+    // all timers must be calculated before any state is changed, since count-up timers depend on the timers below them
+    for(uint8_t x = 0; x < 4; x++) {
+        counters[x] = calculateTimerXCounter(x, currentCycle);
+        overflows[x] = getTimerXOverflows(x, currentCycle);
+    }
+
+    for(uint8_t x = 0; x < 4; x++) {
+        if(overflows[x] != 0 && timerIrqEnable[x]) {
+            queueTimerInterrupt(x);
+        }
+        if(timerStart[x] && !isTimerXCountUp(x)) {
+            timerExcessCycles[x] = ((currentCycle - timerCycleOfLastUpdate) + timerExcessCycles[x]) % timerPrescaler[x];
+        }
+        timerCounter[x] = counters[x];
+    }
+    timerCycleOfLastUpdate = currentCycle;
+
+    // fifo refills are charged to the current cycle once the timers are up to date
+    for(uint8_t x = 0; x < 2; x++) {
+        if(overflows[x] != 0) {
+            dma->soundTimerOverflow(x, overflows[x]);
+        }
+    }
+}
+
+void Timer::scheduleTimerEvents() {
+    for(uint8_t chainStart = 0; chainStart < 4; chainStart++) {
+        Scheduler::EventType timerEvent;
+        switch(chainStart) {
+            case 0: { timerEvent = Scheduler::EventType::TIMER0; break; }
+            case 1: { timerEvent = Scheduler::EventType::TIMER1; break; }
+            case 2: { timerEvent = Scheduler::EventType::TIMER2; break; }
+            case 3: { timerEvent = Scheduler::EventType::TIMER3; break; }
+            default: { break; }
+        }
+
+        // remove old event
+        scheduler->removeEvent(timerEvent);
+
+        if(!timerStart[chainStart] || isTimerXCountUp(chainStart)) {
+            // count-up timers are handled by the event of the first timer in their chain
+            continue;
+        }
+
+        // find the earliest overflow in the chain that has to raise an interrupt or refill a sound fifo,
+        // other overflows don't need an event since the counters are calculated on demand
+        uint64_t ticksUntilEvent = maxEventCycles;
+        for(uint8_t x = chainStart; x < 4; x++) {
+            if(x != chainStart && !(isTimerXCountUp(x) && timerStart[x])) {
+                // end of the chain
+                break;
+            }
+            if(timerIrqEnable[x]) {
+                ticksUntilEvent = std::min(ticksUntilEvent, getChainTicksUntilOverflow(chainStart, x, 1));
+            }
+            uint64_t fifoOverflows = x < 2 ? dma->getSoundFifoOverflowsUntilRefill(x) : 0;
+            if(fifoOverflows != 0) {
+                ticksUntilEvent = std::min(ticksUntilEvent, getChainTicksUntilOverflow(chainStart, x, fifoOverflows));
             }
-            
-            timerCounter[x] += increments; 
         }
-        timerCycleOfLastUpdate[x] = cyclesPassed;
+
+        if(ticksUntilEvent == maxEventCycles) {
+            continue;
+        }
+
+        // the first timer in the chain may be part way through a prescaler period
+        uint64_t cyclesUntilEvent = ticksUntilEvent > (maxEventCycles / timerPrescaler[chainStart]) ? 
+                                    maxEventCycles :
+                                    ticksUntilEvent * timerPrescaler[chainStart] - timerExcessCycles[chainStart];
+        // fifo refills charged while advancing have moved the current cycle past the last update
+        uint64_t cyclesSinceUpdate = GameBoyAdvanceImpl::cyclesSinceStart - timerCycleOfLastUpdate;
+        cyclesUntilEvent = cyclesUntilEvent > cyclesSinceUpdate ? cyclesUntilEvent - cyclesSinceUpdate : 0;
+
+        scheduler->addEvent(timerEvent, 
+                            cyclesUntilEvent, 
+                            Scheduler::EventCondition::NULL_CONDITION,
+                            false);
     }
-}     
+}
+
+void Timer::serialize(Serializer& serializer) {
+    serializer.array(timerPrescaler);
+    serializer.array(timerStart);
+    serializer.array(timerExcessCycles);
+    serializer.value(timerCycleOfLastUpdate);
+    serializer.array(timerCounter);
+    serializer.array(timerReload);
+    serializer.array(timerCountUp);
+    serializer.array(timerIrqEnable);
+}
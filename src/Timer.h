@@ -4,24 +4,36 @@
 class Bus;
 class ARM7TDMI;
 class Scheduler;
+class Serializer;
+class DMA;
 
 
 class Timer {
 
-    public: 
-        void step(uint64_t cyclesElapsed);
-        uint8_t updateBusToPrepareForTimerRead(uint32_t address, uint8_t width);
+    public:
+        uint32_t readTimerRegisters(uint32_t address, uint8_t width);
         void updateTimerUponWrite(uint32_t address, uint32_t value, uint8_t width);
         void connectBus(std::shared_ptr<Bus> bus);
         void connectCpu(std::shared_ptr<ARM7TDMI> cpu);
         void connectScheduler(std::shared_ptr<Scheduler> scheduler);
+        void connectDma(std::shared_ptr<DMA> dma);
+
+        // x is always the first (non count-up) timer of a cascade chain,
+        // one event is scheduled per chain
         void timerXOverflowEvent(uint8_t x);
 
-        void updateTimer(uint32_t ioReg, uint8_t newValue);
+        uint16_t getTimerXCounter(uint8_t x);
 
-    private:
-        void stepTimerX(uint64_t cycles, uint8_t x);
+        // brings every timer up to currentCycle, queueing the interrupts of any timers that overflowed
+        // and playing the sound fifos clocked by timers 0 and 1 (see DMA::soundTimerOverflow)
+        void advanceTimers(uint64_t currentCycle);
+
+        // schedules the next overflow that needs to be handled (an irq or a sound fifo refill) of each chain
+        void scheduleTimerEvents();
+
+        void serialize(Serializer& serializer);
 
+    private:
         void setTimerXReloadLo(uint8_t val, uint8_t x);
         void setTimerXReloadHi(uint8_t val, uint8_t x);
 
@@ -30,7 +42,20 @@ class Timer {
 
         void queueTimerInterrupt(uint8_t x);
 
-        void calculateTimerXCounter(uint8_t x, uint64_t cyclesPassed);
+        /*
+            all timer state is stored relative to timerCycleOfLastUpdate (the same cycle for every timer).
+            the number of ticks, overflows and the current counter are derived from it analytically,
+            so count-up timers never need to be stepped when the timer below them overflows
+        */
+        bool isTimerXCountUp(uint8_t x);
+        uint64_t getTimerXTicks(uint8_t x, uint64_t currentCycle);
+        uint64_t getTimerXOverflows(uint8_t x, uint64_t currentCycle);
+        uint16_t calculateTimerXCounter(uint8_t x, uint64_t currentCycle);
+
+        // number of ticks of the first timer in the chain needed for the nth overflow of timer x
+        uint64_t getChainTicksUntilOverflow(uint8_t chainStart, uint8_t x, uint64_t n);
+
+        static constexpr uint64_t maxEventCycles = 0x4000000000000000;
 
         uint32_t timerPrescaler[4] = {1, 1, 1, 1};
 
@@ -38,7 +63,7 @@ class Timer {
 
         uint32_t timerExcessCycles[4] = {0, 0, 0, 0};
 
-        uint64_t timerCycleOfLastUpdate[4] = {0, 0, 0, 0};
+        uint64_t timerCycleOfLastUpdate = 0;
 
         uint32_t timerCounter[4] = {0, 0, 0, 0};
 
@@ -52,5 +77,6 @@ class Timer {
         std::shared_ptr<Bus> bus;
         std::shared_ptr<ARM7TDMI> cpu;
         std::shared_ptr<Scheduler> scheduler;
+        std::shared_ptr<DMA> dma;
 
 };
@@ -0,0 +1,281 @@
+#include "Upscaler.h"
+#include "util/WorkerPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+Upscaler::Upscaler() {}
+
+Upscaler::~Upscaler() {}
+
+void Upscaler::setFilter(Filter filter, uint32_t scale) {
+    this->filter = filter;
+    switch(filter) {
+        case NONE: {
+            this->scale = 1;
+            break;
+        }
+        case NEAREST: {
+            this->scale = std::min(std::max(scale, 1u), 8u);
+            break;
+        }
+        case SCALE2X:
+        case XBR2X: {
+            this->scale = 2;
+            break;
+        }
+        case SCALE3X: {
+            this->scale = 3;
+            break;
+        }
+    }
+    if(filter != NONE && !workerPool) {
+        workerPool = std::make_unique<WorkerPool>();
+    }
+}
+
+Upscaler::Filter Upscaler::getFilter() {
+    return filter;
+}
+
+uint32_t Upscaler::getScale() {
+    return scale;
+}
+
+template <typename RowTask>
+void Upscaler::forEachRow(uint32_t height, RowTask rowTask) {
+    // a few bands per thread so uneven bands (ie. edges in xBR) balance out
+    uint32_t bands = std::min(height, workerPool->getThreadCount() * 4);
+    uint32_t bandHeight = (height + bands - 1) / bands;
+    workerPool->run(bands, [&](size_t band) {
+        uint32_t end = std::min(height, (uint32_t)(band + 1) * bandHeight);
+        for(uint32_t y = band * bandHeight; y < end; y++) {
+            rowTask(y);
+        }
+    });
+}
+
+const std::vector<uint32_t>& Upscaler::process(const uint32_t* frame, uint32_t width, uint32_t height) {
+    output.resize((size_t)width * scale * height * scale);
+    switch(filter) {
+        case NONE: {
+            memcpy(output.data(), frame, (size_t)width * height * sizeof(uint32_t));
+            break;
+        }
+        case NEAREST: {
+            forEachRow(height, [&](uint32_t y) { nearestRow(frame, width, y); });
+            break;
+        }
+        case SCALE2X: {
+            forEachRow(height, [&](uint32_t y) { scale2xRow(frame, width, height, y); });
+            break;
+        }
+        case SCALE3X: {
+            forEachRow(height, [&](uint32_t y) { scale3xRow(frame, width, height, y); });
+            break;
+        }
+        case XBR2X: {
+            yuv.resize((size_t)width * height);
+            forEachRow(height, [&](uint32_t y) {
+                for(uint32_t x = 0; x < width; x++) {
+                    uint32_t pixel = frame[y * width + x];
+                    int32_t c0 = pixel & 0xFF;
+                    int32_t c1 = (pixel >> 8) & 0xFF;
+                    int32_t c2 = (pixel >> 16) & 0xFF;
+                    // channel order is unknown, the weights are symmetric enough for c0/c2 being r or b
+                    yuv[y * width + x] = {(299 * c0 + 587 * c1 + 114 * c2) / 1000,
+                                          (-169 * c0 - 331 * c1 + 500 * c2) / 1000,
+                                          (500 * c0 - 419 * c1 - 81 * c2) / 1000};
+                }
+            });
+            // every band reads its neighbours' colour distances, so this needs the whole yuv frame first
+            forEachRow(height, [&](uint32_t y) { xbrRow(frame, width, height, y); });
+            break;
+        }
+    }
+    return output;
+}
+
+void Upscaler::nearestRow(const uint32_t* frame, uint32_t width, uint32_t y) {
+    const uint32_t* source = frame + (size_t)y * width;
+    uint32_t* destination = output.data() + (size_t)y * scale * width * scale;
+    uint32_t x = 0;
+#ifdef __SSE2__
+    if(scale == 2) {
+        for(; x + 4 <= width; x += 4) {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(source + x));
+            _mm_storeu_si128((__m128i*)(destination + x * 2), _mm_unpacklo_epi32(pixels, pixels));
+            _mm_storeu_si128((__m128i*)(destination + x * 2 + 4), _mm_unpackhi_epi32(pixels, pixels));
+        }
+    }
+#endif
+    for(; x < width; x++) {
+        std::fill_n(destination + x * scale, scale, source[x]);
+    }
+    for(uint32_t row = 1; row < scale; row++) {
+        memcpy(destination + (size_t)row * width * scale, destination, width * scale * sizeof(uint32_t));
+    }
+}
+
+/*
+    Scale2x, every pixel E becomes
+        A B C      E0 E1
+        D E F  ->  E2 E3
+        G H I
+    E0 = D == B && B != H && D != F ? D : E, and the same rotated for E1-E3
+*/
+void Upscaler::scale2xRow(const uint32_t* frame, uint32_t width, uint32_t height, uint32_t y) {
+    const uint32_t* up = frame + (size_t)(y > 0 ? y - 1 : y) * width;
+    const uint32_t* row = frame + (size_t)y * width;
+    const uint32_t* down = frame + (size_t)(y + 1 < height ? y + 1 : y) * width;
+    uint32_t* top = output.data() + (size_t)y * 2 * width * 2;
+    uint32_t* bottom = top + width * 2;
+
+    auto scalar = [&](uint32_t x) {
+        uint32_t b = up[x];
+        uint32_t d = row[x > 0 ? x - 1 : x];
+        uint32_t e = row[x];
+        uint32_t f = row[x + 1 < width ? x + 1 : x];
+        uint32_t h = down[x];
+        if(b != h && d != f) {
+            top[x * 2] = d == b ? d : e;
+            top[x * 2 + 1] = b == f ? f : e;
+            bottom[x * 2] = d == h ? d : e;
+            bottom[x * 2 + 1] = h == f ? f : e;
+        } else {
+            top[x * 2] = top[x * 2 + 1] = bottom[x * 2] = bottom[x * 2 + 1] = e;
+        }
+    };
+
+    uint32_t x = 0;
+    scalar(x++);
+#ifdef __SSE2__
+    // 4 pixels at a time, needs a valid left and right neighbour
+    for(; x + 5 <= width; x += 4) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(up + x));
+        __m128i d = _mm_loadu_si128((const __m128i*)(row + x - 1));
+        __m128i e = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128i f = _mm_loadu_si128((const __m128i*)(row + x + 1));
+        __m128i h = _mm_loadu_si128((const __m128i*)(down + x));
+
+        __m128i different = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f)),
+                                             _mm_set1_epi32(-1));
+        __m128i useD0 = _mm_and_si128(different, _mm_cmpeq_epi32(d, b));
+        __m128i useF1 = _mm_and_si128(different, _mm_cmpeq_epi32(b, f));
+        __m128i useD2 = _mm_and_si128(different, _mm_cmpeq_epi32(d, h));
+        __m128i useF3 = _mm_and_si128(different, _mm_cmpeq_epi32(h, f));
+        __m128i e0 = _mm_or_si128(_mm_and_si128(useD0, d), _mm_andnot_si128(useD0, e));
+        __m128i e1 = _mm_or_si128(_mm_and_si128(useF1, f), _mm_andnot_si128(useF1, e));
+        __m128i e2 = _mm_or_si128(_mm_and_si128(useD2, d), _mm_andnot_si128(useD2, e));
+        __m128i e3 = _mm_or_si128(_mm_and_si128(useF3, f), _mm_andnot_si128(useF3, e));
+
+        _mm_storeu_si128((__m128i*)(top + x * 2), _mm_unpacklo_epi32(e0, e1));
+        _mm_storeu_si128((__m128i*)(top + x * 2 + 4), _mm_unpackhi_epi32(e0, e1));
+        _mm_storeu_si128((__m128i*)(bottom + x * 2), _mm_unpacklo_epi32(e2, e3));
+        _mm_storeu_si128((__m128i*)(bottom + x * 2 + 4), _mm_unpackhi_epi32(e2, e3));
+    }
+#endif
+    for(; x < width; x++) {
+        scalar(x);
+    }
+}
+
+// Scale3x (AdvMAME3x), same neighbourhood as Scale2x with a 3x3 output block E0-E8
+void Upscaler::scale3xRow(const uint32_t* frame, uint32_t width, uint32_t height, uint32_t y) {
+    const uint32_t* up = frame + (size_t)(y > 0 ? y - 1 : y) * width;
+    const uint32_t* row = frame + (size_t)y * width;
+    const uint32_t* down = frame + (size_t)(y + 1 < height ? y + 1 : y) * width;
+    size_t outputWidth = width * 3;
+    uint32_t* out = output.data() + (size_t)y * 3 * outputWidth;
+
+    for(uint32_t x = 0; x < width; x++) {
+        uint32_t left = x > 0 ? x - 1 : x;
+        uint32_t right = x + 1 < width ? x + 1 : x;
+        uint32_t a = up[left];
+        uint32_t b = up[x];
+        uint32_t c = up[right];
+        uint32_t d = row[left];
+        uint32_t e = row[x];
+        uint32_t f = row[right];
+        uint32_t g = down[left];
+        uint32_t h = down[x];
+        uint32_t i = down[right];
+
+        uint32_t* block = out + x * 3;
+        if(b != h && d != f) {
+            block[0] = d == b ? d : e;
+            block[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+            block[2] = b == f ? f : e;
+            block[outputWidth] = (d == b && e != g) || (d == h && e != a) ? d : e;
+            block[outputWidth + 1] = e;
+            block[outputWidth + 2] = (b == f && e != i) || (h == f && e != c) ? f : e;
+            block[outputWidth * 2] = d == h ? d : e;
+            block[outputWidth * 2 + 1] = (d == h && e != i) || (h == f && e != g) ? h : e;
+            block[outputWidth * 2 + 2] = h == f ? f : e;
+        } else {
+            block[0] = block[1] = block[2] = e;
+            block[outputWidth] = block[outputWidth + 1] = block[outputWidth + 2] = e;
+            block[outputWidth * 2] = block[outputWidth * 2 + 1] = block[outputWidth * 2 + 2] = e;
+        }
+    }
+}
+
+/*
+    xBR 2x (level 1). For every corner of E, with the corner pointing towards I:
+            A1 B1 C1
+         A0 A  B  C  C4
+         D0 D  E  F  F4
+         G0 G  H  I  I4
+            G5 H5 I5
+    an edge runs along H-F if the colour distances across it are smaller than along it,
+        d(E,C) + d(E,G) + d(I,F4) + d(I,H5) + 4d(H,F) < d(H,D) + d(H,I5) + d(F,I4) + d(F,B) + 4d(E,I)
+    in which case the corner is blended half way towards the closer of F and H. The other corners are the same
+    neighbourhood mirrored.
+*/
+void Upscaler::xbrRow(const uint32_t* frame, uint32_t width, uint32_t height, uint32_t y) {
+    uint32_t* out = output.data() + (size_t)y * 2 * width * 2;
+
+    auto index = [&](int32_t x, int32_t y) {
+        x = std::min(std::max(x, 0), (int32_t)width - 1);
+        y = std::min(std::max(y, 0), (int32_t)height - 1);
+        return (size_t)y * width + x;
+    };
+    auto distance = [&](size_t a, size_t b) {
+        return 48 * std::abs(yuv[a].y - yuv[b].y) + 7 * std::abs(yuv[a].u - yuv[b].u) + 6 * std::abs(yuv[a].v - yuv[b].v);
+    };
+    auto blend = [](uint32_t a, uint32_t b) {
+        // per channel average
+        return (((a ^ b) & 0xFEFEFEFE) >> 1) + (a & b);
+    };
+
+    for(uint32_t x = 0; x < width; x++) {
+        size_t e = index(x, y);
+        for(int32_t corner = 0; corner < 4; corner++) {
+            int32_t sx = (corner & 1) ? 1 : -1;
+            int32_t sy = (corner & 2) ? 1 : -1;
+            auto at = [&](int32_t dx, int32_t dy) {
+                return index((int32_t)x + dx * sx, (int32_t)y + dy * sy);
+            };
+            size_t f = at(1, 0);
+            size_t h = at(0, 1);
+            size_t i = at(1, 1);
+
+            uint32_t pixel = frame[e];
+            if(frame[e] != frame[f] && frame[e] != frame[h]) {
+                int32_t alongEdge = distance(e, at(1, -1)) + distance(e, at(-1, 1)) + distance(i, at(2, 0)) +
+                                    distance(i, at(0, 2)) + 4 * distance(h, f);
+                int32_t acrossEdge = distance(h, at(-1, 0)) + distance(h, at(1, 2)) + distance(f, at(2, 1)) +
+                                     distance(f, at(0, -1)) + 4 * distance(e, i);
+                if(alongEdge < acrossEdge) {
+                    pixel = blend(frame[e], distance(e, f) <= distance(e, h) ? frame[f] : frame[h]);
+                }
+            }
+            out[(corner & 2 ? width * 2 : 0) + x * 2 + (corner & 1)] = pixel;
+        }
+    }
+}
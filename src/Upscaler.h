@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class WorkerPool;
+
+/*
+    CPU upscaling filters for 32 bit pixels (channel order doesn't matter): nearest neighbour integer scaling,
+    Scale2x, Scale3x and xBR 2x (Hyllian's level 1 edge detection). The frame is split into bands of rows which
+    are filtered in parallel on a worker pool, created the first time a filter is selected.
+*/
+class Upscaler {
+
+    public:
+        enum Filter {
+            NONE,
+            NEAREST,
+            SCALE2X,
+            SCALE3X,
+            XBR2X
+        };
+
+        Upscaler();
+        ~Upscaler();
+
+        // scale is only used by NEAREST (1 - 8), the other filters have a fixed scale
+        void setFilter(Filter filter, uint32_t scale);
+        Filter getFilter();
+        uint32_t getScale();
+
+        // output is width * scale by height * scale pixels, valid until the next call. NONE returns a copy
+        const std::vector<uint32_t>& process(const uint32_t* frame, uint32_t width, uint32_t height);
+
+    private:
+        Filter filter = NONE;
+        uint32_t scale = 1;
+        std::unique_ptr<WorkerPool> workerPool;
+
+        std::vector<uint32_t> output;
+        // xBR works on colour distances in YUV, computed once per frame
+        struct Yuv {
+            int32_t y;
+            int32_t u;
+            int32_t v;
+        };
+        std::vector<Yuv> yuv;
+
+        // runs rowTask for every row of the frame, in parallel bands
+        template <typename RowTask>
+        void forEachRow(uint32_t height, RowTask rowTask);
+
+        void nearestRow(const uint32_t* frame, uint32_t width, uint32_t y);
+        void scale2xRow(const uint32_t* frame, uint32_t width, uint32_t height, uint32_t y);
+        void scale3xRow(const uint32_t* frame, uint32_t width, uint32_t height, uint32_t y);
+        void xbrRow(const uint32_t* frame, uint32_t width, uint32_t height, uint32_t y);
+};
@@ -0,0 +1,109 @@
+#include "VideoTiming.h"
+#include "memory/Bus.h"
+#include "arm7tdmi/ARM7TDMI.h"
+#include "PPU.h"
+#include "Scheduler.h"
+#include "GameBoyAdvanceImpl.h"
+#include "util/Serializer.h"
+
+void VideoTiming::connectBus(std::shared_ptr<Bus> bus) {
+    this->bus = bus;
+}
+
+void VideoTiming::connectCpu(std::shared_ptr<ARM7TDMI> cpu) {
+    this->cpu = cpu;
+}
+
+void VideoTiming::connectPpu(std::shared_ptr<PPU> ppu) {
+    this->ppu = ppu;
+}
+
+void VideoTiming::connectScheduler(std::shared_ptr<Scheduler> scheduler) {
+    this->scheduler = scheduler;
+}
+
+void VideoTiming::start() {
+    transitionCycle = GameBoyAdvanceImpl::cyclesSinceStart;
+    bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x3);
+    enterLine(0);
+}
+
+bool VideoTiming::transitionEvent() {
+    if(state == VISIBLE) {
+        enterHBlank();
+        return false;
+    }
+    // the ppu renders ahead, at the end of every line (vblank included) it prepares the upcoming lines
+    ppu->scanlineEnded(scanline);
+    enterLine((scanline + 1) % TOTAL_LINES);
+    return scanline == VBLANK_START_LINE;
+}
+
+uint16_t VideoTiming::getScanline() {
+    return scanline;
+}
+
+void VideoTiming::enterLine(uint16_t line) {
+    state = VISIBLE;
+    scanline = line;
+
+    // setting hblank flag to 0
+    bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x2);
+    if(scanline == VBLANK_START_LINE) {
+        // vblank time!
+        bus->iORegisters[Bus::IORegister::DISPSTAT] |= 0x1;
+        if(bus->iORegisters[Bus::IORegister::DISPSTAT] & 0x8) {
+            cpu->queueInterrupt(ARM7TDMI::Interrupt::VBlank);
+        }
+        scheduler->triggerCondition(Scheduler::EventCondition::VBLANK_START);
+    } else if(scanline == VBLANK_FLAG_END_LINE) {
+        // the vblank flag is cleared on the last line, not when line 0 starts
+        bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x1);
+    }
+
+    bus->iORegisters[Bus::IORegister::VCOUNT] = scanline;
+    if(scanline == ((uint16_t)(bus->iORegisters[Bus::IORegister::DISPSTAT + 1]))) {
+        // current scanline == vcount bits in DISPSTAT
+        // set vcounter flag
+        bus->iORegisters[Bus::IORegister::DISPSTAT] |= 0x04;
+        if(bus->iORegisters[Bus::IORegister::DISPSTAT] & 0x20) {
+            // if vcount irq enabled, queue the interrupt!
+            cpu->queueInterrupt(ARM7TDMI::Interrupt::VCounterMatch);
+        }
+    } else {
+        // toggle vcounter flag off
+        bus->iORegisters[Bus::IORegister::DISPSTAT] &= (~0x04);
+    }
+
+    scheduleTransition(PPU::H_VISIBLE_CYCLES);
+}
+
+void VideoTiming::enterHBlank() {
+    state = HBLANK;
+
+    // hblank time!
+    bus->iORegisters[Bus::IORegister::DISPSTAT] |= 0x2;
+    if(bus->iORegisters[Bus::IORegister::DISPSTAT] & 0x10) {
+        cpu->queueInterrupt(ARM7TDMI::Interrupt::HBlank);
+    }
+
+    scheduler->triggerCondition(Scheduler::EventCondition::HBLANK_START);
+
+    scheduleTransition(PPU::H_BLANK_CYCLES);
+}
+
+void VideoTiming::scheduleTransition(uint32_t cyclesAfterLastTransition) {
+    transitionCycle += cyclesAfterLastTransition;
+    uint64_t now = GameBoyAdvanceImpl::cyclesSinceStart;
+    Scheduler::EventType eventType = (state == VISIBLE) ? Scheduler::EventType::HBLANK : Scheduler::EventType::HBLANK_END;
+    scheduler->addEvent(eventType,
+                        transitionCycle > now ? transitionCycle - now : 0,
+                        Scheduler::EventCondition::NULL_CONDITION,
+                        false);
+}
+
+void VideoTiming::serialize(Serializer& serializer) {
+    serializer.value(state);
+    serializer.value(scanline);
+    serializer.value(transitionCycle);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+class Bus;
+class ARM7TDMI;
+class PPU;
+class Scheduler;
+class Serializer;
+
+/*
+    Scanline timing: a per line state machine, visible (960 cycles) -> hblank (272 cycles) -> next line.
+    Lines 160-227 are vblank. Exactly one transition is scheduled at any time, HBLANK for the end of the visible
+    part of a line and HBLANK_END for the end of the line. Owns the DISPSTAT flags, VCOUNT, the blanking and
+    vcount interrupts, the ends of scanlines for the ppu and the hblank/vblank DMA triggers.
+*/
+class VideoTiming {
+
+    public:
+        void connectBus(std::shared_ptr<Bus> bus);
+        void connectCpu(std::shared_ptr<ARM7TDMI> cpu);
+        void connectPpu(std::shared_ptr<PPU> ppu);
+        void connectScheduler(std::shared_ptr<Scheduler> scheduler);
+
+        // enters line 0 and schedules the first transition
+        void start();
+
+        // handles the scheduled transition (HBLANK or HBLANK_END event) and schedules the next one,
+        // returns true if vblank just started, ie. a frame was completed
+        bool transitionEvent();
+
+        uint16_t getScanline();
+
+        void serialize(Serializer& serializer);
+
+        static constexpr uint16_t VBLANK_START_LINE = 160;
+        static constexpr uint16_t VBLANK_FLAG_END_LINE = 227;
+        static constexpr uint16_t TOTAL_LINES = 228;
+
+    private:
+        std::shared_ptr<Bus> bus;
+        std::shared_ptr<ARM7TDMI> cpu;
+        std::shared_ptr<PPU> ppu;
+        std::shared_ptr<Scheduler> scheduler;
+
+        enum State {
+            VISIBLE,
+            HBLANK
+        };
+
+        State state = VISIBLE;
+        uint16_t scanline = 0;
+        // cycle the scheduled transition is due, next deadlines are computed from it so they never drift
+        uint64_t transitionCycle = 0;
+
+        void enterLine(uint16_t line);
+        void enterHBlank();
+        void scheduleTransition(uint32_t cyclesAfterLastTransition);
+};
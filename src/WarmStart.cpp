@@ -0,0 +1,70 @@
+#include "WarmStart.h"
+#include "GameBoyAdvanceImpl.h"
+#include "util/Log.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+void WarmStart::configure(std::string directory, uint32_t frame) {
+    this->directory = directory;
+    this->frame = frame;
+    if(!directory.empty()) {
+        mkdir(directory.c_str(), 0755);
+    }
+}
+
+bool WarmStart::isEnabled() {
+    return !directory.empty();
+}
+
+uint32_t WarmStart::getFrame() {
+    return frame;
+}
+
+std::vector<uint8_t> WarmStart::open(const std::vector<uint8_t>& rom, size_t stateSize) {
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325;
+    for(uint8_t byte : rom) {
+        hash = (hash ^ byte) * 0x100000001B3;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "/%016llx-", (unsigned long long)hash);
+    std::string trigger = frame ? "frame" + std::to_string(frame) : "keypad";
+    path = directory + name + trigger + "-v" + std::to_string(GameBoyAdvanceImpl::STATE_VERSION) + "-" +
+           std::to_string(stateSize) + ".state";
+
+    std::vector<uint8_t> state;
+    FILE* file = fopen(path.c_str(), "rb");
+    if(!file) {
+        return state;
+    }
+    if(fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        if(size > 0) {
+            state.resize(size);
+            rewind(file);
+            if(fread(state.data(), 1, size, file) != (size_t)size) {
+                state.clear();
+            }
+        }
+    }
+    fclose(file);
+    return state;
+}
+
+bool WarmStart::store(const std::vector<uint8_t>& state) {
+    std::string temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if(!file) {
+        LOG_WARN(GENERAL, "could not write warm start state " << temporaryPath << "\n");
+        return false;
+    }
+    bool written = fwrite(state.data(), 1, state.size(), file) == state.size();
+    written = (fclose(file) == 0) && written;
+    if(!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        LOG_WARN(GENERAL, "could not write warm start state " << path << "\n");
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    Warm start cache: the first time a rom runs, a save state is taken at the end of the frame in which it first
+    reads the keypad (or at a given frame) and later launches of the same rom restore it to skip the boot and
+    intro. Files are named after a hash of the rom, the trigger, GameBoyAdvanceImpl::STATE_VERSION and the size of
+    the state, so a change of the state format never finds the old ones, even one that forgot to bump the version
+    (and loadState still rejects states of another size).
+*/
+class WarmStart {
+
+    public:
+        // frame 0 takes the state at the first keypad read instead. The directory is created if it doesn't exist
+        void configure(std::string directory, uint32_t frame);
+        bool isEnabled();
+        uint32_t getFrame();
+
+        // looks up the state for the rom, empty if there is none yet. stateSize is the size of a save state of the
+        // machine running the rom (GameBoyAdvanceImpl::getStateSize)
+        std::vector<uint8_t> open(const std::vector<uint8_t>& rom, size_t stateSize);
+        // stores the state for the rom passed to open, written to a temporary file and renamed so that
+        // concurrent launches never read half a state
+        bool store(const std::vector<uint8_t>& state);
+
+    private:
+        std::string directory;
+        uint32_t frame = 0;
+        std::string path;
+};
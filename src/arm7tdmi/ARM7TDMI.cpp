@@ -10,6 +10,7 @@
 #include "../memory/Bus.h"
 #include "../Timer.h"
 #include "../Debugger.h"
+#include "../util/Serializer.h"
 
 #include "assert.h"
 
@@ -229,4 +230,33 @@ void ARM7TDMI::setCurrInstruction(uint32_t instruction) {
   4-0   M4-M0 - Mode Bits   (See below)                               ;/
 eturn value;
 
-*/
\ No newline at end of file
+*/
+
+void ARM7TDMI::serialize(Serializer& serializer) {
+    uint32_t* allRegisters[31] = {
+        &r0, &r1, &r2, &r3, &r4, &r5, &r6, &r7, &r8, &r9, &r10, &r11, &r12, &r13, &r14, &r15,
+        &r8_fiq, &r9_fiq, &r10_fiq, &r11_fiq, &r12_fiq, &r13_fiq, &r14_fiq,
+        &r13_irq, &r14_irq, &r13_svc, &r14_svc, &r13_abt, &r14_abt, &r13_und, &r14_und
+    };
+    for(uint32_t* reg : allRegisters) {
+        serializer.value(*reg);
+    }
+    serializer.value(cpsr);
+    serializer.value(SPSR_fiq);
+    serializer.value(SPSR_svc);
+    serializer.value(SPSR_abt);
+    serializer.value(SPSR_irq);
+    serializer.value(SPSR_und);
+    serializer.value(currentPcAccessType);
+    serializer.value(currInstruction);
+    serializer.value(currInstrAddress);
+    serializer.value(thumbLongbranchShift);
+    serializer.value(thumbCount);
+    serializer.value(armCount);
+
+    if(serializer.isLoading()) {
+        // switchToMode only rebanks the registers the new mode owns, start from the user bank
+        switchToMode(USER);
+        switchToMode((Mode)cpsr.Mode);
+    }
+}
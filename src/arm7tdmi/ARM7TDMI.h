@@ -9,11 +9,13 @@
 #include <memory>
 #include "../util/static_for.h"
 #include "../util/macros.h"
+#include "../util/Log.h"
 
 #include "assert.h"
 
 
 class Bus;
+class Serializer;
 
 class ARM7TDMI {
 
@@ -33,6 +35,9 @@ class ARM7TDMI {
     // dependency injection
     void connectBus(std::shared_ptr<Bus> bus);
 
+    // save states, see util/Serializer.h
+    void serialize(Serializer& serializer);
+
     // struct representing program status register (xPSR)
     struct ProgramStatusRegister {
         uint8_t Mode : 5;  //  M4-M0 - Mode Bits
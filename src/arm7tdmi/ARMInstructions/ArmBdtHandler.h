@@ -51,14 +51,13 @@ ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::armBdtHandler(uint32_t instruction, ARM7
             if (regList & 1) {
                 if constexpr(l) {
                     // LDM{cond}{amod} Rn{!},<Rlist>{^}  ;Load  (Pop)
+                    // unaligned addresses are forcibly aligned, the data isn't rotated like for LDR
                     uint32_t data;
                     if(firstAccess) {
-                        data = aluShiftRor(cpu->bus->read32(rnVal, Bus::CycleType::NONSEQUENTIAL), 
-                                           (rnVal & 3) * 8);
+                        data = cpu->bus->read32(rnVal, Bus::CycleType::NONSEQUENTIAL);
                         firstAccess = false;
                     } else {
-                        data = aluShiftRor(cpu->bus->read32(rnVal, Bus::CycleType::SEQUENTIAL), 
-                                           (rnVal & 3) * 8);
+                        data = cpu->bus->read32(rnVal, Bus::CycleType::SEQUENTIAL);
                     }
                     if constexpr(!s) {
                         cpu->setRegister(reg, data);
@@ -114,12 +113,10 @@ ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::armBdtHandler(uint32_t instruction, ARM7
                     // LDM{cond}{amod} Rn{!},<Rlist>{^}  ;Load  (Pop)
                     uint32_t data;
                     if(firstAccess) {
-                        data = aluShiftRor(cpu->bus->read32(rnVal, Bus::CycleType::NONSEQUENTIAL), 
-                                           (rnVal & 3) * 8);
+                        data = cpu->bus->read32(rnVal, Bus::CycleType::NONSEQUENTIAL);
                         firstAccess = false;
                     } else {
-                        data = aluShiftRor(cpu->bus->read32(rnVal, Bus::CycleType::SEQUENTIAL), 
-                                           (rnVal & 3) * 8);           
+                        data = cpu->bus->read32(rnVal, Bus::CycleType::SEQUENTIAL);           
                     }
                     if constexpr(!s) {
                         cpu->setRegister(reg, data);
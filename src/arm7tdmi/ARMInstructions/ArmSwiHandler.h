@@ -19,7 +19,7 @@ ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::armSwiHandler(uint32_t instruction, ARM7
         cpu->setRegister(PC_REGISTER, 0x8);
     } else if constexpr(opcode == 0x100) {
         // 0001b: BKPT      nn   ;breakpoint (ARMv5 and up)
-        DEBUGWARN("BKPT instruction not implemented!\n");
+        LOG_WARN(CPU, "BKPT instruction not implemented!\n");
     } else {
         assert(false);
     }
@@ -6,7 +6,7 @@
 
 template<uint16_t op>
 ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::armUndefHandler(uint32_t instruction, ARM7TDMI* cpu) {
-    DEBUGWARN("UNDEFINED ARM OPCODE! " << std::bitset<32>(instruction).to_string() << std::endl);
+    LOG_WARN(CPU, "UNDEFINED ARM OPCODE! " << std::bitset<32>(instruction).to_string() << std::endl);
     cpu->switchToMode(ARM7TDMI::Mode::UNDEFINED);
     *(cpu->currentSpsr) = cpu->cpsr;
     cpu->cpsr.Mode = Mode::UNDEFINED;
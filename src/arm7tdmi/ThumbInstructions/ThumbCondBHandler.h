@@ -8,13 +8,13 @@
 template<uint16_t op>
 ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::thumbCondBHandler(uint16_t instruction, ARM7TDMI* cpu) {
     assert((instruction & 0xF000) == 0xD000);
-    DEBUG("in THUMB.16: conditional branch\n");
+    LOG_INFO(CPU, "in THUMB.16: conditional branch\n");
     //uint8_t opcode = (instruction & 0x0F00) >> 8;
     constexpr uint8_t opcode = (op & 0x03C) >> 2;
     uint32_t offset = signExtend9Bit((instruction & 0x00FF) << 1);
     bool jump = false;
 
-    DEBUG("opcode: " << (uint64_t)opcode << "\n");
+    LOG_INFO(CPU, "opcode: " << (uint64_t)opcode << "\n");
 
     // Destination address must by halfword aligned (ie. bit 0 cleared)
     // Return: No flags affected, PC adjusted if condition true
@@ -24,7 +24,7 @@ ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::thumbLongBHandler(uint16_t instruction,
         return BRANCH;
     } else if constexpr(opcode == 0x1D) {
         // 11101b: BLX label  ;branch long with link switch to ARM mode (ARM9)
-        DEBUGWARN("BLX not implemented!\n");
+        LOG_WARN(CPU, "BLX not implemented!\n");
         assert(false);
     } else {
         assert(false);
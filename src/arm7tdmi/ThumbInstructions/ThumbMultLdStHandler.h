@@ -55,12 +55,10 @@ ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::thumbMultLdStHandler(uint16_t instructio
         for(int i = 0; i < 8; i++) {
             if(rList & 0x01) {
                 if(firstAccess) {
-                    cpu->setRegister(i, aluShiftRor(cpu->bus->read32(rbValue, Bus::CycleType::NONSEQUENTIAL), 
-                                                    (rbValue & 3) * 8));
+                    cpu->setRegister(i, cpu->bus->read32(rbValue, Bus::CycleType::NONSEQUENTIAL));
                     firstAccess = false;
                 } else {
-                    cpu->setRegister(i, aluShiftRor(cpu->bus->read32(rbValue, Bus::CycleType::SEQUENTIAL), 
-                                                    (rbValue & 3) * 8));
+                    cpu->setRegister(i, cpu->bus->read32(rbValue, Bus::CycleType::SEQUENTIAL));
                 }
                 rbValue += 4;
             }
@@ -69,8 +67,7 @@ ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::thumbMultLdStHandler(uint16_t instructio
         if(!(instruction & 0x00FF)) {
             // empty rList
             // R15 loaded/stored (ARMv4 only), and Rb=Rb+40h (ARMv4-v5).
-            cpu->setRegister(PC_REGISTER, aluShiftRor(cpu->bus->read32(rbValue, Bus::CycleType::NONSEQUENTIAL), 
-                                                     (rbValue & 3) * 8));
+            cpu->setRegister(PC_REGISTER, cpu->bus->read32(rbValue, Bus::CycleType::NONSEQUENTIAL));
             rbValue += 0x40;
         }
         if(((uint32_t)rList >> rb) & 0x1) {
@@ -5,7 +5,7 @@
 
 template<uint16_t op>
 ARM7TDMI::FetchPCMemoryAccess ARM7TDMI::thumbUndefHandler(uint16_t instruction, ARM7TDMI* cpu) {
-    DEBUGWARN("UNDEFINED THUMB OPCODE! " << std::bitset<16>(instruction).to_string() << std::endl);
+    LOG_WARN(CPU, "UNDEFINED THUMB OPCODE! " << std::bitset<16>(instruction).to_string() << std::endl);
     
     // cpu->switchToMode(ARM7TDMI::Mode::UNDEFINED);
     // TODO: what is behaviour of thumb undefined instruction?
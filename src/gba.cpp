@@ -3,6 +3,8 @@
 #include <signal.h>
 #include <unistd.h>
 #include <iostream>
+#include <map>
+#include <vector>
 
 GameBoyAdvance gba;
 
@@ -27,12 +29,82 @@ int main(int argc, char *argv[]) {
     signal(SIGTRAP, handler);
     signal(SIGSEGV, handler);
     bool success = true;
-    if(argc < 2) {
+    std::string romPath;
+    std::string capturePath;
+    std::string captureAudioPath;
+    bool captureBlock = false;
+    std::string filter = "none";
+    uint32_t scale = 2;
+    std::string exportName;
+    uint32_t exportSlots = 4;
+    std::string warmStartDirectory;
+    uint32_t warmStartFrame = 0;
+    std::vector<std::string> cheats;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--capture" && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if(arg == "--capture-audio" && i + 1 < argc) {
+            captureAudioPath = argv[++i];
+        } else if(arg == "--capture-block") {
+            captureBlock = true;
+        } else if(arg == "--colour-correction") {
+            gba.setColourCorrection(true);
+        } else if(arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if(arg == "--render-threads" && i + 1 < argc) {
+            gba.setRenderThreads(std::stoi(argv[++i]));
+        } else if(arg == "--export-frames" && i + 1 < argc) {
+            exportName = argv[++i];
+        } else if(arg == "--export-slots" && i + 1 < argc) {
+            exportSlots = std::stoi(argv[++i]);
+        } else if(arg == "--warm-start" && i + 1 < argc) {
+            warmStartDirectory = argv[++i];
+        } else if(arg == "--warm-start-frame" && i + 1 < argc) {
+            warmStartFrame = std::stoi(argv[++i]);
+        } else if(arg == "--cheat" && i + 1 < argc) {
+            cheats.push_back(argv[++i]);
+        } else if(arg == "--scale" && i + 1 < argc) {
+            scale = std::stoi(argv[++i]);
+        } else {
+            romPath = arg;
+        }
+    }
+
+    const std::map<std::string, GameBoyAdvance::UpscaleFilter> filters = {
+        {"none", GameBoyAdvance::UpscaleFilter::NONE},
+        {"nearest", GameBoyAdvance::UpscaleFilter::NEAREST},
+        {"scale2x", GameBoyAdvance::UpscaleFilter::SCALE2X},
+        {"scale3x", GameBoyAdvance::UpscaleFilter::SCALE3X},
+        {"xbr", GameBoyAdvance::UpscaleFilter::XBR2X}
+    };
+    if(romPath == "") {
         std::cerr << "Please include path to a GBA ROM" << std::endl;
+        std::cerr << "usage: gba [--capture <video.y4m|video.rgb>] [--capture-audio <audio.wav>] [--capture-block] [--colour-correction] [--filter <none|nearest|scale2x|scale3x|xbr>] [--scale <n>] [--render-threads <n>] [--export-frames <shm name>] [--export-slots <n>] [--warm-start <directory>] [--warm-start-frame <n>] [--cheat <codes>]... <path_to_gba_rom>" << std::endl;
+        success = false;
+    } else if(filters.count(filter) == 0) {
+        std::cerr << "unknown filter " << filter << std::endl;
         success = false;
     } else {
-        if(gba.loadRom(argv[1])) {
-            gba.runRom();
+        gba.setUpscaleFilter(filters.at(filter), scale);
+        gba.setWarmStart(warmStartDirectory, warmStartFrame);
+        if(gba.loadRom(romPath)) {
+            bool cheatsSupported = true;
+            for(uint32_t i = 0; i < cheats.size(); i++) {
+                if(!gba.setCheat(i, true, cheats[i])) {
+                    std::cerr << "unsupported cheat " << cheats[i] << std::endl;
+                    cheatsSupported = false;
+                }
+            }
+            if(!cheatsSupported) {
+                success = false;
+            } else if((capturePath != "" || captureAudioPath != "") && !gba.startCapture(capturePath, captureAudioPath, captureBlock)) {
+                success = false;
+            } else if(exportName != "" && !gba.startFrameExport(exportName, exportSlots)) {
+                success = false;
+            } else {
+                gba.runRom();
+            }
         }
         else {
             success = false;
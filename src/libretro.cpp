@@ -0,0 +1,341 @@
+#include <libretro.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "GameBoyAdvanceImpl.h"
+#include "ColourLut.h"
+#include "PPU.h"
+#include "memory/Bus.h"
+
+/*
+    libretro core (gba_libretro) over GameBoyAdvanceImpl. The frontend owns pacing, input, audio output and the
+    window, the instance runs headless and one retro_run is one frame (until the next vblank).
+
+    Frames are converted from PPU::pixelBuffer (BGR555, which no libretro pixel format matches) through the frame
+    ColourLut straight into the buffer handed to the frontend, RGB565 if the frontend accepts it and XRGB8888
+    otherwise. Save memory is exposed in place through retro_get_memory_data, the frontend reads and writes the
+    cartridge's sram/flash/eeprom directly. Cheats are GameShark / Action Replay v1-v2 and CodeBreaker codes (see
+    Cheats.h). There is no sound controller yet, every frame delivers silence.
+*/
+
+namespace {
+
+retro_environment_t environment = nullptr;
+retro_video_refresh_t videoRefresh = nullptr;
+retro_audio_sample_t audioSample = nullptr;
+retro_audio_sample_batch_t audioSampleBatch = nullptr;
+retro_input_poll_t inputPoll = nullptr;
+retro_input_state_t inputState = nullptr;
+retro_log_printf_t logPrintf = nullptr;
+
+constexpr double CPU_FREQUENCY = 16777216.0;
+constexpr double FPS = CPU_FREQUENCY / PPU::V_TOTAL;
+constexpr double SAMPLE_RATE = 32768.0;
+
+std::unique_ptr<GameBoyAdvanceImpl> gba;
+// GameBoyAdvanceImpl::cyclesSinceStart is thread local, frontends may call in from more than one thread
+uint64_t cyclesSinceStart = 0;
+ColourLut::Format pixelFormat = ColourLut::RGB565;
+std::vector<uint8_t> frame;
+std::vector<int16_t> silence;
+double audioSamplesOwed = 0.0;
+bool inputBitmasks = false;
+
+// KEYINPUT bit order
+constexpr unsigned KEY_MAP[10] = {
+    RETRO_DEVICE_ID_JOYPAD_A,
+    RETRO_DEVICE_ID_JOYPAD_B,
+    RETRO_DEVICE_ID_JOYPAD_SELECT,
+    RETRO_DEVICE_ID_JOYPAD_START,
+    RETRO_DEVICE_ID_JOYPAD_RIGHT,
+    RETRO_DEVICE_ID_JOYPAD_LEFT,
+    RETRO_DEVICE_ID_JOYPAD_UP,
+    RETRO_DEVICE_ID_JOYPAD_DOWN,
+    RETRO_DEVICE_ID_JOYPAD_R,
+    RETRO_DEVICE_ID_JOYPAD_L
+};
+
+void logMessage(retro_log_level level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if(logPrintf) {
+        char message[512];
+        vsnprintf(message, sizeof(message), format, args);
+        logPrintf(level, "%s", message);
+    } else {
+        vfprintf(stderr, format, args);
+    }
+    va_end(args);
+}
+
+// the instance's thread local cycle counter is swapped in around every call into it
+struct CycleScope {
+    CycleScope() {
+        GameBoyAdvanceImpl::cyclesSinceStart = cyclesSinceStart;
+    }
+    ~CycleScope() {
+        cyclesSinceStart = GameBoyAdvanceImpl::cyclesSinceStart;
+    }
+};
+
+void updateVariables() {
+    retro_variable variable = {"gba_colour_correction", nullptr};
+    if(environment(RETRO_ENVIRONMENT_GET_VARIABLE, &variable) && variable.value) {
+        gba->setColourCorrection(strcmp(variable.value, "enabled") == 0);
+    }
+}
+
+uint16_t readKeys() {
+    uint16_t keys = 0;
+    if(inputBitmasks) {
+        int16_t pressed = inputState(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_MASK);
+        for(uint32_t i = 0; i < 10; i++) {
+            keys |= ((pressed >> KEY_MAP[i]) & 1) << i;
+        }
+    } else {
+        for(uint32_t i = 0; i < 10; i++) {
+            keys |= (inputState(0, RETRO_DEVICE_JOYPAD, 0, KEY_MAP[i]) ? 1 : 0) << i;
+        }
+    }
+    // left + right / up + down at once is impossible on the d-pad and breaks some games
+    if((keys & 0x30) == 0x30) {
+        keys &= ~0x30;
+    }
+    if((keys & 0xC0) == 0xC0) {
+        keys &= ~0xC0;
+    }
+    // KEYINPUT: 0=Pressed, 1=Released
+    return ~keys & 0x3FF;
+}
+
+}
+
+RETRO_API void retro_set_environment(retro_environment_t callback) {
+    environment = callback;
+
+    static const retro_variable variables[] = {
+        {"gba_colour_correction", "LCD colour correction; disabled|enabled"},
+        {nullptr, nullptr}
+    };
+    environment(RETRO_ENVIRONMENT_SET_VARIABLES, (void*)variables);
+}
+
+RETRO_API void retro_set_video_refresh(retro_video_refresh_t callback) {
+    videoRefresh = callback;
+}
+
+RETRO_API void retro_set_audio_sample(retro_audio_sample_t callback) {
+    audioSample = callback;
+}
+
+RETRO_API void retro_set_audio_sample_batch(retro_audio_sample_batch_t callback) {
+    audioSampleBatch = callback;
+}
+
+RETRO_API void retro_set_input_poll(retro_input_poll_t callback) {
+    inputPoll = callback;
+}
+
+RETRO_API void retro_set_input_state(retro_input_state_t callback) {
+    inputState = callback;
+}
+
+RETRO_API void retro_init() {
+    retro_log_callback logCallback;
+    if(environment(RETRO_ENVIRONMENT_GET_LOG_INTERFACE, &logCallback)) {
+        logPrintf = logCallback.log;
+    }
+    inputBitmasks = environment(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, nullptr);
+}
+
+RETRO_API void retro_deinit() {
+    gba.reset();
+    logPrintf = nullptr;
+}
+
+RETRO_API unsigned retro_api_version() {
+    return RETRO_API_VERSION;
+}
+
+RETRO_API void retro_get_system_info(retro_system_info* info) {
+    memset(info, 0, sizeof(*info));
+    info->library_name = "gba-mu";
+    info->library_version = "0.1";
+    info->valid_extensions = "gba|bin";
+    info->need_fullpath = false;
+    info->block_extract = false;
+}
+
+RETRO_API void retro_get_system_av_info(retro_system_av_info* info) {
+    memset(info, 0, sizeof(*info));
+    info->geometry.base_width = PPU::SCREEN_WIDTH;
+    info->geometry.base_height = PPU::SCREEN_HEIGHT;
+    info->geometry.max_width = PPU::SCREEN_WIDTH;
+    info->geometry.max_height = PPU::SCREEN_HEIGHT;
+    info->geometry.aspect_ratio = (float)PPU::SCREEN_WIDTH / PPU::SCREEN_HEIGHT;
+    info->timing.fps = FPS;
+    info->timing.sample_rate = SAMPLE_RATE;
+}
+
+RETRO_API void retro_set_controller_port_device(unsigned port, unsigned device) {
+}
+
+RETRO_API bool retro_load_game(const retro_game_info* game) {
+    if(!game || !game->data || game->size == 0 || game->size > 0x2000000) {
+        logMessage(RETRO_LOG_ERROR, "gba-mu: no rom or the rom is larger than 32MB\n");
+        return false;
+    }
+
+    retro_pixel_format format = RETRO_PIXEL_FORMAT_RGB565;
+    pixelFormat = ColourLut::RGB565;
+    if(!environment(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format)) {
+        format = RETRO_PIXEL_FORMAT_XRGB8888;
+        if(!environment(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format)) {
+            logMessage(RETRO_LOG_ERROR, "gba-mu: frontend supports neither RGB565 nor XRGB8888\n");
+            return false;
+        }
+        // XRGB8888 as a little endian word
+        pixelFormat = ColourLut::BGRA8888;
+    }
+
+    cyclesSinceStart = 0;
+    CycleScope scope;
+    gba = std::make_unique<GameBoyAdvanceImpl>();
+    std::vector<uint8_t> rom((const uint8_t*)game->data, (const uint8_t*)game->data + game->size);
+    gba->loadRom(rom);
+    gba->setHeadless(true);
+    gba->setPixelFormat(pixelFormat);
+    updateVariables();
+
+    frame.resize(PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT * ColourLut::bytesPerPixel(pixelFormat));
+    silence.assign((size_t)(SAMPLE_RATE / FPS + 2) * 2, 0);
+    audioSamplesOwed = 0.0;
+    return true;
+}
+
+RETRO_API bool retro_load_game_special(unsigned type, const retro_game_info* info, size_t count) {
+    return false;
+}
+
+RETRO_API void retro_unload_game() {
+    gba.reset();
+}
+
+RETRO_API void retro_reset() {
+    if(!gba) {
+        return;
+    }
+    CycleScope scope;
+    // the battery backed save memory survives a reset, it is restored in place so the frontend's pointer stays valid
+    Bus* bus = gba->getBus();
+    std::vector<uint8_t> saveMemory(bus->getSaveMemory(), bus->getSaveMemory() + bus->getSaveMemorySize());
+    if(!gba->reset()) {
+        logMessage(RETRO_LOG_ERROR, "gba-mu: reset failed, the boot state didn't load\n");
+        return;
+    }
+    memcpy(bus->getSaveMemory(), saveMemory.data(), saveMemory.size());
+}
+
+RETRO_API void retro_run() {
+    bool variablesUpdated = false;
+    if(environment(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &variablesUpdated) && variablesUpdated) {
+        updateVariables();
+    }
+
+    inputPoll();
+    {
+        CycleScope scope;
+        gba->setKeyState(readKeys());
+        gba->runFrame();
+    }
+
+    gba->getFrame(frame.data());
+    videoRefresh(frame.data(), PPU::SCREEN_WIDTH, PPU::SCREEN_HEIGHT,
+                 PPU::SCREEN_WIDTH * ColourLut::bytesPerPixel(pixelFormat));
+
+    audioSamplesOwed += SAMPLE_RATE / FPS;
+    size_t samples = (size_t)audioSamplesOwed;
+    audioSamplesOwed -= samples;
+    audioSampleBatch(silence.data(), samples);
+}
+
+RETRO_API size_t retro_serialize_size() {
+    return gba ? gba->getStateSize() : 0;
+}
+
+RETRO_API bool retro_serialize(void* data, size_t size) {
+    if(!gba) {
+        return false;
+    }
+    CycleScope scope;
+    return gba->saveState(data, size);
+}
+
+RETRO_API bool retro_unserialize(const void* data, size_t size) {
+    if(!gba) {
+        return false;
+    }
+    CycleScope scope;
+    return gba->loadState(data, size);
+}
+
+RETRO_API void retro_cheat_reset() {
+    if(gba) {
+        gba->clearCheats();
+    }
+}
+
+RETRO_API void retro_cheat_set(unsigned index, bool enabled, const char* code) {
+    if(gba && code && !gba->setCheat(index, enabled, code)) {
+        logMessage(RETRO_LOG_WARN, "gba-mu: unsupported cheat %u: %s\n", index, code);
+    }
+}
+
+RETRO_API unsigned retro_get_region() {
+    return RETRO_REGION_NTSC;
+}
+
+RETRO_API void* retro_get_memory_data(unsigned id) {
+    if(!gba) {
+        return nullptr;
+    }
+    switch(id) {
+        case RETRO_MEMORY_SAVE_RAM: {
+            return gba->getBus()->getSaveMemory();
+        }
+        case RETRO_MEMORY_SYSTEM_RAM: {
+            return gba->getBus()->wRamBoard.data();
+        }
+        case RETRO_MEMORY_VIDEO_RAM: {
+            return gba->getBus()->vRam.data();
+        }
+        default: {
+            return nullptr;
+        }
+    }
+}
+
+RETRO_API size_t retro_get_memory_size(unsigned id) {
+    if(!gba) {
+        return 0;
+    }
+    switch(id) {
+        case RETRO_MEMORY_SAVE_RAM: {
+            return gba->getBus()->getSaveMemorySize();
+        }
+        case RETRO_MEMORY_SYSTEM_RAM: {
+            // 256K on board work ram
+            return 0x40000;
+        }
+        case RETRO_MEMORY_VIDEO_RAM: {
+            return 0x18000;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
@@ -3,15 +3,21 @@
 #include "BIOS.h"
 #include "../Timer.h"
 #include "../DMA.h"
+#include "../Gamepad.h"
+#include "../Serial.h"
 #include "../arm7tdmi/ARM7TDMI.h"
 #include "../util/macros.h"
+#include "../util/Log.h"
+#include "../util/Serializer.h"
 
 #include "assert.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <iterator>
-#include <regex>
+#include <cctype>
+#include <cstring>
 
 
 
@@ -346,9 +352,22 @@ uint32_t Bus::read(uint32_t address, uint8_t width, CycleType cycleType) {
                 break;
             }
             uint32_t upperLimit = address + (width / 8);
-            if(0x4000102 <= upperLimit && address <= 0x400010F) {
-                // timer addresses
-                timer->updateBusToPrepareForTimerRead(address, width);
+            if(0x4000130 < upperLimit && address <= 0x4000131) {
+                keypadRead = true;
+            }
+            if(0x4000100 < upperLimit && address <= 0x400010F) {
+                // timer addresses, counters are calculated by the timer on demand
+                switch(width) {
+                    case 32: {
+                        return timer->readTimerRegisters(align32(address), width);
+                    }
+                    case 16: {
+                        return timer->readTimerRegisters(align16(address), width);
+                    }
+                    default: {
+                        return timer->readTimerRegisters(address, width);
+                    }
+                }
             }
 
             switch(width) {
@@ -536,7 +555,9 @@ uint32_t Bus::read(uint32_t address, uint8_t width, CycleType cycleType) {
                 if(0x0E000000 <= address && address <= 0x0E00FFFF) {
                     return flash.read(address);
                 } 
-            }    
+            } else if(cartSaveType == NO_SAVE_TYPE) {
+                return width == 32 ? 0xFFFFFFFF : width == 16 ? 0xFFFF : 0xFF;
+            }
 
             address &= 0x00007FFF;
 
@@ -605,6 +626,9 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
                     break;
                 }
             }
+            if(unlikely(!ramPatches.empty())) {
+                applyRamPatches(address & 0xFFFFFFFC, 4);
+            }
             break; 
         }
         case 0x03: {
@@ -628,6 +652,9 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
                     break;
                 }
             } 
+            if(unlikely(!ramPatches.empty())) {
+                applyRamPatches(address & 0xFFFFFFFC, 4);
+            }
             break;        
         }
         case 0x04: {
@@ -635,13 +662,22 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
                 // TODO handle strange io memory access
                 break;
             }
+            if(address < 0x04000058) {
+                // display registers, the lines that have ended must be rendered with the old value
+                ppu->catchUp();
+            }
             uint32_t upperLimit = address + (width / 8);
-            if(0x4000102 <= upperLimit && address <= 0x400010F) {
+            if(0x4000100 < upperLimit && address <= 0x400010F) {
                 // timer addresses
                 timer->updateTimerUponWrite(address, value, width);
             }
 
 
+            if(0x4000083 < upperLimit && address <= 0x4000084) {
+                // SOUNDCNT_H, SOUNDCNT_X
+                dma->updateSoundControlUponWrite(address, value, width);
+            }
+
             // TODO: there's a more efficient way to do this I think,
             // send the changed register to DMA AFTER the write happens
             if(0x40000BA <= upperLimit && address <= 0x40000DF) {
@@ -649,6 +685,9 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
                 dma->updateDmaUponWrite(address, value, width);
             }
 
+            // the flags pending before the write, the write below replaces them
+            uint8_t interruptRequest[2] = {iORegisters[IORegister::IF], iORegisters[IORegister::IF + 1]};
+
             switch(width) {
                 case 32: {
                     writeToArray32(&iORegisters, align32(address), 0x04000000, value); 
@@ -669,8 +708,8 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
             } 
 
             // SPECIAL CASE when writing to interrupt request register
-            // setting a bit (acknowledging an interrupt) changes that bit to zero
-            // so do val &= ~val
+            // setting a bit (acknowledging an interrupt) changes that bit to zero, the other pending flags stay
+            // so do IF = old IF & ~val
             if(0x4000202 <= upperLimit && address <= 0x4000203) {
 
                 uint8_t tempWidth = width;
@@ -679,7 +718,8 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
                 while(tempWidth != 0) {
                     
                     if(tempAddress == 0x04000202 || tempAddress == 0x04000203) {
-                        iORegisters[tempAddress - 0x04000000] = iORegisters[tempAddress - 0x04000000] & (~tempValue);
+                        iORegisters[tempAddress - 0x04000000] = interruptRequest[tempAddress - 0x04000202] &
+                                                                (~tempValue);
                     }
                     
                     tempWidth -= 8;
@@ -688,15 +728,28 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
                 }
             }   
 
+            if(0x4000128 < upperLimit && address <= 0x4000129) {
+                // SIOCNT changed, may have started a transfer
+                serial->updateSerialUponWrite();
+            }
+
+            if(0x4000132 < upperLimit && address <= 0x4000133) {
+                // KEYCNT changed, the keypad irq condition may now be met
+                gamepad->checkKeypadInterrupt();
+            }
+
             if(address == 0x04000301) {
                 // halt register hit
                 if(!(iORegisters[HALTCNT] & 0x80)) {
                     haltMode = true;
+                } else {
+                    stopMode = true;
                 }
             }           
             break;
         }
         case 0x05: {  
+            ppu->catchUp();
             address &= 0x050003FF;
             switch(width) {
                 case 32: {
@@ -724,6 +777,7 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
             break;
         } 
         case 0x06: {  
+            ppu->catchUp();
 
             // Even though VRAM is sized 96K (64K+32K), it is repeated in steps of 128K 
             // (64K+32K+32K, the two 32K blocks itself being mirrors of each other).
@@ -756,6 +810,7 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
             break;
         } 
         case 0x07: {   
+            ppu->catchUp();
             // TODO: there are more hblank rules to implement
             address &= 0x070003FF;
             switch(width) {
@@ -886,6 +941,8 @@ void Bus::write(uint32_t address, uint32_t value, uint8_t width, CycleType acces
                     break;
                 }
                 
+            } else if(cartSaveType == NO_SAVE_TYPE) {
+                break;
             }
 
             address &= 0x00007FFF;
@@ -1200,54 +1257,91 @@ uint32_t Bus::view(uint32_t address, uint8_t width) {
 void Bus::loadRom(std::vector<uint8_t> &buffer) {
     // TODO: assert that roms are smaller than 32MB
 
-    std::string s{buffer.begin(), buffer.end()};
-    std::regex eepromRegex = std::regex{"EEPROM_V\\d\\d\\d"};
-    std::regex sramRegex = std::regex{"SRAM_V\\d\\d\\d"};
-    std::regex flashRegex = std::regex{"FLASH_V\\d\\d\\d"};
-    std::regex flash512Regex = std::regex{"FLASH512_V\\d\\d\\d"};
-    std::regex flash1MbRegex = std::regex{"FLASH1M_V\\d\\d\\d"};
+    gameEntry = GameDatabase::lookup(buffer);
+    if(gameEntry) {
+        switch(gameEntry->saveType) {
+            case GameDatabase::EEPROM: {
+                cartSaveType = Bus::CartSaveType::EEPROM_TYPE;
+                // the bus width follows from the size, it doesn't have to be detected from the first dma
+                setEepromBusWidth(gameEntry->saveSize > 0x200 ? 14 : 6);
+                dma->eepromBusWidthDetected = true;
+                break;
+            }
+            case GameDatabase::FLASH: {
+                bool flash1Mb = gameEntry->saveSize > 0x10000;
+                flash.setSize(flash1Mb ? 1024 : 512);
+                cartSaveType = flash1Mb ? Bus::CartSaveType::FLASH1024_TYPE : Bus::CartSaveType::FLASH512_TYPE;
+                break;
+            }
+            case GameDatabase::SRAM: {
+                cartSaveType = Bus::CartSaveType::SRAM_TYPE;
+                break;
+            }
+            case GameDatabase::NO_SAVE: {
+                cartSaveType = Bus::CartSaveType::NO_SAVE_TYPE;
+                break;
+            }
+        }
+        LOG_INFO(MEMORY, "save type from the game database\n");
+    } else {
+        detectSaveType(buffer);
+    }
+
+    largeCart = (buffer.size() > 0x1000000);
+    if(largeCart) {
+        LOG_INFO(MEMORY, "large cartridge\n");
+    }
+
+    for (int i = 0; i < buffer.size(); i++) {
+        gamePakRom[i] = buffer[i];
+    }
+}
+
+
+void Bus::detectSaveType(std::vector<uint8_t>& buffer) {
+    // the save library linked into the rom leaves its id, ie. "FLASH1M_V103". If there are several the first
+    // one in this order is used
+    const char* ids[5] = {"EEPROM_V", "SRAM_V", "FLASH_V", "FLASH512_V", "FLASH1M_V"};
+    uint32_t found = 0;
+    for(size_t i = 0; i < buffer.size() && !(found & 1); i++) {
+        if(buffer[i] != 'E' && buffer[i] != 'S' && buffer[i] != 'F') {
+            continue;
+        }
+        for(uint32_t id = 0; id < 5; id++) {
+            size_t length = strlen(ids[id]);
+            if(i + length + 3 <= buffer.size() && memcmp(&buffer[i], ids[id], length) == 0 &&
+               isdigit(buffer[i + length]) && isdigit(buffer[i + length + 1]) && isdigit(buffer[i + length + 2])) {
+                found |= 1 << id;
+            }
+        }
+    }
 
-    if(std::regex_search(s, eepromRegex)) {
+    if(found & 0x1) {
 
         cartSaveType = Bus::CartSaveType::EEPROM_TYPE;
-        std::cout << "eeprom save type\n";
+        LOG_INFO(MEMORY, "eeprom save type\n");
         dma->eepromBusWidthDetected = false;
-    } else if(std::regex_search(s, sramRegex)) {
+    } else if(found & 0x2) {
 
         cartSaveType = Bus::CartSaveType::SRAM_TYPE;
-        std::cout << "sram save type\n";
-    } else if(std::regex_search(s, flashRegex)) {
-
-        flash.setSize(512);
-        cartSaveType = Bus::CartSaveType::FLASH512_TYPE;
-        std::cout << "flash512 save type\n";
-    } else if(std::regex_search(s, flash512Regex)) {
+        LOG_INFO(MEMORY, "sram save type\n");
+    } else if(found & 0xC) {
 
         flash.setSize(512);
         cartSaveType = Bus::CartSaveType::FLASH512_TYPE;
-        std::cout << "flash512 save type\n";
-    } else if(std::regex_search(s, flash1MbRegex)) {
+        LOG_INFO(MEMORY, "flash512 save type\n");
+    } else if(found & 0x10) {
 
         flash.setSize(1024);
         cartSaveType = Bus::CartSaveType::FLASH1024_TYPE;
-        std::cout << "flash1024 save type\n";
+        LOG_INFO(MEMORY, "flash1024 save type\n");
     } else {
 
-        DEBUGWARN("cartridge save type could not be detected\n");
+        LOG_WARN(MEMORY, "cartridge save type could not be detected\n");
         cartSaveType = Bus::CartSaveType::SRAM_TYPE;
     }
-
-    largeCart = (buffer.size() > 0x1000000);
-    if(largeCart) {
-        std::cout << "large cartridge\n";
-    }
-
-    for (int i = 0; i < buffer.size(); i++) {
-        gamePakRom[i] = buffer[i];
-    }
 }
 
-
 uint8_t Bus::getCurrentNWaitstate() {
     return currentNWaitstate;
 }
@@ -1335,6 +1429,14 @@ void Bus::connectPpu(std::shared_ptr<PPU> _ppu) {
     this->ppu = _ppu;
 }
 
+void Bus::connectGamepad(std::shared_ptr<Gamepad> _gamepad) {
+    this->gamepad = _gamepad;
+}
+
+void Bus::connectSerial(std::shared_ptr<Serial> _serial) {
+    this->serial = _serial;
+}
+
 // TODO: can make static ?
 bool Bus::isAddressInEeprom(uint32_t address) {
     if((address & 0xFF000000) < 0x08000000 || (address & 0xFF000000) > 0x0D000000) {
@@ -1355,6 +1457,23 @@ bool Bus::isAddressInEeprom(uint32_t address) {
 }
 
 
+void Bus::setRamPatches(std::vector<RamPatch> patches) {
+    ramPatches = std::move(patches);
+    applyRamPatches();
+}
+
+void Bus::applyRamPatches(uint32_t address, uint32_t bytes) {
+    auto patch = std::lower_bound(ramPatches.begin(), ramPatches.end(), address,
+                                  [](const RamPatch& patch, uint32_t address) { return patch.address < address; });
+    for(; patch != ramPatches.end() && patch->address - address < bytes; patch++) {
+        if(patch->address < 0x03000000) {
+            wRamBoard[patch->address - 0x02000000] = patch->value;
+        } else {
+            wRamChip[patch->address - 0x03000000] = patch->value;
+        }
+    }
+}
+
 void Bus::setEepromBusWidth(uint32_t width) {
     assert(width == 6 || width == 14);
 
@@ -1366,3 +1485,62 @@ void Bus::setEepromBusWidth(uint32_t width) {
     }
 }
 
+
+uint8_t* Bus::getSaveMemory() {
+    switch(cartSaveType) {
+        case FLASH512_TYPE:
+        case FLASH1024_TYPE: {
+            return flash.data();
+        }
+        case EEPROM_TYPE: {
+            return eeprom.data();
+        }
+        default: {
+            return gamePakSram.data();
+        }
+    }
+}
+
+size_t Bus::getSaveMemorySize() {
+    switch(cartSaveType) {
+        case FLASH512_TYPE: {
+            return 0x10000;
+        }
+        case FLASH1024_TYPE: {
+            return 0x20000;
+        }
+        case EEPROM_TYPE: {
+            return EEPROM::SIZE;
+        }
+        case NO_SAVE_TYPE: {
+            return 0;
+        }
+        default: {
+            // 32K sram, mirrored across the 64K area
+            return 0x8000;
+        }
+    }
+}
+
+void Bus::serialize(Serializer& serializer) {
+    serializer.vector(wRamBoard);
+    serializer.vector(wRamChip);
+    serializer.vector(iORegisters);
+    serializer.vector(paletteRam);
+    serializer.vector(vRam);
+    serializer.vector(objAttributes);
+    serializer.vector(gamePakSram);
+    serializer.value(cartSaveType);
+    serializer.value(largeCart);
+    serializer.value(haltMode);
+    serializer.value(stopMode);
+    serializer.value(ppuMemDirty);
+    serializer.value(currentNWaitstate);
+    serializer.value(currentSWaitstate);
+    serializer.value(memAccessCycles);
+    serializer.value(executionTimelineSize);
+    serializer.array(executionTimelineCycles);
+    serializer.array(executionTimelineCycleType);
+    eeprom.serialize(serializer);
+    flash.serialize(serializer);
+}
@@ -7,6 +7,7 @@
 #include <memory>
 #include "EEPROM.h"
 #include "Flash.h"
+#include "GameDatabase.h"
 
 //#define LARGE_CARTRIDGE 1;
 #define FLASH_CART 1;
@@ -15,6 +16,9 @@ class PPU;
 class Timer;
 class ARM7TDMI;
 class DMA;
+class Gamepad;
+class Serial;
+class Serializer;
 
 class Bus {
     // TODO: implement an OPEN BUS (ie if retreiving invalid mem location, return value last on bus)
@@ -29,6 +33,8 @@ class Bus {
     void connectTimer(std::shared_ptr<Timer> timer);
     void connectDma(std::shared_ptr<DMA> dma);
     void connectPpu(std::shared_ptr<PPU> ppu);
+    void connectGamepad(std::shared_ptr<Gamepad> gamepad);
+    void connectSerial(std::shared_ptr<Serial> serial);
 
     enum CycleType {
         SEQUENTIAL,
@@ -46,6 +52,17 @@ class Bus {
         KEYINPUT = 0x04000130 - 0x04000000, // KEYINPUT - Key Status (R)
         KEYCNT = 0x04000132 - 0x04000000, // R/W  KEYCNT    Key Interrupt Control
 
+        SIODATA32 = 0x04000120 - 0x04000000, // SIO Normal Communication 32bit Data
+        SIOMULTI0 = 0x04000120 - 0x04000000, // SIO Multi-Player Data 0 (Parent), followed by SIOMULTI1-3
+        SIOCNT = 0x04000128 - 0x04000000, // SIO Control Register
+        SIODATA8 = 0x0400012A - 0x04000000, // SIO Normal Communication 8bit Data
+        SIOMLT_SEND = 0x0400012A - 0x04000000, // SIO Multi-Player Data Send
+        RCNT = 0x04000134 - 0x04000000, // SIO Mode Select/General Purpose Data
+
+        SOUNDCNT_H = 0x04000082 - 0x04000000, // Control Mixing/DMA Control
+        FIFO_A = 0x040000A0 - 0x04000000, // Channel A FIFO, Data 0-3
+        FIFO_B = 0x040000A4 - 0x04000000, // Channel B FIFO, Data 0-3
+
         DMA0SAD = 0x040000B0 - 0x04000000, // DMA 0 Source Address
         DMA0DAD = 0x040000B4 - 0x04000000, // DMA 0 Destination Address
         DMA0CNT_L = 0x040000B8 - 0x04000000, // DMA 0 Word Count
@@ -92,12 +109,20 @@ class Bus {
         FLASH512_TYPE,
         FLASH1024_TYPE,
         SRAM_TYPE,
-        EEPROM_TYPE
+        EEPROM_TYPE,
+        // listed in the game database without save memory, the save area reads as open bus (FFh)
+        NO_SAVE_TYPE
     };
 
     CartSaveType cartSaveType;
+    // the rom's game database entry, nullptr if it isn't listed
+    const GameDatabase::Entry* gameEntry = nullptr;
 
     bool haltMode = false;
+    // only woken up by keypad, serial or game pak interrupts
+    bool stopMode = false;
+    // set by any read of KEYINPUT, for the warm start trigger (see WarmStart.h)
+    bool keypadRead = false;
 
     /* General Internal Memory */
 
@@ -167,11 +192,32 @@ class Bus {
 
     void setEepromBusWidth(uint32_t width);
 
+    // the battery backed save memory of the cartridge's save type (sram, flash or eeprom), valid for the lifetime
+    // of the bus. Eeprom contents are stored as 64 bit host order words
+    uint8_t* getSaveMemory();
+    size_t getSaveMemorySize();
+
+    // work ram bytes held at a value by cheats (see Cheats.h): they are written when set and rewritten after every
+    // write that touches them, so reads never need to check for them. Addresses are 0x02000000-0x0203FFFF and
+    // 0x03000000-0x03007FFF (no mirrors), sorted
+    struct RamPatch {
+        uint32_t address;
+        uint8_t value;
+    };
+    void setRamPatches(std::vector<RamPatch> patches);
+    // rewrites the patches in [address, address + bytes), after anything that changes work ram behind the bus
+    void applyRamPatches(uint32_t address = 0, uint32_t bytes = UINT32_MAX);
+
+    // save states (everything but the bios and rom), see util/Serializer.h
+    void serialize(Serializer& serializer);
+
    private:
     uint8_t currentNWaitstate;
     uint8_t currentSWaitstate;
 
     uint32_t view(uint32_t address, uint8_t width);
+    // save type from the save library id in the rom, for roms that aren't in the game database
+    void detectSaveType(std::vector<uint8_t>& buffer);
 
     uint32_t read(uint32_t address, uint8_t width, CycleType accessType);
     void write(uint32_t address, uint32_t value, uint8_t width, CycleType accessType);
@@ -201,9 +247,13 @@ class Bus {
 
     uint32_t memAccessCycles = 0;
 
+    std::vector<RamPatch> ramPatches;
+
     std::shared_ptr<PPU> ppu;
     std::shared_ptr<Timer> timer; 
     std::shared_ptr<DMA> dma;
+    std::shared_ptr<Gamepad> gamepad;
+    std::shared_ptr<Serial> serial;
     EEPROM eeprom;
     Flash flash;
 
@@ -1,5 +1,7 @@
 #include "EEPROM.h"
 #include "../util/macros.h"
+#include "../util/Log.h"
+#include "../util/Serializer.h"
 
 #include "assert.h"
 
@@ -27,7 +29,7 @@ void EEPROM::transferBitToEeprom(bool bit) {
             valueToWrite = 0;
             currTransferSize = writeSize;
         } else {
-            DEBUGWARN((uint32_t)op << " :invalid eeprom op\n");
+            LOG_WARN(MEMORY, (uint32_t)op << " :invalid eeprom op\n");
         }
     } else if(currTransferBit < (currTransferSize - 1)) {
 
@@ -107,4 +109,28 @@ void EEPROM::setBusWidth(uint32_t width) {
         writeSize = FOURTEEN_BIT_WRITE_SIZE;
         readSize = FOURTEEN_BIT_READ_SIZE;
     }
-}
\ No newline at end of file
+}
+
+uint8_t* EEPROM::data() {
+    return (uint8_t*)eeprom.data();
+}
+
+void EEPROM::serialize(Serializer& serializer) {
+    serializer.value(busWidth);
+    serializer.value(writeSize);
+    serializer.value(readSize);
+    serializer.value(currTransferBit);
+    serializer.value(currReceivingBit);
+    serializer.value(address);
+    serializer.value(currAddressBit);
+    serializer.value(currTransferSize);
+    serializer.value(currWriteValueBit);
+    serializer.value(currReadValueBit);
+    serializer.value(valueToRead);
+    serializer.value(valueToWrite);
+    serializer.value(readyToRead);
+    serializer.value(writeComplete);
+    serializer.value(firstBit);
+    serializer.value(op);
+    serializer.array(eeprom);
+}
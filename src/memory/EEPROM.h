@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <array>
 
+class Serializer;
+
 
 class EEPROM {
 
@@ -20,6 +22,12 @@ class EEPROM {
 
         void setBusWidth(uint32_t width);
 
+        // 1024 64 bit blocks (8KB) with a 14 bit bus, only the first 64 are addressable with a 6 bit bus
+        static constexpr uint32_t SIZE = 0x2000;
+        uint8_t* data();
+
+        void serialize(Serializer& serializer);
+
     private:
         
         uint32_t busWidth = 0;
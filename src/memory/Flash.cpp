@@ -1,5 +1,7 @@
 #include "Flash.h"
 #include "../util/macros.h"
+#include "../util/Log.h"
+#include "../util/Serializer.h"
 
 #include <algorithm> 
 
@@ -17,7 +19,7 @@ void Flash::write(uint32_t address, uint8_t value) {
         if(address == 0x0E000000 && (value == 0 || value == 1)) {
             bank = value * 0x10000;
         } else {
-            DEBUGWARN("currMode error in mem bank command\n");
+            LOG_WARN(MEMORY, "currMode error in mem bank command\n");
         }
         currMode = READY;
     } else if(address == 0xE005555 && value == 0xAA) {
@@ -57,7 +59,7 @@ void Flash::write(uint32_t address, uint8_t value) {
                     // TODO: cycle accuracy? (this normally takes some time)
                     flash.fill(0xFF);
                 } else {
-                    DEBUGWARN("currMode not erase, something wrong in flash!\n");
+                    LOG_WARN(MEMORY, "currMode not erase, something wrong in flash!\n");
                 }
                 break;
             }
@@ -67,7 +69,7 @@ void Flash::write(uint32_t address, uint8_t value) {
                     uint32_t page = (address & 0x0000F000);
                     std::fill_n(flash.begin() + page + bank, 0xFFF, 0xFF);
                 } else {    
-                    DEBUGWARN("currMode not erase, something wrong in flash!\n");
+                    LOG_WARN(MEMORY, "currMode not erase, something wrong in flash!\n");
                 }
                 break;
             }
@@ -107,4 +109,19 @@ void Flash::setSize(uint32_t size) {
         manufacturerId = 0x32;
         deviceId = 0x1B;
     }
-}
\ No newline at end of file
+}
+
+uint8_t* Flash::data() {
+    return flash.data();
+}
+
+void Flash::serialize(Serializer& serializer) {
+    serializer.value(currMode);
+    serializer.value(currStage);
+    serializer.array(flash);
+    serializer.value(manufacturerId);
+    serializer.value(deviceId);
+    serializer.value(temp0x0);
+    serializer.value(temp0x1);
+    serializer.value(bank);
+}
@@ -2,6 +2,8 @@
 #include <cstdint>
 #include <array>
 
+class Serializer;
+
 class Flash {
 
     public: 
@@ -18,6 +20,10 @@ class Flash {
 
         void setSize(uint32_t size);
 
+        uint8_t* data();
+
+        void serialize(Serializer& serializer);
+
 
     private:
         Mode currMode = READY;
@@ -0,0 +1,172 @@
+#include "GameDatabase.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+using Entry = GameDatabase::Entry;
+constexpr auto gameCode = GameDatabase::gameCode;
+
+// sorted by code, then crc (checked below)
+constexpr Entry ENTRIES[] = {
+    // Top Gun: Combat Zones (USA)
+    {gameCode("A2YE"), 0, GameDatabase::NO_SAVE, 0, 0, 0},
+    // Iridion II (USA)
+    {gameCode("AI2E"), 0, GameDatabase::NO_SAVE, 0, 0, 0},
+    // Super Mario Advance 4: Super Mario Bros. 3 (USA)
+    {gameCode("AX4E"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Super Mario Advance 4: Super Mario Bros. 3 (Japan)
+    {gameCode("AX4J"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Super Mario Advance 4: Super Mario Bros. 3 (Europe)
+    {gameCode("AX4P"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon Sapphire (Germany)
+    {gameCode("AXPD"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Sapphire (USA)
+    {gameCode("AXPE"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Sapphire (France)
+    {gameCode("AXPF"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Sapphire (Italy)
+    {gameCode("AXPI"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Sapphire (Japan)
+    {gameCode("AXPJ"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Sapphire (Europe)
+    {gameCode("AXPP"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Sapphire (Spain)
+    {gameCode("AXPS"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Ruby (Germany)
+    {gameCode("AXVD"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Ruby (USA)
+    {gameCode("AXVE"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Ruby (France)
+    {gameCode("AXVF"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Ruby (Italy)
+    {gameCode("AXVI"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Ruby (Japan)
+    {gameCode("AXVJ"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Ruby (Europe)
+    {gameCode("AXVP"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Ruby (Spain)
+    {gameCode("AXVS"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Emerald (Germany)
+    {gameCode("BPED"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Emerald (USA)
+    {gameCode("BPEE"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Emerald (France)
+    {gameCode("BPEF"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Emerald (Italy)
+    {gameCode("BPEI"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Emerald (Japan)
+    {gameCode("BPEJ"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Emerald (Europe)
+    {gameCode("BPEP"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon Emerald (Spain)
+    {gameCode("BPES"), 0, GameDatabase::FLASH, 0x20000, 0, GameDatabase::RTC},
+    // Pokemon LeafGreen (Germany)
+    {gameCode("BPGD"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon LeafGreen (USA)
+    {gameCode("BPGE"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon LeafGreen (France)
+    {gameCode("BPGF"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon LeafGreen (Italy)
+    {gameCode("BPGI"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon LeafGreen (Japan)
+    {gameCode("BPGJ"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon LeafGreen (Europe)
+    {gameCode("BPGP"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon LeafGreen (Spain)
+    {gameCode("BPGS"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon FireRed (Germany)
+    {gameCode("BPRD"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon FireRed (USA)
+    {gameCode("BPRE"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon FireRed (France)
+    {gameCode("BPRF"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon FireRed (Italy)
+    {gameCode("BPRI"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon FireRed (Japan)
+    {gameCode("BPRJ"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon FireRed (Europe)
+    {gameCode("BPRP"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // Pokemon FireRed (Spain)
+    {gameCode("BPRS"), 0, GameDatabase::FLASH, 0x20000, 0, 0},
+    // The Legend of Zelda: The Minish Cap (USA)
+    {gameCode("BZME"), 0, GameDatabase::EEPROM, 0x2000, 0, 0},
+    // The Legend of Zelda: The Minish Cap (Japan)
+    {gameCode("BZMJ"), 0, GameDatabase::EEPROM, 0x2000, 0, 0},
+    // The Legend of Zelda: The Minish Cap (Europe)
+    {gameCode("BZMP"), 0, GameDatabase::EEPROM, 0x2000, 0, 0},
+};
+
+constexpr bool before(const Entry& a, uint32_t code, uint32_t crc) {
+    return a.code != code ? a.code < code : a.crc < crc;
+}
+
+constexpr bool isSorted() {
+    for(size_t i = 1; i < std::size(ENTRIES); i++) {
+        if(!before(ENTRIES[i - 1], ENTRIES[i].code, ENTRIES[i].crc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(isSorted(), "game database entries must be sorted by code and crc, without duplicates");
+
+std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table;
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+}
+
+const GameDatabase::Entry* GameDatabase::lookup(const std::vector<uint8_t>& rom) {
+    constexpr size_t GAME_CODE_OFFSET = 0xAC;
+    if(rom.size() < GAME_CODE_OFFSET + 4) {
+        return nullptr;
+    }
+    uint32_t code = ((uint32_t)rom[GAME_CODE_OFFSET] << 24) | ((uint32_t)rom[GAME_CODE_OFFSET + 1] << 16) |
+                    ((uint32_t)rom[GAME_CODE_OFFSET + 2] << 8) | (uint32_t)rom[GAME_CODE_OFFSET + 3];
+
+    const Entry* first = std::lower_bound(std::begin(ENTRIES), std::end(ENTRIES), code, [](const Entry& entry, uint32_t code) {
+        return entry.code < code;
+    });
+    const Entry* last = first;
+    while(last != std::end(ENTRIES) && last->code == code) {
+        last++;
+    }
+    if(first == last) {
+        return nullptr;
+    }
+    if(last - first == 1 && first->crc == 0) {
+        return first;
+    }
+
+    // revision specific entries, the any revision one (crc 0) sorts first
+    uint32_t crc = crc32(rom.data(), rom.size());
+    const Entry* match = std::lower_bound(first, last, crc, [code](const Entry& entry, uint32_t crc) {
+        return before(entry, code, crc);
+    });
+    if(match != last && match->crc == crc) {
+        return match;
+    }
+    return first->crc == 0 ? first : nullptr;
+}
+
+uint32_t GameDatabase::crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = makeCrcTable();
+    uint32_t crc = 0xFFFFFFFF;
+    for(size_t i = 0; i < size; i++) {
+        crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xFF];
+    }
+    return ~crc;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+    Per title settings compiled into the binary, sorted by the game code in the rom header (4 characters at
+    0xAC) and then by the CRC32 of the whole rom, so a rom is found with a binary search on its header. An entry
+    with crc 0 matches every revision of the game, the CRC is only computed if a game has revision specific
+    entries. Roms that aren't listed fall back to scanning for the save library id (see Bus::loadRom).
+*/
+class GameDatabase {
+
+    public:
+        enum SaveType : uint8_t {
+            NO_SAVE,
+            SRAM,
+            FLASH,
+            EEPROM
+        };
+
+        enum Flags : uint8_t {
+            // cartridge real time clock (not emulated yet)
+            RTC = 0x01,
+            // breaks with high level emulation of the bios calls, needs the bios to run
+            NO_HLE = 0x02,
+            // relies on the game pak prefetch buffer (not emulated yet)
+            PREFETCH = 0x04
+        };
+
+        struct Entry {
+            // see gameCode
+            uint32_t code;
+            uint32_t crc;
+            SaveType saveType;
+            // bytes: sram 0x8000, flash 0x10000 or 0x20000, eeprom 0x200 (6 bit addresses) or 0x2000 (14 bit)
+            uint32_t saveSize;
+            // address of a busy wait loop (0 if unknown), for skipping idle time of games that don't halt (not
+            // used yet)
+            uint32_t idleLoop;
+            uint8_t flags;
+        };
+
+        // the 4 characters as a big endian word, so entries sort alphabetically
+        static constexpr uint32_t gameCode(const char (&code)[5]) {
+            return ((uint32_t)(uint8_t)code[0] << 24) | ((uint32_t)(uint8_t)code[1] << 16) |
+                   ((uint32_t)(uint8_t)code[2] << 8) | (uint32_t)(uint8_t)code[3];
+        }
+
+        // nullptr if the rom isn't listed
+        static const Entry* lookup(const std::vector<uint8_t>& rom);
+        static uint32_t crc32(const uint8_t* data, size_t size);
+};
@@ -0,0 +1,160 @@
+#include "Log.h"
+#include "MpscQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace Log {
+
+std::atomic<uint8_t> levels[CATEGORY_COUNT] = {WARN, WARN, WARN, WARN, WARN, WARN, WARN};
+
+static const char* CATEGORY_NAMES[CATEGORY_COUNT] = {"cpu", "ppu", "dma", "memory", "scheduler", "debugger", "general"};
+static const char* LEVEL_NAMES[] = {"off", "warn", "info"};
+
+namespace {
+    struct Message {
+        Category category;
+        Level level;
+        uint64_t hits;
+        char text[240];
+    };
+
+    // owns the writer thread, created on the first message so nothing is started if nothing is ever logged
+    class Sink {
+        public:
+            Sink() : writer(&Sink::run, this) {}
+
+            ~Sink() {
+                stopping.store(true, std::memory_order_release);
+                writer.join();
+                uint64_t dropped = this->dropped.load(std::memory_order_relaxed);
+                if(dropped != 0) {
+                    std::cout << "WARN: [log] " << dropped << " messages dropped, the log queue was full\n";
+                }
+            }
+
+            void push(const Message& message) {
+                if(queue.push(message)) {
+                    queued.fetch_add(1, std::memory_order_release);
+                } else {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            void flush() {
+                while(written.load(std::memory_order_acquire) < queued.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+            }
+
+        private:
+            MpscQueue<Message, 1024> queue;
+            std::atomic<uint64_t> queued = {0};
+            std::atomic<uint64_t> written = {0};
+            std::atomic<uint64_t> dropped = {0};
+            std::atomic<bool> stopping = {false};
+            std::thread writer;
+
+            void run() {
+                Message message;
+                while(true) {
+                    if(queue.pop(message)) {
+                        print(message);
+                        written.fetch_add(1, std::memory_order_release);
+                    } else if(stopping.load(std::memory_order_acquire)) {
+                        break;
+                    } else {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                }
+                std::cout.flush();
+            }
+
+            void print(const Message& message) {
+                std::cout << (message.level == WARN ? "WARN: [" : "INFO: [") << CATEGORY_NAMES[message.category] << "] "
+                          << message.text;
+                if(message.hits > 8) {
+                    std::cout << " (x" << message.hits << ")";
+                }
+                std::cout << "\n";
+            }
+    };
+
+    Sink& sink() {
+        static Sink sink;
+        return sink;
+    }
+
+    // applies GBA_LOG before main
+    struct EnvironmentConfig {
+        EnvironmentConfig() {
+            const char* spec = std::getenv("GBA_LOG");
+            if(spec != nullptr && !configure(spec)) {
+                std::cerr << "WARN: [log] could not parse GBA_LOG=" << spec << "\n";
+            }
+        }
+    } environmentConfig;
+}
+
+void setLevel(Category category, Level level) {
+    levels[category].store(level, std::memory_order_relaxed);
+}
+
+bool configure(const std::string& spec) {
+    bool valid = true;
+    size_t begin = 0;
+    while(begin <= spec.size()) {
+        size_t end = std::min(spec.find(',', begin), spec.size());
+        std::string entry = spec.substr(begin, end - begin);
+        begin = end + 1;
+        if(entry.empty()) {
+            continue;
+        }
+
+        size_t separator = entry.find('=');
+        std::string categoryName = entry.substr(0, separator);
+        std::string levelName = (separator == std::string::npos) ? "" : entry.substr(separator + 1);
+        const char** levelEnd = LEVEL_NAMES + 3;
+        const char** level = std::find_if(LEVEL_NAMES, levelEnd, [&](const char* name) { return levelName == name; });
+        if(level == levelEnd) {
+            valid = false;
+            continue;
+        }
+
+        bool matched = false;
+        for(uint8_t category = 0; category < CATEGORY_COUNT; category++) {
+            if(categoryName == "all" || categoryName == CATEGORY_NAMES[category]) {
+                setLevel((Category)category, (Level)(level - LEVEL_NAMES));
+                matched = true;
+            }
+        }
+        valid &= matched;
+    }
+    return valid;
+}
+
+void write(Category category, Level level, const std::string& message, uint64_t hits) {
+    Message entry;
+    entry.category = category;
+    entry.level = level;
+    entry.hits = hits;
+    // call sites end their messages with newlines like they did with std::cout, the sink adds its own
+    size_t length = message.size();
+    while(length > 0 && (message[length - 1] == '\n' || message[length - 1] == '\r')) {
+        length--;
+    }
+    length = std::min(length, sizeof(entry.text) - 1);
+    memcpy(entry.text, message.data(), length);
+    entry.text[length] = '\0';
+    sink().push(entry);
+}
+
+void flush() {
+    sink().flush();
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// highest level that is compiled in, 0 = nothing, 1 = warnings, 2 = info. Set with -DGBA_LOG_LEVEL=n
+#ifndef GBA_LOG_LEVEL
+#define GBA_LOG_LEVEL 1
+#endif
+
+/*
+    diagnostic logging, used through LOG_WARN(category, x) and LOG_INFO(category, x) where x is anything that can be
+    streamed into a std::ostream, ie. LOG_WARN(PPU, "bg mode " << mode << " unimplemented\n").
+
+    - levels above GBA_LOG_LEVEL are removed at compile time, the message isn't even formatted
+    - every category has a runtime level (WARN by default, overridden by the GBA_LOG environment variable,
+      ie. GBA_LOG=ppu=off,cpu=info or GBA_LOG=all=off). A disabled message costs one relaxed atomic load
+    - every call site is rate limited, its first 8 messages are printed and after that only the 16th, 32nd, 64th...
+      together with the number of times the site was hit
+    - messages are formatted on the calling thread and handed to a writer thread through a lock-free queue, so the
+      emulation never blocks on stdout. If the queue is full the message is dropped and counted
+*/
+namespace Log {
+    enum Category : uint8_t {
+        CPU,
+        PPU,
+        DMA,
+        MEMORY,
+        SCHEDULER,
+        DEBUGGER,
+        GENERAL,
+        CATEGORY_COUNT
+    };
+
+    enum Level : uint8_t {
+        OFF = 0,
+        WARN = 1,
+        INFO = 2
+    };
+
+    extern std::atomic<uint8_t> levels[CATEGORY_COUNT];
+
+    void setLevel(Category category, Level level);
+
+    // comma separated list of <category>=<level> (or all=<level>), returns false if anything couldn't be parsed
+    bool configure(const std::string& spec);
+
+    inline bool enabled(Category category, Level level) {
+        return level <= levels[category].load(std::memory_order_relaxed);
+    }
+
+    // counts a hit of a call site, returns the hit number if it should be printed and 0 if it is suppressed
+    inline uint64_t rateLimit(std::atomic<uint64_t>& siteHits) {
+        uint64_t hits = siteHits.fetch_add(1, std::memory_order_relaxed) + 1;
+        return (hits <= 8 || (hits & (hits - 1)) == 0) ? hits : 0;
+    }
+
+    void write(Category category, Level level, const std::string& message, uint64_t hits);
+
+    // blocks until every message written so far has been printed
+    void flush();
+}
+
+#define GBA_LOG(category, level, x)                                                             \
+    do {                                                                                        \
+        if constexpr(Log::level <= GBA_LOG_LEVEL) {                                             \
+            if(__builtin_expect(Log::enabled(Log::category, Log::level), 0)) {                  \
+                static std::atomic<uint64_t> logSiteHits = {0};                                 \
+                uint64_t logHits = Log::rateLimit(logSiteHits);                                 \
+                if(logHits != 0) {                                                              \
+                    std::ostringstream logStream;                                               \
+                    logStream << x;                                                             \
+                    Log::write(Log::category, Log::level, logStream.str(), logHits);            \
+                }                                                                               \
+            }                                                                                   \
+        }                                                                                       \
+    } while(0)
+
+#define LOG_WARN(category, x) GBA_LOG(category, WARN, x)
+#define LOG_INFO(category, x) GBA_LOG(category, INFO, x)
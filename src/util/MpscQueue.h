@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+    lock-free bounded multiple producer single consumer queue (Vyukov style, every slot carries a sequence number).
+    push() may be called from any number of threads, pop() must only be called from one thread.
+    Capacity must be a power of 2.
+*/
+template <typename T, size_t Capacity>
+class MpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "MpscQueue capacity must be a power of 2");
+
+    public:
+        MpscQueue() {
+            for(size_t i = 0; i < Capacity; i++) {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // returns false if the queue is full
+        bool push(const T& value) {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            while(true) {
+                Slot& slot = slots[tail & (Capacity - 1)];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                intptr_t difference = (intptr_t)sequence - (intptr_t)tail;
+                if(difference == 0) {
+                    // slot is free for this position, claim it
+                    if(this->tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                        slot.value = value;
+                        slot.sequence.store(tail + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if(difference < 0) {
+                    // consumer hasn't freed this slot yet
+                    return false;
+                } else {
+                    // another producer claimed it first
+                    tail = this->tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // returns false if the queue is empty
+        bool pop(T& value) {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            Slot& slot = slots[head & (Capacity - 1)];
+            if(slot.sequence.load(std::memory_order_acquire) != head + 1) {
+                return false;
+            }
+            value = slot.value;
+            slot.sequence.store(head + Capacity, std::memory_order_release);
+            this->head.store(head + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        // head and tail on separate cache lines so producers and the consumer don't contend
+        alignas(64) std::atomic<size_t> head = {0};
+        alignas(64) std::atomic<size_t> tail = {0};
+        std::array<Slot, Capacity> slots;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/*
+    Save state serialization. Every component has one serialize(Serializer&) method that walks its state in a fixed
+    order, the mode of the serializer decides what happens to it:
+        - MEASURE only counts the bytes, to size the buffer
+        - SAVE copies the state into the buffer
+        - LOAD copies it back out of the buffer
+    Values are copied as raw bytes in host byte order. Vectors are copied without their size, it is fixed by their
+    owner. Running past the end of the buffer sets failed and nothing more is copied.
+*/
+class Serializer {
+
+    public:
+        enum Mode {
+            MEASURE,
+            SAVE,
+            LOAD
+        };
+
+        Serializer(Mode mode, uint8_t* buffer = nullptr, size_t size = 0) : mode(mode), buffer(buffer), size(size) {}
+
+        template <typename T>
+        void value(T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "only plain values can be copied");
+            bytes(&value, sizeof(T));
+        }
+
+        template <typename T, size_t N>
+        void array(std::array<T, N>& array) {
+            static_assert(std::is_trivially_copyable<T>::value, "only plain values can be copied");
+            bytes(array.data(), sizeof(T) * N);
+        }
+
+        template <typename T, size_t N>
+        void array(T (&array)[N]) {
+            static_assert(std::is_trivially_copyable<T>::value, "only plain values can be copied");
+            bytes(array, sizeof(T) * N);
+        }
+
+        template <typename T>
+        void vector(std::vector<T>& vector) {
+            static_assert(std::is_trivially_copyable<T>::value, "only plain values can be copied");
+            bytes(vector.data(), sizeof(T) * vector.size());
+        }
+
+        void bytes(void* data, size_t count) {
+            if(mode != MEASURE) {
+                if(failed || count > size - offset) {
+                    failed = true;
+                    return;
+                }
+                if(mode == SAVE) {
+                    memcpy(buffer + offset, data, count);
+                } else {
+                    memcpy(data, buffer + offset, count);
+                }
+            }
+            offset += count;
+        }
+
+        bool isLoading() {
+            return mode == LOAD;
+        }
+
+        size_t getOffset() {
+            return offset;
+        }
+
+        bool hasFailed() {
+            return failed;
+        }
+
+    private:
+        Mode mode;
+        uint8_t* buffer;
+        size_t size;
+        size_t offset = 0;
+        bool failed = false;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/*
+    lock-free single producer single consumer ring buffer.
+    push() must only be called from one thread and pop() from one (other) thread.
+    Capacity must be a power of 2, one slot is always left empty.
+*/
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of 2");
+
+    public:
+        // returns false if the queue is full
+        bool push(const T& value) {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            size_t nextTail = (tail + 1) & (Capacity - 1);
+            if(nextTail == head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            buffer[tail] = value;
+            this->tail.store(nextTail, std::memory_order_release);
+            return true;
+        }
+
+        // returns false if the queue is empty
+        bool pop(T& value) {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            if(head == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = buffer[head];
+            this->head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        // head and tail on separate cache lines so producer and consumer don't contend
+        alignas(64) std::atomic<size_t> head = {0};
+        alignas(64) std::atomic<size_t> tail = {0};
+        std::array<T, Capacity> buffer;
+};
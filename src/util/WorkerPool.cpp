@@ -0,0 +1,80 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(uint32_t threads) {
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(uint32_t i = 1; i < threads; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+uint32_t WorkerPool::getThreadCount() {
+    return workers.size() + 1;
+}
+
+void WorkerPool::run(size_t tasks, const std::function<void(size_t)>& task) {
+    if(workers.empty() || tasks <= 1) {
+        for(size_t i = 0; i < tasks; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        taskCount = tasks;
+        nextTask.store(0, std::memory_order_relaxed);
+        busyWorkers = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return busyWorkers == 0; });
+    this->task = nullptr;
+}
+
+void WorkerPool::workerLoop() {
+    uint64_t lastGeneration = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != lastGeneration; });
+            if(stopping) {
+                return;
+            }
+            lastGeneration = generation;
+        }
+
+        work();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--busyWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void WorkerPool::work() {
+    size_t i;
+    while((i = nextTask.fetch_add(1, std::memory_order_relaxed)) < taskCount) {
+        (*task)(i);
+    }
+}
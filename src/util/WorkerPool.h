@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    fixed set of worker threads for data parallel work.
+    run() hands out tasks 0..n-1 dynamically, the calling thread works on them too and run() returns once all of
+    them are finished. run() must only be called from one thread at a time.
+*/
+class WorkerPool {
+
+    public:
+        // threads includes the calling thread, 0 uses the hardware concurrency
+        explicit WorkerPool(uint32_t threads = 0);
+        ~WorkerPool();
+
+        uint32_t getThreadCount();
+
+        void run(size_t tasks, const std::function<void(size_t)>& task);
+
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+
+        // current job, only changed under mutex while no worker is in it
+        const std::function<void(size_t)>* task = nullptr;
+        size_t taskCount = 0;
+        std::atomic<size_t> nextTask = {0};
+        // workers that haven't finished the current job yet
+        size_t busyWorkers = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+
+        void workerLoop();
+        void work();
+};
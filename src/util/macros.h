@@ -1,29 +1,13 @@
 #pragma once
 
 #include <iostream>
+#include "Log.h"
 
 #define likely(x)       __builtin_expect((x),1)
 #define unlikely(x)     __builtin_expect((x),0)
 
 #define NDEBUG 1;
-//#define NDEBUGWARN 1;
 
-
-#ifdef NDEBUG
-#define DEBUG(x)
-#else
-#define DEBUG(x)        \
-    do {                \
-        std::cout << "INFO: " << x; \
-    } while (0)
-#endif
-
-
-#ifdef NDEBUGWARN
-#define DEBUGWARN(x)
-#else
-#define DEBUGWARN(x)        \
-    do {                \
-        std::cout << "WARN: " << x; \
-    } while (0)
-#endif
+// uncategorized diagnostics, prefer LOG_WARN / LOG_INFO with a category (see Log.h)
+#define DEBUG(x)        LOG_INFO(GENERAL, x)
+#define DEBUGWARN(x)    LOG_WARN(GENERAL, x)
@@ -1,17 +1,52 @@
 #include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <bitset>
 #include <assert.h>
 
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 #define ASSERT_EQUAL(message, expected, actual) \
     if (expected != actual) { \
         DEBUG("ASSERTION FAILED: " << message <<  \
         " expected: " << expected << " != actual: " << actual << \
-        "\n"); assert(false); } 
+        "\n"); assert(false); }
+
+/*
+    CPU trace verification.
+
+    Reference traces are text logs, one instruction per line:
+    address,instruction,cpsr,r0,...,r15,cycles (hex, cycles decimal).
+    The first time a log is used it is converted to a packed binary trace next to it (<log>.trace, host endian,
+    TraceHeader followed by cpu_log records) and from then on the binary trace is memory mapped, so a trace is never
+    parsed or loaded as a whole. Records are compared as the cpu steps and nothing is printed unless the
+    state diverges.
+
+    Every TraceJob runs on its own machine, so several traces (or shards of one trace) can be verified in parallel.
+    A shard [begin, end) steps unchecked through the instructions before begin, memory state at an arbitrary point
+    of the trace isn't recorded so every shard has to replay from reset.
+*/
 
 typedef struct cpu_log {
     uint32_t address;
@@ -21,61 +56,329 @@ typedef struct cpu_log {
     uint32_t cycles;
 } cpu_log_t;
 
-std::vector<cpu_log> getLogs(std::string path) {
-    std::ifstream logFile;
-    logFile.open(path);
-    std::string line;
+static_assert(sizeof(cpu_log) == 20 * sizeof(uint32_t), "cpu_log has to be packed, it's mapped straight from disk");
 
-    std::vector<cpu_log> logs;
-    std::string delimiter = ",";
-    while (std::getline(logFile, line)) {
-        // std::cout << line << std::endl;
-        int currentPos = 0;
-        int nextPos = (line.find(delimiter, currentPos) == std::string::npos)
-                          ? line.size()
-                          : line.find(delimiter, currentPos);
-        std::string value;
-        cpu_log log;
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t count;
+};
+
+static const char TRACE_MAGIC[8] = {'G', 'B', 'A', 'T', 'R', 'A', 'C', 'E'};
+static const uint32_t TRACE_VERSION = 1;
 
-        value = line.substr(currentPos, nextPos - currentPos);
-        log.address = std::stoul(value, nullptr, 16);
-        currentPos = nextPos + 1;
-        nextPos = (line.find(delimiter, currentPos) == std::string::npos)
-                      ? line.size()
-                      : line.find(delimiter, currentPos);
-
-        value = line.substr(currentPos, nextPos - currentPos);
-        log.instruction = std::stoul(value, nullptr, 16);
-        currentPos = nextPos + 1;
-        nextPos = (line.find(delimiter, currentPos) == std::string::npos)
-                      ? line.size()
-                      : line.find(delimiter, currentPos);
-
-        value = line.substr(currentPos, nextPos - currentPos);
-        log.cpsr = std::stoul(value, nullptr, 16);
-        currentPos = nextPos + 1;
-        nextPos = (line.find(delimiter, currentPos) == std::string::npos)
-                      ? line.size()
-                      : line.find(delimiter, currentPos);
-
-        for (int i = 0; i < 16; i++) {
-            value = line.substr(currentPos, nextPos - currentPos);
-            log.r[i] = std::stoul(value, nullptr, 16);
-            currentPos = nextPos + 1;
-            nextPos = (line.find(delimiter, currentPos) == std::string::npos)
-                          ? line.size()
-                          : line.find(delimiter, currentPos);
+// read only view of a binary trace
+class MappedTrace {
+    public:
+        MappedTrace() = default;
+        MappedTrace(const MappedTrace&) = delete;
+        MappedTrace& operator=(const MappedTrace&) = delete;
+
+        ~MappedTrace() {
+#ifndef _WIN32
+            if(data != nullptr) {
+                munmap((void*)data, length);
+            }
+#endif
+        }
+
+        bool open(std::string path) {
+#ifndef _WIN32
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) {
+                return false;
+            }
+            struct stat info;
+            if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TraceHeader)) {
+                ::close(fd);
+                return false;
+            }
+            length = info.st_size;
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if(mapping == MAP_FAILED) {
+                return false;
+            }
+            data = (const uint8_t*)mapping;
+#ifdef MADV_SEQUENTIAL
+            madvise(mapping, length, MADV_SEQUENTIAL);
+#endif
+#else
+            std::ifstream file(path, std::ios::binary);
+            fallback = std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+            if(fallback.size() < sizeof(TraceHeader)) {
+                return false;
+            }
+            data = fallback.data();
+            length = fallback.size();
+#endif
+            const TraceHeader* header = (const TraceHeader*)data;
+            if(memcmp(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+               header->version != TRACE_VERSION ||
+               header->recordSize != sizeof(cpu_log) ||
+               sizeof(TraceHeader) + header->count * sizeof(cpu_log) > length) {
+                return false;
+            }
+            records = (const cpu_log*)(data + sizeof(TraceHeader));
+            count = header->count;
+            return true;
         }
 
-        value = line.substr(currentPos, nextPos - currentPos);
-        log.cycles = std::stoul(value, nullptr, 10);
-        currentPos = nextPos + 1;
-        nextPos = (line.find(delimiter, currentPos) == std::string::npos)
-                      ? line.size()
-                      : line.find(delimiter, currentPos);
+        uint64_t size() const {
+            return count;
+        }
 
-        logs.push_back(log);
+        const cpu_log& operator[](uint64_t index) const {
+            return records[index];
+        }
+
+    private:
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+        const cpu_log* records = nullptr;
+        uint64_t count = 0;
+#ifdef _WIN32
+        std::vector<uint8_t> fallback;
+#endif
+};
+
+// a temporary path next to path that no other thread or process converting the same log uses
+inline
+std::string uniqueTempPath(std::string path) {
+    static std::atomic<uint32_t> counter = {0};
+#ifdef _WIN32
+    uint32_t pid = (uint32_t)_getpid();
+#else
+    uint32_t pid = (uint32_t)getpid();
+#endif
+    return path + "." + std::to_string(pid) + "." + std::to_string(counter.fetch_add(1)) + ".tmp";
+}
+
+// converts a text log to a binary trace, returns false if the log can't be read or is malformed
+inline
+bool convertTextTrace(std::string textPath, std::string tracePath) {
+    std::ifstream text(textPath);
+    if(!text) {
+        return false;
+    }
+    // write to a temporary file first so a half written trace is never picked up
+    std::string tempPath = uniqueTempPath(tracePath);
+    std::ofstream out(tempPath, std::ios::binary);
+    auto fail = [&]() {
+        out.close();
+        std::error_code error;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    };
+    if(!out) {
+        return fail();
+    }
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(cpu_log);
+    header.count = 0;
+    out.write((const char*)&header, sizeof(header));
+
+    std::string line;
+    while(std::getline(text, line)) {
+        if(line.empty() || line == "\r") {
+            continue;
+        }
+        uint32_t fields[20];
+        const char* current = line.c_str();
+        for(int i = 0; i < 20; i++) {
+            char* end;
+            // last field is the cycle count in decimal
+            fields[i] = std::strtoul(current, &end, i == 19 ? 10 : 16);
+            if(end == current) {
+                return fail();
+            }
+            current = (*end == ',') ? end + 1 : end;
+        }
+        cpu_log log;
+        memcpy(&log, fields, sizeof(log));
+        out.write((const char*)&log, sizeof(log));
+        header.count++;
+    }
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    out.close();
+    if(!out) {
+        return fail();
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, tracePath, error);
+    if(error) {
+        return fail();
     }
-    return logs;
+    return true;
+}
+
+// returns the path of the binary trace for a text log (converting it if it's missing or stale),
+// binary traces are returned as is, returns "" on failure
+inline
+std::string prepareTrace(std::string path) {
+    std::filesystem::path logPath(path);
+    if(logPath.extension() == ".trace") {
+        return path;
+    }
+    std::filesystem::path tracePath = logPath;
+    tracePath += ".trace";
+    std::error_code error;
+    if(!std::filesystem::exists(tracePath, error) ||
+       std::filesystem::last_write_time(tracePath, error) < std::filesystem::last_write_time(logPath, error)) {
+        if(!convertTextTrace(logPath.string(), tracePath.string())) {
+            return "";
+        }
+    }
+    return tracePath.string();
+}
+
+struct TraceJob {
+    std::string name;
+    std::string rom;
+    std::string trace;
+    uint64_t begin = 0;
+    uint64_t end = UINT64_MAX;
+};
+
+struct TraceResult {
+    bool passed = false;
+    uint64_t checked = 0;
+    std::string log;
 };
 
+// cpu state in trace format, r15 in the trace is the address of the instruction plus the pipeline offset
+inline
+cpu_log currentState(ARM7TDMI* cpu, bool thumb) {
+    cpu_log state;
+    state.address = cpu->getRegister(15);
+    state.instruction = cpu->getCurrentInstruction();
+    state.cpsr = cpu->psrToInt(cpu->getCpsr());
+    for(int i = 0; i < 15; i++) {
+        state.r[i] = cpu->getRegister(i);
+    }
+    state.r[15] = cpu->getRegister(15) + (thumb ? 2 : 4);
+    state.cycles = 0;
+    return state;
+}
+
+inline
+void reportDivergence(std::ostream& out, const MappedTrace& trace, uint64_t index,
+                      const cpu_log& expected, const cpu_log& actual) {
+    bool thumb = expected.cpsr & 0x00000020;
+    out << "    diverged at instruction " << index << " (" << (thumb ? "thumb" : "arm") << ")\n";
+    uint64_t first = index < 4 ? 0 : index - 4;
+    for(uint64_t i = first; i < index; i++) {
+        out << "    " << std::setw(10) << std::dec << i << "  " << std::hex << std::setfill('0')
+            << std::setw(8) << trace[i].address << "  " << std::setw(8) << trace[i].instruction
+            << std::setfill(' ') << "\n";
+    }
+
+    const char* names[19] = {"address", "instruction", "cpsr", "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7",
+                             "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+    const uint32_t* expectedFields = (const uint32_t*)&expected;
+    const uint32_t* actualFields = (const uint32_t*)&actual;
+    out << "    " << std::setw(12) << "" << "  expected  actual\n";
+    for(int i = 0; i < 19; i++) {
+        out << "    " << std::setw(12) << names[i] << "  " << std::hex << std::setfill('0')
+            << std::setw(8) << expectedFields[i] << "  " << std::setw(8) << actualFields[i] << std::setfill(' ')
+            << (expectedFields[i] != actualFields[i] ? "  <--" : "") << "\n";
+    }
+    if(expected.cpsr != actual.cpsr) {
+        out << "    expected cpsr bits " << std::bitset<32>(expected.cpsr).to_string() << "\n"
+            << "    actual cpsr bits   " << std::bitset<32>(actual.cpsr).to_string() << "\n";
+    }
+    out << std::dec;
+}
+
+inline
+TraceResult verifyTrace(const TraceJob& job) {
+    TraceResult result;
+    std::ostringstream log;
+    MappedTrace trace;
+    if(!trace.open(job.trace)) {
+        result.log = "FAIL " + job.name + ": could not open trace " + job.trace + "\n";
+        return result;
+    }
+
+    GameBoyAdvanceImpl::cyclesSinceStart = 0;
+    GameBoyAdvanceImpl gba;
+    if(!gba.loadRom(job.rom)) {
+        result.log = "FAIL " + job.name + ": could not load rom " + job.rom + "\n";
+        return result;
+    }
+    ARM7TDMI* cpu = gba.getCpu();
+
+    // traces recorded after a bios boot start with whatever the bios left in r0-r12 and the flags,
+    // the emulator boots straight into the rom so that state is taken from the first record
+    if(trace.size() > 0) {
+        const cpu_log& boot = trace[0];
+        for(int i = 0; i < 13; i++) {
+            cpu->setRegister(i, boot.r[i]);
+        }
+        cpu->cpsr.N = (boot.cpsr >> 31) & 0x1;
+        cpu->cpsr.Z = (boot.cpsr >> 30) & 0x1;
+        cpu->cpsr.C = (boot.cpsr >> 29) & 0x1;
+        cpu->cpsr.V = (boot.cpsr >> 28) & 0x1;
+    }
+
+    uint64_t end = std::min(job.end, trace.size());
+    for(uint64_t i = 0; i < end; i++) {
+        if(i >= job.begin) {
+            const cpu_log& expected = trace[i];
+            cpu_log actual = currentState(cpu, expected.cpsr & 0x00000020);
+            // cycles aren't compared, the cpu doesn't count them per instruction yet
+            if(memcmp(&expected, &actual, offsetof(cpu_log, cycles)) != 0) {
+                log << "FAIL " << job.name << "\n";
+                reportDivergence(log, trace, i, expected, actual);
+                result.checked = i - job.begin;
+                result.log = log.str();
+                return result;
+            }
+        }
+        cpu->step();
+    }
+    result.passed = true;
+    result.checked = end > job.begin ? end - job.begin : 0;
+    log << "PASS " << job.name << ": " << result.checked << " instructions\n";
+    result.log = log.str();
+    return result;
+}
+
+// runs all jobs across nThreads workers, prints the results in job order, returns the process exit code
+inline
+int runTraceJobs(std::vector<TraceJob> jobs, uint32_t nThreads) {
+    // conversion happens up front so shards of the same log don't race to convert it
+    for(TraceJob& job : jobs) {
+        std::string trace = prepareTrace(job.trace);
+        if(trace == "") {
+            std::cout << "FAIL " << job.name << ": could not convert " << job.trace << "\n";
+            return 1;
+        }
+        job.trace = trace;
+    }
+
+    std::vector<TraceResult> results(jobs.size());
+    std::atomic<size_t> nextJob = {0};
+    std::vector<std::thread> workers;
+    for(uint32_t i = 0; i < std::min<size_t>(std::max(1u, nThreads), jobs.size()); i++) {
+        workers.emplace_back([&]() {
+            for(size_t index = nextJob++; index < jobs.size(); index = nextJob++) {
+                results[index] = verifyTrace(jobs[index]);
+            }
+        });
+    }
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+
+    bool passed = true;
+    for(const TraceResult& result : results) {
+        std::cout << result.log;
+        passed &= result.passed;
+    }
+    return passed ? 0 : 1;
+}
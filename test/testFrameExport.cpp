@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../src/FrameExport.h"
+#include "../src/ColourLut.h"
+#include "../src/PPU.h"
+
+/*
+    Frame export reader test: a reader thread maps the ring through its own shm_open/mmap, like another process
+    would, checks the header layout and reads frames with the seqlock and futex protocol documented in
+    FrameExport.h while the writer publishes frames filled with a single colour per frame. Fails if a frame that
+    passed the seqlock check is torn, if a wake up is lost (the reader waits a second while latestFrame has moved
+    on) or if the reader doesn't end on the last frame.
+
+    usage: gba_test_frame_export
+*/
+
+static const uint32_t FRAMES = 300;
+static const uint32_t SLOTS = 3;
+
+uint16_t frameColour(uint64_t frame) {
+    return (uint16_t)((frame * 0x1234) & 0x7FFF);
+}
+
+struct ReaderResult {
+    // set once the reader has mapped the ring, or failed to
+    std::atomic<bool> ready = {false};
+    bool passed = true;
+    uint64_t framesRead = 0;
+    uint64_t framesDiscarded = 0;
+    uint64_t lastFrame = 0;
+};
+
+bool fail(ReaderResult& result, std::string message) {
+    std::cout << "    " << message << "\n";
+    result.passed = false;
+    return false;
+}
+
+bool checkLayout(const FrameExport::Header* header, size_t size, ReaderResult& result) {
+    uint32_t bytesPerPixel = ColourLut::bytesPerPixel(ColourLut::RGBA8888);
+    uint32_t pixelBytes = PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT * bytesPerPixel;
+    if(header->version != FrameExport::VERSION) {
+        return fail(result, "wrong version " + std::to_string(header->version));
+    }
+    if(header->slotCount != SLOTS || header->width != PPU::SCREEN_WIDTH || header->height != PPU::SCREEN_HEIGHT ||
+       header->bytesPerPixel != bytesPerPixel || header->format != ColourLut::RGBA8888) {
+        return fail(result, "wrong slot count, dimensions or format");
+    }
+    if(header->slotSize < FrameExport::SLOT_HEADER_SIZE + pixelBytes || header->slotSize % 64 != 0) {
+        return fail(result, "slot size " + std::to_string(header->slotSize) + " can't hold a frame");
+    }
+    if(size < FrameExport::HEADER_SIZE + (size_t)header->slotSize * header->slotCount) {
+        return fail(result, "shared memory smaller than the slots");
+    }
+    return true;
+}
+
+void readFrames(std::string name, ReaderResult& result) {
+    int fd = -1;
+    auto start = std::chrono::steady_clock::now();
+    while((fd = shm_open(name.c_str(), O_RDWR, 0)) < 0) {
+        if(std::chrono::steady_clock::now() - start > std::chrono::seconds(5)) {
+            fail(result, "could not open " + name);
+            result.ready = true;
+            return;
+        }
+        std::this_thread::yield();
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size_t size = info.st_size;
+    uint8_t* memory = (uint8_t*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    result.ready = true;
+    if(memory == MAP_FAILED) {
+        fail(result, "could not map " + name);
+        return;
+    }
+    FrameExport::Header* header = (FrameExport::Header*)memory;
+    while(memcmp(header->magic, FrameExport::MAGIC, sizeof(FrameExport::MAGIC)) != 0) {
+        std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    ColourLut colourLut;
+    colourLut.configure(ColourLut::RGBA8888, false);
+    const size_t pixels = header->width * header->height;
+    std::vector<uint32_t> copy(pixels);
+
+    if(checkLayout(header, size, result)) {
+        while(true) {
+            // the protocol from FrameExport.h
+            header->waiters.fetch_add(1, std::memory_order_seq_cst);
+            uint32_t word = header->futexWord.load(std::memory_order_seq_cst);
+            uint64_t latest = header->latestFrame.load(std::memory_order_acquire);
+            bool closed = header->closed.load(std::memory_order_acquire);
+            if(latest == result.lastFrame && !closed) {
+                struct timespec timeout = {1, 0};
+                long woken = syscall(SYS_futex, (uint32_t*)&header->futexWord, FUTEX_WAIT, word, &timeout,
+                                     nullptr, 0);
+                if(woken != 0 && errno == ETIMEDOUT &&
+                   header->latestFrame.load(std::memory_order_acquire) != result.lastFrame) {
+                    header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+                    fail(result, "wake up lost after frame " + std::to_string(result.lastFrame));
+                    break;
+                }
+            }
+            header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+            latest = header->latestFrame.load(std::memory_order_acquire);
+            if(latest != result.lastFrame) {
+                FrameExport::SlotHeader* slot = (FrameExport::SlotHeader*)(memory + FrameExport::HEADER_SIZE +
+                                                (size_t)(latest % header->slotCount) * header->slotSize);
+                uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+                memcpy(copy.data(), (uint8_t*)slot + FrameExport::SLOT_HEADER_SIZE, pixels * 4);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(sequence != latest * 2 || slot->sequence.load(std::memory_order_relaxed) != sequence) {
+                    // overwritten while reading
+                    result.framesDiscarded++;
+                } else {
+                    uint32_t expected = colourLut.lookup(frameColour(latest));
+                    for(size_t i = 0; i < pixels; i++) {
+                        if(copy[i] != expected) {
+                            fail(result, "frame " + std::to_string(latest) + " torn at pixel " + std::to_string(i));
+                            break;
+                        }
+                    }
+                    result.framesRead++;
+                }
+                result.lastFrame = latest;
+            } else if(closed) {
+                break;
+            }
+        }
+    }
+    munmap(memory, size);
+}
+
+int main() {
+    std::string name = "/gba-test-frames-" + std::to_string(getpid());
+    FrameExport frameExport;
+    if(!frameExport.start(name, SLOTS, ColourLut::RGBA8888)) {
+        std::cout << "FAIL could not start the export\n";
+        return 1;
+    }
+
+    ReaderResult result;
+    std::thread reader(readFrames, name, std::ref(result));
+    // the reader keeps its mapping after stop() unlinks the object, but it has to open it before
+    while(!result.ready) {
+        std::this_thread::yield();
+    }
+    std::vector<uint16_t> frame(PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT);
+    for(uint64_t i = 1; i <= FRAMES; i++) {
+        std::fill(frame.begin(), frame.end(), frameColour(i));
+        frameExport.publish(frame.data(), PPU::SCREEN_WIDTH, PPU::SCREEN_HEIGHT);
+        // bursts without pauses overwrite slots under the reader, the pauses let it block on the futex
+        if(i % 8 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    frameExport.stop();
+    reader.join();
+
+    if(result.passed && result.lastFrame != FRAMES) {
+        std::cout << "    reader stopped at frame " << result.lastFrame << " of " << FRAMES << "\n";
+        result.passed = false;
+    }
+    std::cout << (result.passed ? "PASS " : "FAIL ") << "frame export: " << result.framesRead << " frames read, "
+              << result.framesDiscarded << " overwritten while reading\n";
+    return result.passed ? 0 : 1;
+}
@@ -0,0 +1,399 @@
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/arm7tdmi/ARM7TDMI.h"
+#include "../src/memory/Bus.h"
+#include "../src/GameBoyAdvanceImpl.h"
+#include "../src/PPU.h"
+#include "../bench/workloads.h"
+
+/*
+    Framebuffer hash regression tests.
+
+    usage: gba_test_framebuffer <manifest> [--jobs <n>] [--artifacts <dir>] [--reference <dir>] [--update]
+
+    Every manifest line is a case: <name> <rom> <movie> <frame>=<hash> ...
+    - rom is a path, or builtin:<workload> for one of the generated workloads in bench/workloads.h
+    - movie is a path or "-" for no input. Every movie line is "<frame> <keys>", keys in KEYINPUT format (hex),
+      applied from that frame on
+    - hash is the 64 bit FNV-1a hash of PPU::pixelBuffer after that frame (frames start at 1)
+
+    Cases run headless, in parallel across --jobs threads (default: all cores). The reference directory holds the
+    expected frames as raw PPU::pixelBuffer dumps, <name>_<frame>.raw (test/framebuffer_reference, next to the
+    manifest). On a mismatch <artifacts>/<name>_<frame>_actual.png, _expected.png and _diff.png are written.
+    --update rewrites the manifest with the current hashes, and the reference frames when --reference is given.
+*/
+
+struct Checkpoint {
+    uint64_t frame;
+    uint64_t hash;
+};
+
+struct Case {
+    std::string name;
+    std::string rom;
+    std::string movie;
+    std::vector<Checkpoint> checkpoints;
+};
+
+struct CaseResult {
+    bool passed = true;
+    std::string log;
+    std::vector<Checkpoint> actual;
+};
+
+typedef std::array<uint16_t, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT> Frame;
+
+uint64_t hashFrame(const Frame& frame) {
+    uint64_t hash = 0xCBF29CE484222325;
+    for(uint16_t pixel : frame) {
+        hash = (hash ^ (pixel & 0xFF)) * 0x100000001B3;
+        hash = (hash ^ (pixel >> 8)) * 0x100000001B3;
+    }
+    return hash;
+}
+
+/* PNG output, uncompressed (stored deflate blocks) so no zlib is needed */
+
+uint32_t crc32(const std::vector<uint8_t>& data, size_t start) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> table = {};
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for(int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+    uint32_t crc = 0xFFFFFFFF;
+    for(size_t i = start; i < data.size(); i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+void appendBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+void appendChunk(std::vector<uint8_t>& out, std::string type, const std::vector<uint8_t>& data) {
+    appendBigEndian32(out, data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type.begin(), type.end());
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian32(out, crc32(out, start));
+}
+
+// rgb: 3 bytes per pixel, SCREEN_WIDTH x SCREEN_HEIGHT
+bool writePng(std::string path, const std::vector<uint8_t>& rgb) {
+    uint32_t width = PPU::SCREEN_WIDTH;
+    uint32_t height = PPU::SCREEN_HEIGHT;
+
+    std::vector<uint8_t> raw;
+    for(uint32_t y = 0; y < height; y++) {
+        // filter type none
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + y * width * 3, rgb.begin() + (y + 1) * width * 3);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for(size_t offset = 0; offset < raw.size(); offset += 0xFFFF) {
+        uint16_t length = std::min<size_t>(0xFFFF, raw.size() - offset);
+        zlib.push_back((offset + length == raw.size()) ? 1 : 0);
+        zlib.push_back(length & 0xFF);
+        zlib.push_back(length >> 8);
+        zlib.push_back(~length & 0xFF);
+        zlib.push_back((~length >> 8) & 0xFF);
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+    }
+    uint32_t a = 1, b = 0;
+    for(uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian32(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    appendBigEndian32(header, width);
+    appendBigEndian32(header, height);
+    // 8 bit depth, truecolour, default compression, filter and no interlace
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)png.data(), png.size());
+    return file.good();
+}
+
+std::vector<uint8_t> frameToRgb(const Frame& frame) {
+    std::vector<uint8_t> rgb;
+    for(uint16_t pixel : frame) {
+        rgb.push_back(((pixel & 0x1F) << 3) | ((pixel & 0x1F) >> 2));
+        rgb.push_back((((pixel >> 5) & 0x1F) << 3) | (((pixel >> 5) & 0x1F) >> 2));
+        rgb.push_back((((pixel >> 10) & 0x1F) << 3) | (((pixel >> 10) & 0x1F) >> 2));
+    }
+    return rgb;
+}
+
+// differing pixels are red, everything else is the expected frame dimmed
+std::vector<uint8_t> diffToRgb(const Frame& expected, const Frame& actual) {
+    std::vector<uint8_t> rgb = frameToRgb(expected);
+    for(size_t i = 0; i < actual.size(); i++) {
+        if(expected[i] != actual[i]) {
+            rgb[i * 3] = 0xFF;
+            rgb[i * 3 + 1] = 0;
+            rgb[i * 3 + 2] = 0;
+        } else {
+            rgb[i * 3] /= 4;
+            rgb[i * 3 + 1] /= 4;
+            rgb[i * 3 + 2] /= 4;
+        }
+    }
+    return rgb;
+}
+
+bool readFrame(std::string path, Frame& frame) {
+    std::ifstream file(path, std::ios::binary);
+    file.read((char*)frame.data(), frame.size() * sizeof(uint16_t));
+    return file.good();
+}
+
+void writeFrame(std::string path, const Frame& frame) {
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)frame.data(), frame.size() * sizeof(uint16_t));
+}
+
+/* manifest */
+
+std::string hashToString(uint64_t hash) {
+    std::stringstream stream;
+    stream << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return stream.str();
+}
+
+std::vector<Case> readManifest(std::string path, std::vector<std::string>& lines) {
+    std::vector<Case> cases;
+    std::ifstream file(path);
+    std::string line;
+    while(std::getline(file, line)) {
+        lines.push_back(line);
+        std::stringstream stream(line);
+        Case testCase;
+        if(line.empty() || line[0] == '#' || !(stream >> testCase.name >> testCase.rom >> testCase.movie)) {
+            continue;
+        }
+        std::string checkpoint;
+        while(stream >> checkpoint) {
+            size_t separator = checkpoint.find('=');
+            Checkpoint parsed = {std::stoull(checkpoint.substr(0, separator)), 0};
+            if(separator != std::string::npos) {
+                parsed.hash = std::stoull(checkpoint.substr(separator + 1), nullptr, 16);
+            }
+            testCase.checkpoints.push_back(parsed);
+        }
+        std::sort(testCase.checkpoints.begin(), testCase.checkpoints.end(),
+                  [](const Checkpoint& a, const Checkpoint& b) { return a.frame < b.frame; });
+        cases.push_back(testCase);
+    }
+    return cases;
+}
+
+void writeManifest(std::string path, const std::vector<std::string>& lines, const std::vector<Case>& cases,
+                   const std::vector<CaseResult>& results) {
+    std::ofstream file(path);
+    size_t caseIndex = 0;
+    for(const std::string& line : lines) {
+        std::stringstream stream(line);
+        std::string name;
+        if(line.empty() || line[0] == '#' || !(stream >> name) || caseIndex >= cases.size() || name != cases[caseIndex].name) {
+            file << line << "\n";
+            continue;
+        }
+        const Case& testCase = cases[caseIndex];
+        // the columns of the header comment
+        file << std::left << std::setw(11) << testCase.name << " " << std::setw(19) << testCase.rom << " "
+             << std::setw(7) << testCase.movie;
+        for(const Checkpoint& checkpoint : results[caseIndex].actual) {
+            file << " " << checkpoint.frame << "=" << hashToString(checkpoint.hash);
+        }
+        file << "\n";
+        caseIndex++;
+    }
+}
+
+std::map<uint64_t, uint16_t> readMovie(std::string path) {
+    std::map<uint64_t, uint16_t> movie;
+    std::ifstream file(path);
+    uint64_t frame;
+    std::string keys;
+    while(file >> frame >> keys) {
+        movie[frame] = std::stoul(keys, nullptr, 16);
+    }
+    return movie;
+}
+
+/* running */
+
+CaseResult runCase(const Case& testCase, std::string artifacts, std::string reference, bool update) {
+    CaseResult result;
+    std::stringstream log;
+
+    GameBoyAdvanceImpl gba;
+    GameBoyAdvanceImpl::cyclesSinceStart = 0;
+    std::string builtinPrefix = "builtin:";
+    if(testCase.rom.rfind(builtinPrefix, 0) == 0) {
+        std::vector<uint8_t> rom = workloads::build(testCase.rom.substr(builtinPrefix.size()));
+        if(rom.empty()) {
+            result.passed = false;
+            result.log = "FAIL " + testCase.name + ": unknown workload " + testCase.rom + "\n";
+            return result;
+        }
+        gba.loadRom(rom);
+    } else if(!gba.loadRom(testCase.rom)) {
+        result.passed = false;
+        result.log = "FAIL " + testCase.name + ": could not load " + testCase.rom + "\n";
+        return result;
+    }
+    gba.setHeadless(true);
+
+    std::map<uint64_t, uint16_t> movie;
+    if(testCase.movie != "-") {
+        movie = readMovie(testCase.movie);
+    }
+
+    uint64_t frame = 0;
+    for(const Checkpoint& checkpoint : testCase.checkpoints) {
+        while(frame < checkpoint.frame) {
+            frame++;
+            if(movie.find(frame) != movie.end()) {
+                gba.setKeyState(movie[frame]);
+            }
+            gba.runFrame();
+        }
+
+        const Frame& pixels = gba.getPpu()->pixelBuffer;
+        uint64_t hash = hashFrame(pixels);
+        result.actual.push_back({frame, hash});
+        std::string frameName = testCase.name + "_" + std::to_string(frame);
+
+        if(update) {
+            if(reference != "") {
+                writeFrame(reference + "/" + frameName + ".raw", pixels);
+            }
+            continue;
+        }
+        if(hash == checkpoint.hash) {
+            continue;
+        }
+
+        result.passed = false;
+        log << "FAIL " << testCase.name << " frame " << frame << ": expected " << hashToString(checkpoint.hash)
+            << " actual " << hashToString(hash) << "\n";
+        std::string prefix = artifacts + "/" + frameName;
+        if(!writePng(prefix + "_actual.png", frameToRgb(pixels))) {
+            log << "    could not write " << prefix << "_actual.png\n";
+            continue;
+        }
+        Frame expected;
+        if(reference == "" || !readFrame(reference + "/" + frameName + ".raw", expected)) {
+            log << "    wrote " << prefix << "_actual.png, no reference frame " << reference << "/" << frameName
+                << ".raw\n";
+            continue;
+        }
+        if(hashFrame(expected) != checkpoint.hash) {
+            log << "    reference frame " << reference << "/" << frameName << ".raw doesn't match the manifest hash\n";
+        }
+        writePng(prefix + "_expected.png", frameToRgb(expected));
+        writePng(prefix + "_diff.png", diffToRgb(expected, pixels));
+        log << "    wrote " << prefix << "_actual.png, _expected.png and _diff.png\n";
+    }
+
+    if(result.passed) {
+        log << (update ? "UPDATED " : "PASS ") << testCase.name << "\n";
+    }
+    result.log = log.str();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::string manifestPath = "";
+    std::string artifacts = ".";
+    std::string reference = "";
+    bool update = false;
+    uint32_t jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(i + 1 < argc && arg == "--jobs") {
+            jobs = std::max(1, std::stoi(argv[++i]));
+        } else if(i + 1 < argc && arg == "--artifacts") {
+            artifacts = argv[++i];
+        } else if(i + 1 < argc && arg == "--reference") {
+            reference = argv[++i];
+        } else if(arg == "--update") {
+            update = true;
+        } else if(manifestPath == "" && arg.rfind("--", 0) != 0) {
+            manifestPath = arg;
+        } else {
+            manifestPath = "";
+            break;
+        }
+    }
+    if(manifestPath == "") {
+        std::cerr << "usage: gba_test_framebuffer <manifest> [--jobs <n>] [--artifacts <dir>] [--reference <dir>] [--update]\n";
+        return 2;
+    }
+
+    std::vector<std::string> lines;
+    std::vector<Case> cases = readManifest(manifestPath, lines);
+    if(cases.empty()) {
+        std::cerr << "no cases in " << manifestPath << "\n";
+        return 2;
+    }
+
+    // every case gets its own machine, workers take the next case until all are done
+    std::vector<CaseResult> results(cases.size());
+    std::atomic<size_t> nextCase = {0};
+    std::vector<std::thread> workers;
+    for(uint32_t i = 0; i < std::min<size_t>(jobs, cases.size()); i++) {
+        workers.emplace_back([&]() {
+            for(size_t index = nextCase++; index < cases.size(); index = nextCase++) {
+                results[index] = runCase(cases[index], artifacts, reference, update);
+            }
+        });
+    }
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+
+    uint32_t failed = 0;
+    for(const CaseResult& result : results) {
+        std::cout << result.log;
+        failed += !result.passed;
+    }
+
+    if(update) {
+        writeManifest(manifestPath, lines, cases, results);
+        return 0;
+    }
+    std::cout << (cases.size() - failed) << "/" << cases.size() << " framebuffer cases passed\n";
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/GameBoyAdvanceImpl.h"
+#include "../src/LinkCable.h"
+#include "../src/memory/Bus.h"
+#include "../bench/workloads.h"
+
+/*
+    Link cable test: two instances linked in-process, each running on its own thread, exchange data in Normal 8bit,
+    Normal 32bit and Multiplayer mode. Every transfer is run with either instance starting late by more than the
+    time it takes to emulate the whole test, transfers must complete no matter how the threads are scheduled.
+
+    usage: gba_test_link
+*/
+
+struct Transfer {
+    std::string name;
+    // SIOCNT of the master (start bit added once both sides are set up) and of the slave
+    uint16_t masterControl;
+    uint16_t slaveControl;
+    bool data32;
+    uint32_t masterData;
+    uint32_t slaveData;
+    // expected words at SIODATA32/SIOMULTI0, SIOMULTI2 and SIOCNT/SIODATA8 after the transfer
+    uint32_t masterResult[3];
+    uint32_t slaveResult[3];
+    // only compare the bytes of the data registers
+    uint32_t masks[3];
+};
+
+/*
+    Writes the outgoing data and SIOCNT, waits for a vblank so the other side is set up too, starts the transfer
+    (master only) and waits for the serial irq in IF (IME off). Then copies 4000120h-400012Bh to 2000000h
+*/
+std::vector<uint8_t> buildRom(const Transfer& transfer, bool master) {
+    workloads::RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+    rom.loadImmediate(10, 0x04000200);
+    rom.loadImmediate(9, 0x04000100);
+    rom.loadImmediate(0, master ? transfer.masterData : transfer.slaveData);
+    if(transfer.data32) {
+        rom.loadImmediate(1, 0x04000120);
+        rom.storeWordPostIncrement(0, 1);
+    } else {
+        rom.storeHalf(0, 9, 0x2A);
+    }
+    uint16_t control = master ? transfer.masterControl : transfer.slaveControl;
+    rom.loadImmediate(0, control);
+    rom.storeHalf(0, 9, 0x28);
+    rom.waitForVBlank();
+    if(master) {
+        rom.loadImmediate(0, control | 0x80);
+        rom.storeHalf(0, 9, 0x28);
+    }
+    uint32_t wait = rom.here();
+    rom.loadHalf(11, 10, 0x02);
+    rom.andImmediate(11, 11, 0x80);
+    rom.cmpImmediate(11, 0);
+    rom.branch(workloads::RomBuilder::EQ, wait);
+
+    rom.loadImmediate(0, 0x02000000);
+    rom.loadImmediate(1, 0x04000120);
+    for(uint16_t offset = 0; offset < 12; offset += 4) {
+        rom.loadWord(2, 1, offset);
+        rom.storeWordPostIncrement(2, 0);
+    }
+    uint32_t done = rom.here();
+    rom.branch(workloads::RomBuilder::AL, done);
+    return rom.build();
+}
+
+void runInstance(GameBoyAdvanceImpl* gba, uint32_t frames, uint32_t delayMilliseconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(delayMilliseconds));
+    GameBoyAdvanceImpl::cyclesSinceStart = 0;
+    for(uint32_t i = 0; i < frames; i++) {
+        gba->runFrame();
+    }
+}
+
+bool checkResult(std::string side, Bus* bus, const uint32_t* expected, const uint32_t* masks) {
+    bool passed = true;
+    for(uint32_t i = 0; i < 3; i++) {
+        uint32_t actual = bus->view32(0x02000000 + i * 4) & masks[i];
+        if(actual != (expected[i] & masks[i])) {
+            std::cout << "    " << side << " word " << i << ": expected " << std::hex << std::setfill('0')
+                      << std::setw(8) << (expected[i] & masks[i]) << ", got " << std::setw(8) << actual
+                      << std::dec << std::setfill(' ') << "\n";
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+bool runTransfer(const Transfer& transfer, uint32_t masterDelay, uint32_t slaveDelay) {
+    std::vector<uint8_t> masterRom = buildRom(transfer, true);
+    std::vector<uint8_t> slaveRom = buildRom(transfer, false);
+    // the master attaches first and is player 0 (the multiplayer parent)
+    GameBoyAdvanceImpl master;
+    GameBoyAdvanceImpl slave;
+    master.loadRom(masterRom);
+    slave.loadRom(slaveRom);
+    master.setHeadless(true);
+    slave.setHeadless(true);
+    if(!slave.connectLinkCable(master.getLinkCable())) {
+        std::cout << "FAIL " << transfer.name << ": could not link the instances\n";
+        return false;
+    }
+
+    const uint32_t frames = 4;
+    std::thread masterThread(runInstance, &master, frames, masterDelay);
+    std::thread slaveThread(runInstance, &slave, frames, slaveDelay);
+    masterThread.join();
+    slaveThread.join();
+
+    bool passed = checkResult("master", master.getBus(), transfer.masterResult, transfer.masks);
+    passed &= checkResult("slave", slave.getBus(), transfer.slaveResult, transfer.masks);
+    std::cout << (passed ? "PASS " : "FAIL ") << transfer.name << ", " << (masterDelay ? "master" : "slave")
+              << " starting late\n";
+    return passed;
+}
+
+int main() {
+    // SIOCNT: bit 0 internal clock, bit 14 irq, bits 12-13 mode (multiplayer: bits 0-1 baud rate)
+    const std::vector<Transfer> transfers = {
+        {"normal 8bit", 0x4001, 0x4080, false, 0x5A, 0xA5,
+         {0, 0, 0xA5 << 16}, {0, 0, 0x5A << 16}, {0, 0, 0x00FF0000}},
+        {"normal 32bit", 0x5001, 0x5080, true, 0x12345678, 0xCAFEBABE,
+         {0xCAFEBABE, 0, 0}, {0x12345678, 0, 0}, {0xFFFFFFFF, 0, 0}},
+        {"multiplayer", 0x6003, 0x6003, false, 0x1111, 0x2222,
+         {0x22221111, 0xFFFFFFFF, 0}, {0x22221111, 0xFFFFFFFF, 0}, {0xFFFFFFFF, 0xFFFFFFFF, 0}},
+    };
+
+    bool passed = true;
+    for(const Transfer& transfer : transfers) {
+        passed &= runTransfer(transfer, 200, 0);
+        passed &= runTransfer(transfer, 0, 200);
+    }
+    return passed ? 0 : 1;
+}
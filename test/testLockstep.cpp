@@ -0,0 +1,210 @@
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/arm7tdmi/ARM7TDMI.h"
+#include "../src/memory/Bus.h"
+#include "../src/GameBoyAdvanceImpl.h"
+#include "../src/PPU.h"
+#include "../bench/workloads.h"
+
+/*
+    Lockstep differential test: fast paths against the reference behaviour.
+
+    usage: gba_test_lockstep [--interval <n>] [--instructions <n>] <rom> ...
+
+    rom is a path, or builtin:<workload> for one of the generated workloads in bench/workloads.h.
+    Every rom runs on two headless machines, one with all GameBoyAdvanceImpl::FastPaths disabled (the reference) and
+    one with all of them enabled and rendering on 4 threads. Both are advanced in lockstep and every --interval
+    instructions (default 1000) their registers, CPSR, cycle count, a hash of every memory region and of the last
+    completed frame are compared. On a mismatch both machines are replayed up to the last matching checkpoint and
+    single stepped to find the first diverging instruction, which is reported with both states.
+*/
+
+struct Machine {
+    std::unique_ptr<GameBoyAdvanceImpl> gba;
+    // both machines run on this thread, each keeps its own copy of the thread local cycle counter
+    uint64_t cycles = 0;
+};
+
+struct State {
+    uint32_t r[16];
+    uint32_t cpsr;
+    uint64_t cycles;
+    // the last element is the last completed frame
+    uint64_t memory[7];
+};
+
+static const char* MEMORY_REGIONS[7] = {"ewram", "iwram", "io", "palette", "vram", "oam", "frame"};
+
+uint64_t hashMemory(const uint8_t* memory, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ memory[i]) * 0x100000001B3;
+    }
+    return hash;
+}
+
+uint64_t hashMemory(const std::vector<uint8_t>& memory) {
+    return hashMemory(memory.data(), memory.size());
+}
+
+bool createMachine(Machine& machine, std::string rom, bool fastPaths) {
+    GameBoyAdvanceImpl::cyclesSinceStart = 0;
+    machine.gba = std::make_unique<GameBoyAdvanceImpl>();
+    machine.cycles = 0;
+    std::string builtinPrefix = "builtin:";
+    if(rom.rfind(builtinPrefix, 0) == 0) {
+        std::vector<uint8_t> buffer = workloads::build(rom.substr(builtinPrefix.size()));
+        if(buffer.empty()) {
+            return false;
+        }
+        machine.gba->loadRom(buffer);
+    } else if(!machine.gba->loadRom(rom)) {
+        return false;
+    }
+    machine.gba->setHeadless(true);
+
+    GameBoyAdvanceImpl::FastPaths paths;
+    if(!fastPaths) {
+        memset(&paths, 0, sizeof(paths));
+    } else {
+        machine.gba->setRenderThreads(4);
+    }
+    machine.gba->setFastPaths(paths);
+    return true;
+}
+
+void advance(Machine& machine, uint64_t instructions) {
+    GameBoyAdvanceImpl::cyclesSinceStart = machine.cycles;
+    machine.gba->runInstructions(instructions);
+    machine.cycles = GameBoyAdvanceImpl::cyclesSinceStart;
+}
+
+State captureState(Machine& machine) {
+    State state;
+    ARM7TDMI* cpu = machine.gba->getCpu();
+    Bus* bus = machine.gba->getBus();
+    for(int i = 0; i < 16; i++) {
+        state.r[i] = cpu->getRegister(i);
+    }
+    state.cpsr = cpu->psrToInt(cpu->getCpsr());
+    state.cycles = machine.cycles;
+    state.memory[0] = hashMemory(bus->wRamBoard);
+    state.memory[1] = hashMemory(bus->wRamChip);
+    state.memory[2] = hashMemory(bus->iORegisters);
+    state.memory[3] = hashMemory(bus->paletteRam);
+    state.memory[4] = hashMemory(bus->vRam);
+    state.memory[5] = hashMemory(bus->objAttributes);
+    std::array<uint16_t, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT>& frame = machine.gba->getPpu()->pixelBuffer;
+    state.memory[6] = hashMemory((const uint8_t*)frame.data(), frame.size() * sizeof(uint16_t));
+    return state;
+}
+
+bool sameState(const State& a, const State& b) {
+    return memcmp(a.r, b.r, sizeof(a.r)) == 0 &&
+           a.cpsr == b.cpsr &&
+           a.cycles == b.cycles &&
+           memcmp(a.memory, b.memory, sizeof(a.memory)) == 0;
+}
+
+void printStates(std::ostream& out, const State& reference, const State& fast) {
+    out << std::hex << std::setfill('0');
+    out << "    " << std::setw(10) << std::setfill(' ') << "" << "  reference         fast\n" << std::setfill('0');
+    for(int i = 0; i < 17; i++) {
+        uint32_t expected = (i < 16) ? reference.r[i] : reference.cpsr;
+        uint32_t actual = (i < 16) ? fast.r[i] : fast.cpsr;
+        std::string name = (i < 16) ? "r" + std::to_string(i) : "cpsr";
+        out << "    " << std::setw(10) << std::setfill(' ') << name << std::setfill('0')
+            << "  " << std::setw(8) << expected << "          " << std::setw(8) << actual
+            << (expected != actual ? "  <--" : "") << "\n";
+    }
+    out << std::dec << std::setfill(' ');
+    out << "    " << std::setw(10) << "cycles" << "  " << std::setw(16) << std::left << reference.cycles
+        << "  " << std::setw(16) << fast.cycles << std::right << (reference.cycles != fast.cycles ? "  <--" : "") << "\n";
+    for(int i = 0; i < 7; i++) {
+        if(reference.memory[i] != fast.memory[i]) {
+            out << "    " << std::setw(10) << MEMORY_REGIONS[i] << "  contents differ\n";
+        }
+    }
+}
+
+// replays both machines to the last matching checkpoint and single steps to the first diverging instruction
+void reportDivergence(std::ostream& out, std::string rom, uint64_t lastMatch, uint64_t interval) {
+    Machine reference;
+    Machine fast;
+    createMachine(reference, rom, false);
+    createMachine(fast, rom, true);
+    if(lastMatch > 0) {
+        advance(reference, lastMatch);
+        advance(fast, lastMatch);
+    }
+    for(uint64_t i = 0; i < interval; i++) {
+        advance(reference, 1);
+        advance(fast, 1);
+        State referenceState = captureState(reference);
+        State fastState = captureState(fast);
+        if(!sameState(referenceState, fastState)) {
+            out << "    first divergence after instruction " << lastMatch + i + 1 << "\n";
+            printStates(out, referenceState, fastState);
+            return;
+        }
+    }
+    out << "    could not reproduce the divergence by single stepping\n";
+}
+
+bool runLockstep(std::string rom, uint64_t interval, uint64_t instructions) {
+    Machine reference;
+    Machine fast;
+    if(!createMachine(reference, rom, false) || !createMachine(fast, rom, true)) {
+        std::cout << "FAIL " << rom << ": could not load rom\n";
+        return false;
+    }
+
+    for(uint64_t executed = 0; executed < instructions; executed += interval) {
+        advance(reference, interval);
+        advance(fast, interval);
+        if(!sameState(captureState(reference), captureState(fast))) {
+            std::cout << "FAIL " << rom << "\n";
+            reportDivergence(std::cout, rom, executed, interval);
+            return false;
+        }
+    }
+    std::cout << "PASS " << rom << ": " << instructions << " instructions\n";
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint64_t interval = 1000;
+    uint64_t instructions = 1000000;
+    std::vector<std::string> roms;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(i + 1 < argc && arg == "--interval") {
+            interval = std::max(1ull, std::stoull(argv[++i]));
+        } else if(i + 1 < argc && arg == "--instructions") {
+            instructions = std::stoull(argv[++i]);
+        } else if(arg.rfind("--", 0) != 0) {
+            roms.push_back(arg);
+        } else {
+            roms.clear();
+            break;
+        }
+    }
+    if(roms.empty()) {
+        std::cerr << "usage: gba_test_lockstep [--interval <n>] [--instructions <n>] <rom> ...\n";
+        return 2;
+    }
+
+    bool passed = true;
+    for(std::string rom : roms) {
+        passed &= runLockstep(rom, interval, instructions);
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/GameBoyAdvanceImpl.h"
+#include "../src/RamSearch.h"
+#include "../src/memory/Bus.h"
+
+/*
+    Ram search test: runs the same searches with every filter kernel the cpu supports (AVX2, SSE2, scalar) over
+    random work ram that changes between filters, and checks the count and the candidate list after every filter
+    against a naive search that compares one value at a time. Covers every width, signed and unsigned values,
+    every comparison and filters against the snapshot and against constants.
+
+    usage: gba_test_ram_search
+*/
+
+static const uint32_t RAM_SIZE = RamSearch::EWRAM_SIZE + RamSearch::IWRAM_SIZE;
+
+uint8_t& ramByte(Bus* bus, uint32_t offset) {
+    return offset < RamSearch::EWRAM_SIZE ? bus->wRamBoard[offset] : bus->wRamChip[offset - RamSearch::EWRAM_SIZE];
+}
+
+int64_t readValue(const uint8_t* bytes, uint32_t width, bool isSigned) {
+    uint32_t value = 0;
+    for(uint32_t byte = 0; byte < width; byte++) {
+        value |= (uint32_t)bytes[byte] << (byte * 8);
+    }
+    if(isSigned) {
+        uint32_t shift = 32 - width * 8;
+        return (int32_t)(value << shift) >> shift;
+    }
+    return value;
+}
+
+bool compare(RamSearch::Comparison comparison, int64_t a, int64_t b) {
+    switch(comparison) {
+        case RamSearch::EQUAL: return a == b;
+        case RamSearch::NOT_EQUAL: return a != b;
+        case RamSearch::LESS: return a < b;
+        case RamSearch::LESS_OR_EQUAL: return a <= b;
+        case RamSearch::GREATER: return a > b;
+        default: return a >= b;
+    }
+}
+
+// one value per candidate, like the bitset of RamSearch
+struct NaiveSearch {
+    uint32_t width;
+    bool isSigned;
+    std::vector<bool> candidates;
+    std::vector<uint8_t> snapshot;
+
+    NaiveSearch(Bus* bus, uint32_t width, bool isSigned) : width(width), isSigned(isSigned),
+                                                            candidates(RAM_SIZE / width, true) {
+        takeSnapshot(bus);
+    }
+
+    void takeSnapshot(Bus* bus) {
+        snapshot.resize(RAM_SIZE);
+        for(uint32_t offset = 0; offset < RAM_SIZE; offset++) {
+            snapshot[offset] = ramByte(bus, offset);
+        }
+    }
+
+    // constant is null to compare to the snapshot
+    size_t filter(Bus* bus, RamSearch::Comparison comparison, const uint8_t* constant) {
+        size_t count = 0;
+        for(uint32_t i = 0; i < candidates.size(); i++) {
+            if(!candidates[i]) {
+                continue;
+            }
+            uint32_t offset = i * width;
+            uint8_t current[4];
+            for(uint32_t byte = 0; byte < width; byte++) {
+                current[byte] = ramByte(bus, offset + byte);
+            }
+            int64_t reference = readValue(constant != nullptr ? constant : &snapshot[offset], width, isSigned);
+            candidates[i] = compare(comparison, readValue(current, width, isSigned), reference);
+            count += candidates[i];
+        }
+        takeSnapshot(bus);
+        return count;
+    }
+
+    uint32_t address(uint32_t i) {
+        uint32_t offset = i * width;
+        return offset < RamSearch::EWRAM_SIZE ? 0x02000000 + offset : 0x03000000 + offset - RamSearch::EWRAM_SIZE;
+    }
+};
+
+// some bytes drift by one (so increased/decreased/unchanged all keep candidates), some get random values
+void changeRam(Bus* bus, std::mt19937& random) {
+    for(uint32_t i = 0; i < 20000; i++) {
+        uint8_t& byte = ramByte(bus, random() % RAM_SIZE);
+        byte = random() % 3 == 0 ? (uint8_t)random() : (uint8_t)(byte + random() % 3 - 1);
+    }
+}
+
+bool run(GameBoyAdvanceImpl& gba, RamSearch::Kernel kernel, std::string name) {
+    Bus* bus = gba.getBus();
+    RamSearch* search = gba.getRamSearch();
+    search->setKernel(kernel);
+    // the same memory and filters for every kernel
+    std::mt19937 random(1);
+    uint32_t filters = 0;
+    for(uint32_t trial = 0; trial < 36; trial++) {
+        uint32_t width = (trial % 3 == 0) ? 1 : (trial % 3 == 1) ? 2 : 4;
+        bool isSigned = (trial / 3) % 2 == 1;
+        for(uint32_t offset = 0; offset < RAM_SIZE; offset++) {
+            // mostly small values near zero so that signed and unsigned comparisons differ
+            ramByte(bus, offset) = random() % 4 == 0 ? (uint8_t)random() : (uint8_t)(random() % 3 - 1);
+        }
+        search->reset(width, isSigned);
+        NaiveSearch naive(bus, width, isSigned);
+
+        for(uint32_t step = 0; step < 5; step++) {
+            changeRam(bus, random);
+            RamSearch::Comparison comparison = (RamSearch::Comparison)(random() % 6);
+            bool useValue = random() % 3 == 0;
+            uint32_t value = random() % 4 == 0 ? (uint32_t)random() : (uint32_t)(random() % 5) - 2;
+            uint8_t constant[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16),
+                                   (uint8_t)(value >> 24)};
+
+            size_t count = useValue ? search->filterValue(comparison, value) : search->filterPrevious(comparison);
+            size_t expected = naive.filter(bus, comparison, useValue ? constant : nullptr);
+            filters++;
+
+            std::vector<RamSearch::Candidate> list = search->getCandidates(RAM_SIZE);
+            bool match = count == expected && search->getCount() == expected && list.size() == expected;
+            size_t next = 0;
+            for(uint32_t i = 0; i < naive.candidates.size() && match; i++) {
+                if(naive.candidates[i]) {
+                    uint32_t offset = i * width;
+                    match = list[next].address == naive.address(i) &&
+                            list[next].value == (uint32_t)readValue(&naive.snapshot[offset], width, isSigned);
+                    next++;
+                }
+            }
+            if(!match) {
+                std::cout << "FAIL " << name << ": trial " << trial << " step " << step << ", width " << width
+                          << (isSigned ? " signed" : " unsigned") << ", comparison " << comparison
+                          << (useValue ? " to " + std::to_string(value) : " to the snapshot") << ": " << count
+                          << " candidates, expected " << expected << "\n";
+                return false;
+            }
+            if(expected == 0) {
+                break;
+            }
+        }
+    }
+    std::cout << "PASS " << name << ": " << filters << " filters\n";
+    return true;
+}
+
+int main() {
+    GameBoyAdvanceImpl gba;
+    bool passed = true;
+    struct {
+        RamSearch::Kernel kernel;
+        const char* name;
+    } kernels[] = {{RamSearch::AVX2, "avx2"}, {RamSearch::SSE2, "sse2"}, {RamSearch::SCALAR, "scalar"}};
+    for(auto& kernel : kernels) {
+        if(!RamSearch::isSupported(kernel.kernel)) {
+            std::cout << "SKIP " << kernel.name << ": not supported by this cpu\n";
+            continue;
+        }
+        passed &= run(gba, kernel.kernel, kernel.name);
+    }
+    return passed ? 0 : 1;
+}
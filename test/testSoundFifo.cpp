@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/GameBoyAdvanceImpl.h"
+#include "../src/arm7tdmi/ARM7TDMI.h"
+#include "../src/memory/Bus.h"
+#include "../bench/workloads.h"
+
+/*
+    Sound fifo refill test. Timer 0 clocks fifo A every 1024 cycles with its overflow irq flag enabled, DMA1 in
+    sound fifo mode refills it from a buffer in work ram holding 0, 1, 2, ... and raises its irq flag on every
+    refill. The rom counts the timer and DMA1 flags in IF (IME off, acknowledging them as it goes) and the test
+    checks, every few hundred instructions:
+    - the DMA1 irqs seen match the refills a byte per overflow fifo model predicts for the overflows seen
+    - FIFO_A holds the last word of the last refill, so the source address moved 16 bytes per refill
+    With the sound master enable off the timer still overflows but nothing is refilled.
+
+    usage: gba_test_sound_fifo
+*/
+
+static const uint32_t SOURCE = 0x02000000;
+static const uint32_t SOURCE_WORDS = 0x1000;
+
+// r4 = timer 0 overflows * 8, r5 = DMA1 irqs * 2
+std::vector<uint8_t> buildRom(bool masterEnable) {
+    workloads::RomBuilder rom;
+    rom.loadImmediate(12, 0x04000000);
+    rom.loadImmediate(10, 0x04000200);
+    rom.loadImmediate(9, 0x04000100);
+    rom.loadImmediate(8, 0x03000000);
+
+    // source buffer: word i = i
+    rom.loadImmediate(0, SOURCE);
+    rom.loadImmediate(2, 0);
+    rom.loadImmediate(3, SOURCE_WORDS);
+    uint32_t fill = rom.here();
+    rom.storeWordPostIncrement(2, 0);
+    rom.addImmediate(2, 2, 1);
+    rom.subsImmediate(3, 3, 1);
+    rom.branch(workloads::RomBuilder::NE, fill);
+
+    // SOUNDCNT_X: master enable, SOUNDCNT_H: fifo A on timer 0, reset fifo A
+    rom.loadImmediate(0, masterEnable ? 0x0080 : 0);
+    rom.storeHalf(0, 12, 0x84);
+    rom.loadImmediate(0, 0x0B04);
+    rom.storeHalf(0, 12, 0x82);
+    // DMA1SAD, DMA1DAD = FIFO_A, DMA1CNT_H: enabled, irq, special timing, 32 bit, repeat
+    rom.loadImmediate(0, SOURCE & 0xFFFF);
+    rom.storeHalf(0, 12, 0xBC);
+    rom.loadImmediate(0, SOURCE >> 16);
+    rom.storeHalf(0, 12, 0xBE);
+    rom.loadImmediate(0, 0x00A0);
+    rom.storeHalf(0, 12, 0xC0);
+    rom.loadImmediate(0, 0x0400);
+    rom.storeHalf(0, 12, 0xC2);
+    rom.loadImmediate(0, 0xF600);
+    rom.storeHalf(0, 12, 0xC6);
+    // TM0: 1024 cycles per overflow, irq, started
+    rom.loadImmediate(4, 0);
+    rom.loadImmediate(5, 0);
+    rom.loadImmediate(0, 0xFC00);
+    rom.storeHalf(0, 9, 0x00);
+    rom.loadImmediate(0, 0x00C0);
+    rom.storeHalf(0, 9, 0x02);
+
+    // acknowledge whatever is set in IF and count timer 0 (bit 3) and DMA1 (bit 9, via a copy in iwram)
+    uint32_t loop = rom.here();
+    rom.loadHalf(11, 10, 0x02);
+    rom.storeHalf(11, 10, 0x02);
+    rom.storeHalf(11, 8, 0x00);
+    rom.loadByte(1, 8, 0x01);
+    rom.andImmediate(1, 1, 0x02);
+    rom.add(5, 5, 1);
+    rom.andImmediate(1, 11, 0x08);
+    rom.add(4, 4, 1);
+    rom.branch(workloads::RomBuilder::AL, loop);
+    return rom.build();
+}
+
+// refills of a 32 byte fifo that plays a byte per overflow and is refilled with 16 bytes at 16 bytes or less
+uint64_t expectedRefills(uint64_t overflows) {
+    uint32_t level = 0;
+    uint64_t refills = 0;
+    for(uint64_t i = 0; i < overflows; i++) {
+        level = level > 0 ? level - 1 : 0;
+        if(level <= 16) {
+            level = std::min<uint32_t>(level + 16, 32);
+            refills++;
+        }
+    }
+    return refills;
+}
+
+bool run(std::string name, bool masterEnable, bool fastPaths) {
+    std::vector<uint8_t> rom = buildRom(masterEnable);
+    GameBoyAdvanceImpl gba;
+    gba.loadRom(rom);
+    gba.setHeadless(true);
+    GameBoyAdvanceImpl::FastPaths paths;
+    paths.idleSkip = fastPaths;
+    paths.lazyRendering = fastPaths;
+    gba.setFastPaths(paths);
+    GameBoyAdvanceImpl::cyclesSinceStart = 0;
+
+    uint64_t overflows = 0;
+    uint64_t irqs = 0;
+    // a couple of frames, checked every 200 instructions (well under one overflow)
+    for(uint32_t step = 0; step < 4000; step++) {
+        gba.runInstructions(200);
+        overflows = gba.getCpu()->getRegister(4) / 8;
+        irqs = gba.getCpu()->getRegister(5) / 2;
+        // the rom counts the DMA1 flag just before the timer flag of the same poll
+        bool match = masterEnable ? (irqs == expectedRefills(overflows) || irqs == expectedRefills(overflows + 1))
+                                  : irqs == 0;
+        // every refill copies 4 words, FIFO_A keeps the last one. A refill may have happened since the last poll
+        uint32_t fifo = gba.getBus()->view32(0x040000A0);
+        bool fifoMatch = masterEnable ? (fifo + 1 == irqs * 4 || fifo + 1 == (irqs + 1) * 4 ||
+                                         (irqs == 0 && fifo == 0))
+                                      : fifo == 0;
+        if(!match || !fifoMatch) {
+            std::cout << "FAIL " << name << ": " << irqs << " DMA1 irqs after " << overflows << " overflows (expected "
+                      << (masterEnable ? expectedRefills(overflows) : 0) << "), FIFO_A holds word " << fifo << "\n";
+            return false;
+        }
+    }
+    if(overflows < 500 || (masterEnable && irqs < 30)) {
+        std::cout << "FAIL " << name << ": only " << overflows << " overflows and " << irqs << " refills\n";
+        return false;
+    }
+    std::cout << "PASS " << name << ": " << overflows << " overflows, " << irqs << " refills\n";
+    return true;
+}
+
+int main() {
+    bool passed = true;
+    passed &= run("master enable, fast paths", true, true);
+    passed &= run("master enable, reference", true, false);
+    passed &= run("master disable", false, true);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/arm7tdmi/ARM7TDMI.h"
+#include "../src/memory/Bus.h"
+#include "../src/GameBoyAdvanceImpl.h"
+#include "../src/PPU.h"
+#include "testCommon.h"
+
+/*
+    Verifies any number of cpu traces in parallel, see testCommon.h for the trace formats.
+
+    usage: gba_test_trace [--jobs <n>] [--shards <n>] <rom> <trace> [<rom> <trace> ...]
+
+    trace is a text log or a binary .trace. With --shards every trace is split into n equal ranges that are checked
+    by separate workers, each replaying from reset up to the start of its range.
+*/
+
+int main(int argc, char** argv) {
+    uint32_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t shards = 1;
+    std::vector<std::string> paths;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(i + 1 < argc && arg == "--jobs") {
+            jobs = std::max(1, std::stoi(argv[++i]));
+        } else if(i + 1 < argc && arg == "--shards") {
+            shards = std::max(1ull, std::stoull(argv[++i]));
+        } else if(arg.rfind("--", 0) != 0) {
+            paths.push_back(arg);
+        } else {
+            paths.clear();
+            break;
+        }
+    }
+    if(paths.empty() || paths.size() % 2 != 0) {
+        std::cerr << "usage: gba_test_trace [--jobs <n>] [--shards <n>] <rom> <trace> [<rom> <trace> ...]\n";
+        return 2;
+    }
+
+    std::vector<TraceJob> traceJobs;
+    for(size_t i = 0; i < paths.size(); i += 2) {
+        std::string rom = paths[i];
+        std::string trace = prepareTrace(paths[i + 1]);
+        MappedTrace mapped;
+        if(trace == "" || !mapped.open(trace)) {
+            std::cout << "FAIL " << paths[i + 1] << ": could not open trace\n";
+            return 1;
+        }
+        uint64_t shardSize = (mapped.size() + shards - 1) / shards;
+        for(uint64_t begin = 0; begin < mapped.size() || begin == 0; begin += std::max<uint64_t>(shardSize, 1)) {
+            std::string name = paths[i + 1];
+            if(shards > 1) {
+                name += "[" + std::to_string(begin) + ", " + std::to_string(std::min(begin + shardSize, mapped.size())) + ")";
+            }
+            traceJobs.push_back({name, rom, trace, begin, begin + shardSize});
+        }
+    }
+    return runTraceJobs(traceJobs, jobs);
+}